@@ -0,0 +1,115 @@
+#include "onnx_xla/reduction_helper.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Benchmark of the alternative XLA lowerings of Softmax, GlobalAveragePool and
+// LRN (see onnx_xla/reduction_helper.h), each registered as a translator
+// variant. Every lowering is timed on the XLA server across typical
+// CNN/transformer shapes.
+// Run ./lowering_benchmark [iterations] from the build/ directory while an XLA
+// server is listening on port 51000.
+
+using namespace onnx_xla;
+
+// Builds a lowering of the operator on input
+using Lowering = std::function<XlaOp(XlaBuilder&, const XlaOp&)>;
+
+struct BenchmarkCase {
+  std::string op;
+  std::vector<std::vector<int64>> shapes;
+  std::vector<std::pair<std::string, Lowering>> lowerings;
+};
+
+// Returns median wall time in milliseconds of executing lowering on the
+// server on a random float input of the given sizes
+double timeLowering(const Lowering& lowering,
+                    const std::vector<int64>& sizes,
+                    int iterations) {
+  XlaBuilder builder("lowering_benchmark");
+  Literal literal(ShapeUtil::MakeShape(xla::F32, sizes));
+  std::mt19937 engine(0);
+  std::uniform_real_distribution<float> unif(-1.0f, 1.0f);
+  for (auto& value : literal.data<float>()) {
+    value = unif(engine);
+  }
+  auto input = builder.Parameter(0, literal.shape(), "input");
+  builder.Tuple({lowering(builder, input)});
+  auto computation = builder.Build().ConsumeValueOrDie();
+  auto data = xla::TransferParameterToServer(literal);
+
+  // Warm up (compiles the computation on the server)
+  xla::ExecuteComputation(computation, {data.get()});
+
+  std::vector<double> times;
+  for (auto i = 0; i < iterations; ++i) {
+    auto start = std::chrono::steady_clock::now();
+    xla::ExecuteComputation(computation, {data.get()});
+    auto end = std::chrono::steady_clock::now();
+    times.push_back(
+        std::chrono::duration<double, std::milli>(end - start).count());
+  }
+  std::sort(times.begin(), times.end());
+  return times[times.size() / 2];
+}
+
+std::string shapeString(const std::vector<int64>& sizes) {
+  std::string s = "[";
+  for (auto i = 0; i < sizes.size(); ++i) {
+    s += (i ? "," : "") + std::to_string(sizes[i]);
+  }
+  return s + "]";
+}
+
+int main(int argc, char** argv) {
+  int iterations = argc > 1 ? std::stoi(argv[1]) : 20;
+
+  auto softmax = [](ReductionForm form) {
+    return [form](XlaBuilder& b, const XlaOp& x) {
+      return lowerSoftmax(b, x, 1, form);
+    };
+  };
+  auto globalAveragePool = [](ReductionForm form) {
+    return [form](XlaBuilder& b, const XlaOp& x) {
+      return lowerGlobalAveragePool(b, x, form);
+    };
+  };
+  // AlexNet LRN attributes
+  auto lrn = [](LRNForm form) {
+    return [form](XlaBuilder& b, const XlaOp& x) {
+      return lowerLRN(b, x, 1e-4f, 0.75f, 1.0f, 5, form);
+    };
+  };
+
+  std::vector<BenchmarkCase> cases = {
+      {"Softmax",
+       {{64, 1000}, {128, 30522}, {32, 12, 128, 128}},
+       {{"reduce", softmax(ReductionForm::kReduce)},
+        {"reduce_window", softmax(ReductionForm::kReduceWindow)}}},
+      {"GlobalAveragePool",
+       {{1, 2048, 7, 7}, {32, 512, 14, 14}, {32, 1024, 7, 7}},
+       {{"reduce", globalAveragePool(ReductionForm::kReduce)},
+        {"reduce_window", globalAveragePool(ReductionForm::kReduceWindow)}}},
+      {"LRN",
+       {{1, 96, 55, 55}, {32, 96, 55, 55}, {32, 256, 27, 27}},
+       {{"negative_power", lrn(LRNForm::kNegativePower)},
+        {"divide_power", lrn(LRNForm::kDividePower)},
+        {"sliced_sum", lrn(LRNForm::kSlicedSum)}}}};
+
+  for (const auto& c : cases) {
+    for (const auto& sizes : c.shapes) {
+      for (const auto& lowering : c.lowerings) {
+        std::cout << c.op << " " << shapeString(sizes) << " "
+                  << lowering.first << ": "
+                  << timeLowering(lowering.second, sizes, iterations)
+                  << " ms" << std::endl;
+      }
+    }
+  }
+  return 0;
+}
@@ -11,6 +11,48 @@ int main(int argc, char **argv) {
   std::cout << "static_relu_test succeeded!" << std::endl;
   onnx_xla::dynamic_relu_test();
   std::cout << "dynamic_relu_test succeeded!" << std::endl;
+  onnx_xla::conv_batchnorm_fold_test();
+  std::cout << "conv_batchnorm_fold_test succeeded!" << std::endl;
+  onnx_xla::reduced_precision_transfer_test();
+  std::cout << "reduced_precision_transfer_test succeeded!" << std::endl;
+  onnx_xla::output_selection_test();
+  std::cout << "output_selection_test succeeded!" << std::endl;
+  onnx_xla::multiple_outputs_test();
+  std::cout << "multiple_outputs_test succeeded!" << std::endl;
+  onnx_xla::persistent_state_test();
+  std::cout << "persistent_state_test succeeded!" << std::endl;
+  onnx_xla::chained_graphs_test();
+  std::cout << "chained_graphs_test succeeded!" << std::endl;
+  onnx_xla::backend_buffer_test();
+  std::cout << "backend_buffer_test succeeded!" << std::endl;
+  onnx_xla::io_slots_test();
+  std::cout << "io_slots_test succeeded!" << std::endl;
+  onnx_xla::pipelined_runs_test();
+  std::cout << "pipelined_runs_test succeeded!" << std::endl;
+  onnx_xla::pipelined_run_failure_test();
+  std::cout << "pipelined_run_failure_test succeeded!" << std::endl;
+  onnx_xla::fold_squeeze_unsqueeze_test();
+  std::cout << "fold_squeeze_unsqueeze_test succeeded!" << std::endl;
+  onnx_xla::common_subexpressions_dead_code_test();
+  std::cout << "common_subexpressions_dead_code_test succeeded!" << std::endl;
+  onnx_xla::simplify_layout_test();
+  std::cout << "simplify_layout_test succeeded!" << std::endl;
+  onnx_xla::depthwise_conv_test();
+  std::cout << "depthwise_conv_test succeeded!" << std::endl;
+  onnx_xla::registry_selection_test();
+  std::cout << "registry_selection_test succeeded!" << std::endl;
+  onnx_xla::lowering_variants_test();
+  std::cout << "lowering_variants_test succeeded!" << std::endl;
+  onnx_xla::plugin_test();
+  std::cout << "plugin_test succeeded!" << std::endl;
+  onnx_xla::dequantize_quantize_test();
+  std::cout << "dequantize_quantize_test succeeded!" << std::endl;
+  onnx_xla::quantized_operators_test();
+  std::cout << "quantized_operators_test succeeded!" << std::endl;
+  onnx_xla::attention_fusion_test();
+  std::cout << "attention_fusion_test succeeded!" << std::endl;
+  onnx_xla::image_input_test();
+  std::cout << "image_input_test succeeded!" << std::endl;
 
   return 0;
 }
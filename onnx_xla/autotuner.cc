@@ -0,0 +1,241 @@
+#include "onnx_xla/autotuner.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+namespace onnx_xla {
+using ::ONNX_NAMESPACE::AttributeKind;
+
+// Timed executions of each candidate (after one warm up execution)
+static const int kTuningIterations = 10;
+
+TranslationTuner& TranslationTuner::tuner() {
+  static TranslationTuner tuner_;
+  return tuner_;
+}
+
+TranslationTuner::TranslationTuner() {
+  const char* autotune = std::getenv("ONNX_XLA_AUTOTUNE");
+  autotune_ = autotune && std::string(autotune) == "1";
+  const char* databasePath = std::getenv("ONNX_XLA_TUNING_DB");
+  if (!databasePath) {
+    return;
+  }
+  database_path_ = databasePath;
+  std::ifstream database(database_path_);
+  std::string line;
+  while (std::getline(database, line)) {
+    auto separator = line.rfind('\t');
+    if (separator != std::string::npos) {
+      choices_[line.substr(0, separator)] = line.substr(separator + 1);
+    }
+  }
+}
+
+// Signature fields are separated by '|'; separators in string attributes are
+// replaced so that a signature stays on one database line
+static std::string sanitize(std::string s) {
+  std::replace_if(s.begin(), s.end(),
+                  [](char c) { return c == '\t' || c == '\n' || c == '|'; },
+                  ' ');
+  return s;
+}
+
+std::string TranslationTuner::nodeSignature(const Node& n) {
+  std::ostringstream signature;
+  signature << n.domain() << "::" << n.kind().toString();
+  for (const Value* v : n.inputs()) {
+    signature << "|" << v->elemType() << "[";
+    if (v->has_sizes()) {
+      for (const auto& d : v->sizes()) {
+        signature << (d.is_int ? std::to_string(d.dim) : d.param) << ",";
+      }
+    }
+    signature << "]";
+  }
+  auto names = n.attributeNames();
+  std::sort(names.begin(), names.end(),
+            [](const Symbol& a, const Symbol& b) {
+              return std::string(a.toString()) < std::string(b.toString());
+            });
+  for (const auto& name : names) {
+    signature << "|" << name.toString() << "=";
+    switch (n.kindOf(name)) {
+      case AttributeKind::f:
+        signature << n.f(name);
+        break;
+      case AttributeKind::i:
+        signature << n.i(name);
+        break;
+      case AttributeKind::s:
+        signature << sanitize(n.s(name));
+        break;
+      case AttributeKind::fs:
+        for (auto f : n.fs(name)) {
+          signature << f << ",";
+        }
+        break;
+      case AttributeKind::is:
+        for (auto i : n.is(name)) {
+          signature << i << ",";
+        }
+        break;
+      default:
+        // Tensor, graph and string list attributes are not part of the
+        // signature
+        signature << "?";
+        break;
+    }
+  }
+  return signature.str();
+}
+
+// Fills literal with values in [-1, 1) for floating point types (other types
+// are left at zero)
+static void fillRandom(Literal& literal, std::mt19937& engine) {
+  std::uniform_real_distribution<double> unif(-1.0, 1.0);
+  switch (literal.shape().element_type()) {
+    case xla::F32: {
+      for (auto& value : literal.data<float>()) {
+        value = (float)unif(engine);
+      }
+      break;
+    }
+    case xla::F64: {
+      for (auto& value : literal.data<double>()) {
+        value = unif(engine);
+      }
+      break;
+    }
+    default: { break; }
+  }
+}
+
+double TranslationTuner::timeCandidate(const Node& n,
+                                       const TranslatorEntry& entry,
+                                       const ValueLiteralMap& valueToLiteral) {
+  try {
+    // Build a computation running only n, with non constant inputs as
+    // parameters
+    XlaBuilder builder("autotune");
+    ValueOpMap valueToOp;
+    std::vector<std::unique_ptr<Literal>> arguments;
+    std::mt19937 engine(0);
+    for (auto i = 0; i < n.inputs().size(); ++i) {
+      const Value* v = n.inputs()[i];
+      if (v->uniqueName() == "" || valueToOp.count(v)) {
+        continue;
+      }
+      auto literalIt = valueToLiteral.find(v);
+      if (literalIt != valueToLiteral.end()) {
+        valueToOp[v] = builder.ConstantLiteral(*literalIt->second);
+        continue;
+      }
+      std::vector<int64> sizes;
+      for (auto dim : parseOnnxInputSizes(n, i)) {
+        sizes.push_back(dim);
+      }
+      auto shape =
+          ShapeUtil::MakeShape(onnxToPrimitive(v->elemType()), sizes);
+      valueToOp[v] = builder.Parameter(arguments.size(), shape, "input");
+      arguments.emplace_back(Literal::CreateFromShape(shape));
+      fillRandom(*arguments.back(), engine);
+    }
+    if (entry.translator(n, builder, valueToOp, valueToLiteral) !=
+        ONNXIFI_STATUS_SUCCESS) {
+      return -1.0;
+    }
+    std::vector<XlaOp> outputOps;
+    for (const Value* v : n.outputs()) {
+      if (valueToOp.count(v)) {
+        outputOps.push_back(valueToOp.at(v));
+      }
+    }
+    builder.Tuple(outputOps);
+    auto computationStatus = builder.Build();
+    if (!computationStatus.ok()) {
+      return -1.0;
+    }
+    auto computation = computationStatus.ConsumeValueOrDie();
+
+    std::vector<std::unique_ptr<xla::GlobalData>> data;
+    std::vector<xla::GlobalData*> dataPtrs;
+    for (const auto& argument : arguments) {
+      data.push_back(xla::TransferParameterToServer(*argument));
+      dataPtrs.push_back(data.back().get());
+    }
+    xla::ExecuteComputation(computation, dataPtrs);
+    std::vector<double> times;
+    for (auto i = 0; i < kTuningIterations; ++i) {
+      auto start = std::chrono::steady_clock::now();
+      xla::ExecuteComputation(computation, dataPtrs);
+      auto end = std::chrono::steady_clock::now();
+      times.push_back(
+          std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+  } catch (const std::exception& e) {
+    std::cerr << "Autotuning " << entry.variant << " failed: " << e.what()
+              << std::endl;
+    return -1.0;
+  }
+}
+
+void TranslationTuner::record(const std::string& signature,
+                              const std::string& variant) {
+  choices_[signature] = variant;
+  if (database_path_.empty()) {
+    return;
+  }
+  std::ofstream database(database_path_, std::ios::app);
+  database << signature << "\t" << variant << std::endl;
+}
+
+const TranslatorEntry* TranslationTuner::choose(
+    const Node& n,
+    const std::vector<const TranslatorEntry*>& candidates,
+    const ValueLiteralMap& valueToLiteral) {
+  if (candidates.size() == 1) {
+    return candidates.front();
+  }
+  const auto signature = nodeSignature(n);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto choiceIt = choices_.find(signature);
+    if (choiceIt != choices_.end()) {
+      for (const TranslatorEntry* entry : candidates) {
+        if (entry->variant == choiceIt->second) {
+          return entry;
+        }
+      }
+    }
+  }
+  if (!autotune_) {
+    return candidates.front();
+  }
+
+  // Candidates are timed without the lock, as the server round trips are
+  // slow; concurrent builds may time the same signature, the first choice
+  // recorded is kept
+  const TranslatorEntry* fastest = candidates.front();
+  double fastestTime = -1.0;
+  for (const TranslatorEntry* entry : candidates) {
+    auto time = timeCandidate(n, *entry, valueToLiteral);
+    if (time >= 0.0 && (fastestTime < 0.0 || time < fastestTime)) {
+      fastest = entry;
+      fastestTime = time;
+    }
+  }
+  if (fastestTime >= 0.0) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!choices_.count(signature)) {
+      record(signature, fastest->variant);
+    }
+  }
+  return fastest;
+}
+}
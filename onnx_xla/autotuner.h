@@ -0,0 +1,55 @@
+#pragma once
+
+#include "onnx_xla/operator_registry.h"
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace onnx_xla {
+// Chooses among the applicable translators of a node. Choices are recorded in
+// a tuning database keyed on the node signature (operator, input types and
+// shapes, attributes) so that later builds reuse them.
+// Configured through the environment:
+//  ONNX_XLA_TUNING_DB: path of the tuning database file (one
+//    "signature<TAB>variant" line per tuned node signature)
+//  ONNX_XLA_AUTOTUNE=1: time every candidate of nodes missing from the
+//    database on the XLA server and record the fastest
+// Without a database entry or autotuning, the highest priority candidate is
+// used.
+class TranslationTuner final {
+ public:
+  // Returns reference to static singleton tuner
+  static TranslationTuner& tuner();
+
+  // Returns the translator to use for n among candidates (in decreasing
+  // priority, non empty)
+  const TranslatorEntry* choose(
+      const Node& n,
+      const std::vector<const TranslatorEntry*>& candidates,
+      const ValueLiteralMap& valueToLiteral);
+
+  // Returns a string identifying the operator, input types and shapes, and
+  // attributes of n
+  static std::string nodeSignature(const Node& n);
+
+ private:
+  TranslationTuner();
+
+  // Returns the median time in milliseconds of running the translation of n
+  // by entry on its own, or a negative value if it cannot be timed
+  double timeCandidate(const Node& n,
+                       const TranslatorEntry& entry,
+                       const ValueLiteralMap& valueToLiteral);
+
+  // Appends the choice for signature to the database file (with mutex_ held)
+  void record(const std::string& signature, const std::string& variant);
+
+  bool autotune_;
+  std::string database_path_;
+  // Node signature to variant name
+  std::unordered_map<std::string, std::string> choices_;
+  // Guards choices_ and the database file, not the timing of candidates
+  std::mutex mutex_;
+};
+}
@@ -1,104 +1,104 @@
 #include "onnx_xla/backend.h"
+#include "onnx_xla/buffer_allocator.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
 
 namespace onnx_xla {
 XlaExecutor::XlaExecutor(onnxBackend backend) : backend_(backend) {}
 
-#define SWITCH(data_type)                                                 \
-  switch (data_type) {                                                    \
-    case ONNX_NAMESPACE::TensorProto_DataType_FLOAT: {                    \
-      OPERATION(float, float, floats)                                     \
-    }                                                                     \
-    case ONNX_NAMESPACE::TensorProto_DataType_COMPLEX64: {                \
-      OPERATION(complex64, complex64, floats)                             \
-    }                                                                     \
-    case ONNX_NAMESPACE::TensorProto_DataType_FLOAT16: {                  \
-      OPERATION(int32_t, half, int32s)                                    \
-    }                                                                     \
-    case ONNX_NAMESPACE::TensorProto_DataType_BOOL: {                     \
-      OPERATION(int32_t, bool, int32s)                                    \
-    }                                                                     \
-    case ONNX_NAMESPACE::TensorProto_DataType_INT8: {                     \
-      OPERATION(int32_t, int8, int32s)                                    \
-    }                                                                     \
-    case ONNX_NAMESPACE::TensorProto_DataType_INT16: {                    \
-      OPERATION(int32_t, int16, int32s)                                   \
-    }                                                                     \
-    case ONNX_NAMESPACE::TensorProto_DataType_INT32: {                    \
-      OPERATION(int32_t, int32, int32s)                                   \
-    }                                                                     \
-    case ONNX_NAMESPACE::TensorProto_DataType_UINT8: {                    \
-      OPERATION(int32_t, uint8, int32s)                                   \
-    }                                                                     \
-    case ONNX_NAMESPACE::TensorProto_DataType_UINT16: {                   \
-      OPERATION(int32_t, uint16, int32s)                                  \
-    }                                                                     \
-    case ONNX_NAMESPACE::TensorProto_DataType_INT64: {                    \
-      OPERATION(int64_t, int64, int64s)                                   \
-    }                                                                     \
-    case ONNX_NAMESPACE::TensorProto_DataType_UINT32: {                   \
-      OPERATION(uint64_t, uint32, uint64s)                                \
-    }                                                                     \
-    case ONNX_NAMESPACE::TensorProto_DataType_UINT64: {                   \
-      OPERATION(uint64_t, uint64, uint64s)                                \
-    }                                                                     \
-    case ONNX_NAMESPACE::TensorProto_DataType_DOUBLE: {                   \
-      OPERATION(double, double, doubles)                                  \
-    }                                                                     \
-    case ONNX_NAMESPACE::TensorProto_DataType_COMPLEX128:                 \
-    case ONNX_NAMESPACE::TensorProto_DataType_STRING:                     \
-    case ONNX_NAMESPACE::TensorProto_DataType_UNDEFINED:                  \
-    default: {                                                            \
-      throw std::runtime_error("Tensor not of a convertible data type."); \
-    }                                                                     \
-  }
-
-std::unique_ptr<Literal> XlaExecutor::tensorToLiteral(const Tensor& t) {
-#define OPERATION(type_from, type_to, vec)                                   \
-  type_from* t_data;                                                         \
-  if (t.is_raw_data()) {                                                     \
-    t_data = (type_from*)t.raw().c_str();                                    \
-  } else {                                                                   \
-    t_data = (type_from*)t.vec().data();                                     \
-  }                                                                          \
-  std::vector<int64> sizes;                                                  \
-  for (auto n : t.sizes()) {                                                 \
-    sizes.push_back(n);                                                      \
-  }                                                                          \
-  auto l = std::unique_ptr<Literal>(new Literal(                             \
-      ShapeUtil::MakeShape(NativeToPrimitiveType<type_to>(), sizes)));       \
-  int64 num_elements = std::accumulate(sizes.begin(), sizes.end(), (int64)1, \
-                                       std::multiplies<int64>());            \
-  tensorflow::gtl::MutableArraySlice<type_to> l_data = l->data<type_to>();   \
-  for (auto i = 0; i < num_elements; ++i) {                                  \
-    l_data[i] = (type_to)t_data[i];                                          \
-  }                                                                          \
-  return l;
+XlaExecutor::~XlaExecutor() {
+  // Runs in flight finish before the pipeline stops
+  if (!pipeline_queues_.empty()) {
+    pipeline_queues_.front()->close();
+  }
+  for (auto& thread : pipeline_threads_) {
+    thread.join();
+  }
+}
 
-  SWITCH(t.elem_type())
-#undef OPERATION
+// Conversions between float32 buffers and float16 or bfloat16 literals for
+// reduced precision transfers, in one pass over contiguous memory. The Eigen
+// casts use vector conversion instructions (F16C) where available, and the
+// bfloat16 loops are integer arithmetic the compiler vectorizes.
+static void toReducedPrecision(const float* from, int64 size, Literal& l) {
+  if (l.shape().element_type() == xla::F16) {
+    Eigen::Map<Eigen::Array<half, Eigen::Dynamic, 1>>(l.data<half>().data(),
+                                                      size) =
+        Eigen::Map<const Eigen::ArrayXf>(from, size).cast<half>();
+    return;
+  }
+  auto to = reinterpret_cast<uint16*>(l.data<bfloat16>().data());
+  for (int64 i = 0; i < size; ++i) {
+    uint32 bits;
+    std::memcpy(&bits, &from[i], sizeof(bits));
+    // Round to nearest even, keeping NaNs quiet NaNs
+    to[i] = std::isnan(from[i]) ? 0x7fc0
+                                : (bits + 0x7fff + ((bits >> 16) & 1)) >> 16;
+  }
+}
+
+// data holds size elements of type (F16 or BF16)
+static void fromReducedPrecision(PrimitiveType type,
+                                 const void* data,
+                                 int64 size,
+                                 float* to) {
+  if (type == xla::F16) {
+    Eigen::Map<Eigen::ArrayXf>(to, size) =
+        Eigen::Map<const Eigen::Array<half, Eigen::Dynamic, 1>>(
+            static_cast<const half*>(data), size)
+            .cast<float>();
+    return;
+  }
+  auto from = static_cast<const uint16*>(data);
+  for (int64 i = 0; i < size; ++i) {
+    uint32 bits = (uint32)from[i] << 16;
+    std::memcpy(&to[i], &bits, sizeof(bits));
+  }
+}
+
+// Bytes saved by transferring a float32 value of the model in the type of
+// shape (see XlaExecutor::transfer_types_)
+static int64 savedBytes(const Shape& shape) {
+  return ShapeUtil::ElementsIn(shape) * sizeof(float) -
+         ShapeUtil::ByteSizeOf(shape);
 }
 
 std::unique_ptr<Literal> XlaExecutor::inputNameToLiteral(
-    const std::string& name) {
+    const std::string& name,
+    onnxPointer buffer) const {
   std::vector<int64> sizes;
-  for (auto i = 0; i < io_shape_[name].size(); ++i) {
-    sizes.push_back((int64)io_shape_[name][i].dim);
+  for (const Dimension& d : io_shape_.at(name)) {
+    sizes.push_back((int64)d.dim);
   }
   int64 num_elements = std::accumulate(sizes.begin(), sizes.end(), (int64)1,
                                        std::multiplies<int64>());
 
+  ONNX_ASSERT(buffer);
+  auto transferIt = transfer_types_.find(name);
+  if (transferIt != transfer_types_.end()) {
+    auto l = std::unique_ptr<Literal>(
+        new Literal(ShapeUtil::MakeShape(transferIt->second, sizes)));
+    if (transferIt->second == xla::U8) {
+      std::memcpy(l->data<uint8>().data(), (const void*)buffer, num_elements);
+    } else {
+      toReducedPrecision((const float*)buffer, num_elements, *l);
+    }
+    return l;
+  }
+
 #define OPERATION(type_from, type_to, vec)                                 \
   auto l = std::unique_ptr<Literal>(new Literal(                           \
       ShapeUtil::MakeShape(NativeToPrimitiveType<type_to>(), sizes)));     \
   tensorflow::gtl::MutableArraySlice<type_to> l_data = l->data<type_to>(); \
-  ONNX_ASSERT(input_buffers_[name]);                                       \
-  type_from* inputData = (type_from*)input_buffers_[name];                 \
+  type_from* inputData = (type_from*)buffer;                               \
   for (auto i = 0; i < num_elements; ++i) {                                \
     l_data[i] = (type_to)inputData[i];                                     \
   }                                                                        \
   return l;
 
-  SWITCH(io_data_type_[name])
+  NATIVE_SWITCH(io_data_type_.at(name))
 #undef OPERATION
 }
 
@@ -118,7 +118,7 @@ std::unique_ptr<Literal> XlaExecutor::descriptorToLiteral(
   }                                                                        \
   return l;
 
-  SWITCH(t.dataType)
+  NATIVE_SWITCH(t.dataType)
 #undef OPERATION
 }
 
@@ -127,82 +127,565 @@ onnxStatus XlaExecutor::initIO(
     const onnxTensorDescriptorV1* inputDescriptors,
     uint32_t outputsCount,
     const onnxTensorDescriptorV1* outputDescriptors) {
+  io_ = IOBinding();
+  return bindIO(inputsCount, inputDescriptors, outputsCount, outputDescriptors,
+                io_);
+}
+
+onnxStatus XlaExecutor::bindIO(uint32_t inputsCount,
+                               const onnxTensorDescriptorV1* inputDescriptors,
+                               uint32_t outputsCount,
+                               const onnxTensorDescriptorV1* outputDescriptors,
+                               IOBinding& binding) {
   if (num_inputs_ != inputsCount) {
     throw std::runtime_error("Did not receive expected number of inputs");
   }
-  if (num_outputs_ != outputsCount) {
-    throw std::runtime_error("Did not receive expected number of outputs");
-  }
-
-#define CHECK_TYPE_AND_SHAPE(VAR)                                      \
-  for (auto i = 0; i < num_##VAR##s_; ++i) {                           \
-    if (VAR##Descriptors[i].tag != ONNXIFI_TAG_TENSOR_DESCRIPTOR_V1) { \
-      return ONNXIFI_STATUS_UNSUPPORTED_TAG;                           \
-    }                                                                  \
-    const std::string name(VAR##Descriptors[i].name);                  \
-    if (io_data_type_.find(name) == io_data_type_.end()) {             \
-      return ONNXIFI_STATUS_INVALID_NAME;                              \
-    }                                                                  \
-    VAR##_buffers_[name] = VAR##Descriptors[i].buffer;                 \
-    if (VAR##Descriptors[i].dataType != io_data_type_[name]) {         \
-      return ONNXIFI_STATUS_MISMATCHING_DATATYPE;                      \
-    }                                                                  \
-    if (VAR##Descriptors[i].dimensions != io_shape_[name].size()) {    \
-      return ONNXIFI_STATUS_MISMATCHING_SHAPE;                         \
-    }                                                                  \
-    for (auto j = 0; j < io_shape_[name].size(); ++j) {                \
-      if (!io_shape_[name][j].is_int ||                                \
-          io_shape_[name][j].dim != VAR##Descriptors[i].shape[j]) {    \
-        return ONNXIFI_STATUS_MISMATCHING_SHAPE;                       \
-      }                                                                \
-    }                                                                  \
-  }
-
-  CHECK_TYPE_AND_SHAPE(input);
-  CHECK_TYPE_AND_SHAPE(output);
+  if (num_outputs_ < outputsCount) {
+    throw std::runtime_error("Received more outputs than the graph has");
+  }
+
+  for (auto i = 0; i < inputsCount; ++i) {
+    auto status = checkDescriptor(inputDescriptors[i]);
+    if (status != ONNXIFI_STATUS_SUCCESS) {
+      return status;
+    }
+    // State inputs are set by resetState
+    if (state_outputs_.count(inputDescriptors[i].name)) {
+      return ONNXIFI_STATUS_INVALID_NAME;
+    }
+    const std::string name(inputDescriptors[i].name);
+    binding.inputBuffers[name] = inputDescriptors[i].buffer;
+    if (inputDescriptors[i].memoryType == ONNX_XLA_MEMORY_TYPE_XLA_DATA) {
+      binding.dataHandles.insert(name);
+    } else if (!transfer_types_.count(name) &&
+               isBackendBuffer((const void*)inputDescriptors[i].buffer,
+                               ShapeUtil::ByteSizeOf(ioShape(name)))) {
+      // Native width buffers already hold the literal data
+      binding.borrowedInputs.insert(name);
+    }
+  }
+  for (auto i = 0; i < outputsCount; ++i) {
+    auto status = checkDescriptor(outputDescriptors[i]);
+    if (status != ONNXIFI_STATUS_SUCCESS) {
+      return status;
+    }
+    const std::string name(outputDescriptors[i].name);
+    binding.outputBuffers[name] = outputDescriptors[i].buffer;
+    if (outputDescriptors[i].memoryType == ONNX_XLA_MEMORY_TYPE_XLA_DATA) {
+      // State outputs are moved to the state after each run
+      for (const auto& state : state_outputs_) {
+        if (output_names_[state.second] == name) {
+          return ONNXIFI_STATUS_UNSUPPORTED_MEMORY_TYPE;
+        }
+      }
+      binding.dataHandles.insert(name);
+    }
+  }
+  return ONNXIFI_STATUS_SUCCESS;
+}
+
+onnxStatus XlaExecutor::addIOSlot(
+    uint32_t inputsCount,
+    const onnxTensorDescriptorV1* inputDescriptors,
+    uint32_t outputsCount,
+    const onnxTensorDescriptorV1* outputDescriptors,
+    uint32_t* slot) {
+  std::unique_ptr<IOSlot> ioSlot(new IOSlot());
+  auto status = bindIO(inputsCount, inputDescriptors, outputsCount,
+                       outputDescriptors, ioSlot->binding);
+  if (status != ONNXIFI_STATUS_SUCCESS) {
+    return status;
+  }
+  slots_.push_back(std::move(ioSlot));
+  *slot = slots_.size() - 1;
+  return ONNXIFI_STATUS_SUCCESS;
+}
+
+onnxStatus XlaExecutor::prefetchSlot(uint32_t slot,
+                                     const onnxMemoryFenceV1* inputFence) {
+  if (slot >= slots_.size()) {
+    return ONNXIFI_STATUS_INVALID_ID;
+  }
+  auto& ioSlot = *slots_[slot];
+  if (!ioSlot.prefetched.valid()) {
+    // The buffers are read only once the application has filled them
+    onnxEvent inputEvent = inputFence->event;
+    const IOBinding& binding = ioSlot.binding;
+    ioSlot.prefetched =
+        std::async(std::launch::async, [this, inputEvent, &binding] {
+          auto waitStatus = onnxWaitEvent(inputEvent);
+          if (waitStatus != ONNXIFI_STATUS_SUCCESS) {
+            UploadedInputs failed;
+            failed.status = waitStatus;
+            return failed;
+          }
+          return uploadInputs(binding);
+        });
+  }
+  return ONNXIFI_STATUS_SUCCESS;
+}
+
+bool XlaExecutor::hasSlot(uint32_t slot) const {
+  return slot < slots_.size();
+}
+
+onnxStatus XlaExecutor::executeSlot(uint32_t slot,
+                                    const onnxMemoryFenceV1* inputFence,
+                                    onnxMemoryFenceV1* outputFence) {
+  if (slot >= slots_.size()) {
+    return ONNXIFI_STATUS_INVALID_ID;
+  }
+  return run(slots_[slot]->binding, &slots_[slot]->prefetched, inputFence,
+             outputFence);
+}
+
+onnxStatus XlaExecutor::checkDescriptor(const onnxTensorDescriptorV1& d) {
+  if (d.tag != ONNXIFI_TAG_TENSOR_DESCRIPTOR_V1) {
+    return ONNXIFI_STATUS_UNSUPPORTED_TAG;
+  }
+  const std::string name(d.name);
+  if (io_data_type_.find(name) == io_data_type_.end()) {
+    return ONNXIFI_STATUS_INVALID_NAME;
+  }
+  if (d.dataType != io_data_type_[name]) {
+    return ONNXIFI_STATUS_MISMATCHING_DATATYPE;
+  }
+  if (d.dimensions != io_shape_[name].size()) {
+    return ONNXIFI_STATUS_MISMATCHING_SHAPE;
+  }
+  for (auto j = 0; j < io_shape_[name].size(); ++j) {
+    if (!io_shape_[name][j].is_int || io_shape_[name][j].dim != d.shape[j]) {
+      return ONNXIFI_STATUS_MISMATCHING_SHAPE;
+    }
+  }
+  // XlaData handles hold tensors of the model type
+  if (d.memoryType != ONNXIFI_MEMORY_TYPE_CPU &&
+      (d.memoryType != ONNX_XLA_MEMORY_TYPE_XLA_DATA ||
+       transfer_types_.count(name))) {
+    return ONNXIFI_STATUS_UNSUPPORTED_MEMORY_TYPE;
+  }
+  return ONNXIFI_STATUS_SUCCESS;
+}
+
+Shape XlaExecutor::ioShape(const std::string& name) const {
+  std::vector<int64> sizes;
+  for (const Dimension& d : io_shape_.at(name)) {
+    sizes.push_back(d.dim);
+  }
+  return ShapeUtil::MakeShape(onnxToPrimitive(io_data_type_.at(name)), sizes);
+}
+
+onnxStatus XlaExecutor::resetState(
+    uint32_t stateCount,
+    const onnxTensorDescriptorV1* stateDescriptors) {
+  // The state is left unchanged unless every descriptor is valid
+  for (auto i = 0; i < stateCount; ++i) {
+    auto status = checkDescriptor(stateDescriptors[i]);
+    if (status != ONNXIFI_STATUS_SUCCESS) {
+      return status;
+    }
+    if (!state_outputs_.count(stateDescriptors[i].name)) {
+      return ONNXIFI_STATUS_INVALID_NAME;
+    }
+  }
+  std::unordered_map<std::string, std::shared_ptr<GlobalData>> stateData;
+  for (auto i = 0; i < stateCount; ++i) {
+    stateData[stateDescriptors[i].name] = xla::TransferParameterToServer(
+        *descriptorToLiteral(stateDescriptors[i]));
+  }
+  state_data_.swap(stateData);
+  return ONNXIFI_STATUS_SUCCESS;
+}
+
+onnxStatus XlaExecutor::snapshotState(
+    uint32_t stateCount,
+    const onnxTensorDescriptorV1* stateDescriptors) {
+  for (auto i = 0; i < stateCount; ++i) {
+    auto status = checkDescriptor(stateDescriptors[i]);
+    if (status != ONNXIFI_STATUS_SUCCESS) {
+      return status;
+    }
+    const std::string name(stateDescriptors[i].name);
+    if (!state_outputs_.count(name)) {
+      return ONNXIFI_STATUS_INVALID_NAME;
+    }
+    auto bytes = ShapeUtil::ByteSizeOf(ioShape(name));
+    auto dataIt = state_data_.find(name);
+    if (dataIt == state_data_.end()) {
+      std::memset((void*)stateDescriptors[i].buffer, 0, bytes);
+    } else {
+      auto l_ptr = xla::TransferFromServer(*dataIt->second);
+      std::memcpy((void*)stateDescriptors[i].buffer, l_ptr->untyped_data(),
+                  bytes);
+    }
+  }
   return ONNXIFI_STATUS_SUCCESS;
-#undef CHECK_TYPE_AND_SHAPE
 }
 
 onnxStatus XlaExecutor::executeComputation(const onnxMemoryFenceV1* inputFence,
                                            onnxMemoryFenceV1* outputFence) {
-  std::vector<GlobalData*> arguments;
+  return run(io_, nullptr, inputFence, outputFence);
+}
+
+bool XlaExecutor::transfersInput(const IOBinding& binding,
+                                 const std::string& name) const {
+  return !state_outputs_.count(name) && !binding.dataHandles.count(name);
+}
+
+std::unique_ptr<xla::LiteralBase> XlaExecutor::inputLiteral(
+    const IOBinding& binding,
+    const std::string& name,
+    TransferStats& stats) const {
+  auto buffer = binding.inputBuffers.at(name);
+  std::unique_ptr<xla::LiteralBase> literal;
+  if (binding.borrowedInputs.count(name)) {
+    literal.reset(
+        new xla::BorrowingLiteral((const char*)buffer, ioShape(name)));
+  } else {
+    literal = this->inputNameToLiteral(name, buffer);
+  }
+  stats.inputBytes += ShapeUtil::ByteSizeOf(literal->shape());
+  if (transfer_types_.count(name)) {
+    stats.savedBytes += savedBytes(literal->shape());
+  }
+  return literal;
+}
+
+UploadedInputs XlaExecutor::uploadInputs(const IOBinding& binding) const {
+  UploadedInputs uploaded;
+  for (const std::string& s : param_input_name_) {
+    if (!transfersInput(binding, s)) {
+      uploaded.data.emplace_back();
+      continue;
+    }
+    auto literal = inputLiteral(binding, s, uploaded.stats);
+    uploaded.data.push_back(xla::TransferParameterToServer(*literal));
+  }
+  return uploaded;
+}
+
+onnxStatus XlaExecutor::resolveArguments(
+    const IOBinding& binding,
+    const UploadedInputs& uploaded,
+    std::vector<GlobalData*>& arguments) {
+  // State inputs and XlaData inputs already on the server are passed as is
+  for (auto i = 0; i < param_input_name_.size(); ++i) {
+    const std::string& s = param_input_name_[i];
+    if (state_outputs_.count(s)) {
+      auto& stateData = state_data_[s];
+      if (!stateData) {
+        auto zeros = Literal::CreateFromShape(ioShape(s));
+        stateData = xla::TransferParameterToServer(*zeros);
+      }
+      arguments.push_back(stateData.get());
+      continue;
+    }
+    if (binding.dataHandles.count(s)) {
+      auto handle = reinterpret_cast<XlaData*>(binding.inputBuffers.at(s));
+      if (!handle || !handle->data) {
+        std::cerr << "Input " << s << " is bound to an empty handle"
+                  << std::endl;
+        return ONNXIFI_STATUS_INVALID_STATE;
+      }
+      if (!ShapeUtil::Equal(handle->shape, ioShape(s))) {
+        return ONNXIFI_STATUS_MISMATCHING_SHAPE;
+      }
+      arguments.push_back(handle->data.get());
+      continue;
+    }
+    arguments.push_back(uploaded.data[i].get());
+  }
+  return ONNXIFI_STATUS_SUCCESS;
+}
+
+// Outputs without a buffer (left out of initIO, or with a null buffer) are
+// not transferred from the server, nor are the outputs bound to XlaData
+// handles (kept)
+void XlaExecutor::selectOutputs(const IOBinding& binding,
+                                std::vector<size_t>& fetched,
+                                std::vector<size_t>& kept) const {
+  for (auto i = 0; i < output_names_.size(); ++i) {
+    auto bufferIt = binding.outputBuffers.find(output_names_[i]);
+    if (bufferIt != binding.outputBuffers.end() && bufferIt->second) {
+      (binding.dataHandles.count(output_names_[i]) ? kept : fetched)
+          .push_back(i);
+    }
+  }
+}
+
+// The new state and kept outputs replace the previous ones on the server.
+// State outputs may also be fetched, so the state shares their data.
+std::vector<std::shared_ptr<GlobalData>> XlaExecutor::executeOnServer(
+    const IOBinding& binding,
+    const std::vector<GlobalData*>& arguments,
+    const std::vector<size_t>& fetched,
+    const std::vector<size_t>& kept) {
+  auto result = xla::ExecuteOnServer(computation_, arguments);
+  if (fetched.empty() && kept.empty() && state_outputs_.empty()) {
+    return {};
+  }
+  std::vector<std::unique_ptr<GlobalData>> outputData;
+  if (output_names_.size() == 1) {
+    outputData.push_back(std::move(result));
+  } else {
+    outputData = xla::DeconstructTupleOnServer(*result);
+  }
+  for (auto i : kept) {
+    const auto& name = output_names_[i];
+    auto handle = reinterpret_cast<XlaData*>(binding.outputBuffers.at(name));
+    handle->data = std::move(outputData[i]);
+    handle->shape = ioShape(name);
+  }
+  std::vector<std::shared_ptr<GlobalData>> sharedData;
+  for (auto& data : outputData) {
+    sharedData.emplace_back(std::move(data));
+  }
+  for (const auto& state : state_outputs_) {
+    state_data_[state.first] = sharedData[state.second];
+  }
+  return sharedData;
+}
+
+// IO buffers hold native width elements, so only reduced precision outputs
+// convert
+void XlaExecutor::copyOutput(const IOBinding& binding,
+                             size_t i,
+                             const Literal& result,
+                             const xla::ShapeIndex& index,
+                             TransferStats& stats) const {
+  const auto& name = output_names_[i];
+  const auto& shape = ShapeUtil::GetSubshape(result.shape(), index);
+  stats.outputBytes += ShapeUtil::ByteSizeOf(shape);
+  if (transfer_types_.count(name)) {
+    stats.savedBytes += savedBytes(shape);
+    fromReducedPrecision(shape.element_type(), result.untyped_data(index),
+                         ShapeUtil::ElementsIn(shape),
+                         (float*)binding.outputBuffers.at(name));
+    return;
+  }
+  std::memcpy((void*)binding.outputBuffers.at(name), result.untyped_data(index),
+              ShapeUtil::ByteSizeOf(shape));
+}
+
+onnxStatus XlaExecutor::run(const IOBinding& binding,
+                            std::future<UploadedInputs>* prefetched,
+                            const onnxMemoryFenceV1* inputFence,
+                            onnxMemoryFenceV1* outputFence) {
+  if (!pipeline_threads_.empty()) {
+    return enqueueRun(binding, prefetched, inputFence, outputFence);
+  }
   auto waitStatus = onnxWaitEvent(inputFence->event);
   if (waitStatus != ONNXIFI_STATUS_SUCCESS) {
     return waitStatus;
   }
-  for (const std::string& s : param_input_name_) {
-    auto l_ptr = this->inputNameToLiteral(s);
-    auto l_data_ptr = xla::TransferParameterToServer(*l_ptr);
-    arguments.push_back(l_data_ptr.release());
-  }
-  auto result = xla::ExecuteComputation(computation_, arguments);
-
-#define OPERATION(type_to, type_from, vec)                            \
-  type_to* destination = (type_to*)output_buffers_[output_names_[i]]; \
-  for (auto j = 0; j < num_elements; ++j) {                           \
-    destination[j] = (type_to)outputLiterals[i].data<type_from>()[j]; \
-  }                                                                   \
-  break;
-
-  std::vector<Literal> outputLiterals = result->DecomposeTuple();
-  for (auto i = 0; i < outputLiterals.size(); ++i) {
-    int64_t num_elements = 1;
-    for (auto j = 0; j < io_shape_[output_names_[i]].size(); ++j) {
-      num_elements *= io_shape_[output_names_[i]][j].dim;
+  auto uploaded = prefetched && prefetched->valid() ? prefetched->get()
+                                                    : uploadInputs(binding);
+  if (uploaded.status != ONNXIFI_STATUS_SUCCESS) {
+    return uploaded.status;
+  }
+  auto stats = uploaded.stats;
+  std::vector<GlobalData*> arguments;
+  auto argumentsStatus = resolveArguments(binding, uploaded, arguments);
+  if (argumentsStatus != ONNXIFI_STATUS_SUCCESS) {
+    return argumentsStatus;
+  }
+
+  std::vector<size_t> fetched;
+  std::vector<size_t> kept;
+  selectOutputs(binding, fetched, kept);
+  if (fetched.size() == output_names_.size() && state_outputs_.empty()) {
+    // Single output computations return the output itself (see
+    // XlaTransform::handleOutputs)
+    auto result = xla::ExecuteComputation(computation_, arguments);
+    if (!ShapeUtil::IsTuple(result->shape())) {
+      copyOutput(binding, 0, *result, {}, stats);
+    } else {
+      for (auto i = 0; i < output_names_.size(); ++i) {
+        copyOutput(binding, i, *result, {(int64)i}, stats);
+      }
     }
-    SWITCH(io_data_type_[output_names_[i]])
+    std::lock_guard<std::mutex> lk(stats_mutex_);
+    transfer_stats_ = stats;
+    return onnxSignalEvent(outputFence->event);
   }
+
+  // Otherwise the result stays on the server, and only the fetched outputs
+  // are transferred
+  auto outputData = executeOnServer(binding, arguments, fetched, kept);
+  for (auto i : fetched) {
+    copyOutput(binding, i, *xla::TransferFromServer(*outputData[i]), {},
+               stats);
+  }
+  std::lock_guard<std::mutex> lk(stats_mutex_);
+  transfer_stats_ = stats;
   return onnxSignalEvent(outputFence->event);
-#undef OPERATION
+}
+
+void XlaExecutor::startPipeline(size_t depth) {
+  std::vector<std::function<void(PipelineRun&)>> stages = {
+      [this](PipelineRun& run) { convertStage(run); },
+      [this](PipelineRun& run) { uploadStage(run); },
+      [this](PipelineRun& run) { executeStage(run); },
+      [this](PipelineRun& run) { downloadStage(run); },
+      [this](PipelineRun& run) { copyStage(run); }};
+  for (auto i = 0; i < stages.size(); ++i) {
+    pipeline_queues_.emplace_back(new RunQueue(depth));
+  }
+  // Stage i takes the runs of queue i, and passes them to the next stage.
+  // Runs a stage fails skip the later stages, and the last stage signals
+  // their output fence.
+  for (auto i = 0; i < stages.size(); ++i) {
+    RunQueue* in = pipeline_queues_[i].get();
+    RunQueue* out =
+        i + 1 < stages.size() ? pipeline_queues_[i + 1].get() : nullptr;
+    auto stage = stages[i];
+    pipeline_threads_.emplace_back([this, stage, in, out] {
+      std::unique_ptr<PipelineRun> run;
+      while (in->pop(run)) {
+        if (run->status == ONNXIFI_STATUS_SUCCESS) {
+          try {
+            stage(*run);
+          } catch (const std::exception& e) {
+            std::cerr << "Pipelined run failed: " << e.what() << std::endl;
+            run->status = ONNXIFI_STATUS_INTERNAL_ERROR;
+          }
+        }
+        if (out) {
+          out->push(std::move(run));
+        } else {
+          finishRun(*run);
+        }
+      }
+      if (out) {
+        out->close();
+      }
+    });
+  }
+}
+
+onnxStatus XlaExecutor::enqueueRun(const IOBinding& binding,
+                                   std::future<UploadedInputs>* prefetched,
+                                   const onnxMemoryFenceV1* inputFence,
+                                   onnxMemoryFenceV1* outputFence) {
+  {
+    // Forget the failure of an earlier run whose event had the same handle
+    std::lock_guard<std::mutex> lk(run_status_mutex_);
+    run_status_.erase(outputFence->event);
+  }
+  std::unique_ptr<PipelineRun> run(new PipelineRun());
+  run->binding = binding;
+  run->inputEvent = inputFence->event;
+  run->outputEvent = outputFence->event;
+  if (prefetched && prefetched->valid()) {
+    run->prefetched = std::move(*prefetched);
+  }
+  if (!pipeline_queues_.front()->push(std::move(run))) {
+    // The pipeline is stopping and dropped the run: still signal its fence
+    PipelineRun dropped;
+    dropped.outputEvent = outputFence->event;
+    dropped.status = ONNXIFI_STATUS_INVALID_STATE;
+    finishRun(dropped);
+    return ONNXIFI_STATUS_INVALID_STATE;
+  }
+  return ONNXIFI_STATUS_SUCCESS;
+}
+
+void XlaExecutor::convertStage(PipelineRun& run) const {
+  run.status = onnxWaitEvent(run.inputEvent);
+  if (run.status != ONNXIFI_STATUS_SUCCESS || run.prefetched.valid()) {
+    return;
+  }
+  for (const std::string& s : param_input_name_) {
+    run.inputLiterals.emplace_back();
+    if (transfersInput(run.binding, s)) {
+      run.inputLiterals.back() = inputLiteral(run.binding, s, run.stats);
+    }
+  }
+}
+
+void XlaExecutor::uploadStage(PipelineRun& run) const {
+  if (run.prefetched.valid()) {
+    run.uploaded = run.prefetched.get();
+    run.status = run.uploaded.status;
+    run.stats = run.uploaded.stats;
+    return;
+  }
+  for (const auto& literal : run.inputLiterals) {
+    run.uploaded.data.emplace_back();
+    if (literal) {
+      run.uploaded.data.back() = xla::TransferParameterToServer(*literal);
+    }
+  }
+  run.inputLiterals.clear();
+}
+
+void XlaExecutor::executeStage(PipelineRun& run) {
+  std::vector<GlobalData*> arguments;
+  run.status = resolveArguments(run.binding, run.uploaded, arguments);
+  if (run.status != ONNXIFI_STATUS_SUCCESS) {
+    return;
+  }
+  std::vector<size_t> kept;
+  selectOutputs(run.binding, run.fetched, kept);
+  run.outputData = executeOnServer(run.binding, arguments, run.fetched, kept);
+  run.uploaded.data.clear();
+}
+
+void XlaExecutor::downloadStage(PipelineRun& run) const {
+  for (auto i : run.fetched) {
+    run.outputLiterals.push_back(xla::TransferFromServer(*run.outputData[i]));
+  }
+  run.outputData.clear();
+}
+
+void XlaExecutor::copyStage(PipelineRun& run) {
+  for (auto j = 0; j < run.fetched.size(); ++j) {
+    copyOutput(run.binding, run.fetched[j], *run.outputLiterals[j], {},
+               run.stats);
+  }
+  std::lock_guard<std::mutex> lk(stats_mutex_);
+  transfer_stats_ = run.stats;
+}
+
+void XlaExecutor::finishRun(PipelineRun& run) {
+  // Recorded before signalling, so that waiters of the fence find it
+  if (run.status != ONNXIFI_STATUS_SUCCESS) {
+    std::lock_guard<std::mutex> lk(run_status_mutex_);
+    run_status_[run.outputEvent] = run.status;
+  }
+  auto signalStatus = onnxSignalEvent(run.outputEvent);
+  if (signalStatus != ONNXIFI_STATUS_SUCCESS) {
+    std::cerr << "Could not signal the output fence of a pipelined run"
+              << std::endl;
+  }
+}
+
+TransferStats XlaExecutor::transferStats() const {
+  std::lock_guard<std::mutex> lk(stats_mutex_);
+  return transfer_stats_;
+}
+
+onnxStatus XlaExecutor::runStatus(onnxEvent outputEvent) {
+  std::lock_guard<std::mutex> lk(run_status_mutex_);
+  auto it = run_status_.find(outputEvent);
+  if (it == run_status_.end()) {
+    return ONNXIFI_STATUS_SUCCESS;
+  }
+  auto status = it->second;
+  run_status_.erase(it);
+  return status;
 }
 
 XlaTransform::XlaTransform(onnxBackend backend,
                            std::unique_ptr<Graph> ir,
                            const std::string& build_name,
                            uint32_t weightsCount,
-                           const onnxTensorDescriptorV1* weightDescriptors)
-    : weights_count_(weightsCount),
+                           const onnxTensorDescriptorV1* weightDescriptors,
+                           OpsetVersionMap opsetVersions,
+                           GraphOptions options)
+    : opset_versions_(std::move(opsetVersions)),
+      options_(std::move(options)),
+      weights_count_(weightsCount),
       weight_descriptors_(weightDescriptors),
       builder_(build_name),
       executor_(new XlaExecutor(backend)),
@@ -221,6 +704,32 @@ inline Shape XlaTransform::shapeOfValue(const Value* v) {
   return ShapeUtil::MakeShape(onnxToPrimitive(v->elemType()), sizes);
 }
 
+PrimitiveType XlaTransform::transferTypeOf(const Value* v) const {
+  // State values stay on the server
+  for (const auto& state : options_.stateValues) {
+    if (v->uniqueName() == state.first || v->uniqueName() == state.second) {
+      return xla::F32;
+    }
+  }
+  if (options_.transferType == xla::F32 ||
+      v->elemType() != ONNX_NAMESPACE::TensorProto_DataType_FLOAT ||
+      (!options_.transferValues.empty() &&
+       !options_.transferValues.count(v->uniqueName()))) {
+    return xla::F32;
+  }
+  return options_.transferType;
+}
+
+inline void XlaTransform::materializeConstant(const Value* v) {
+  if (value_to_op_.find(v) != value_to_op_.end()) {
+    return;
+  }
+  auto literalIt = value_to_literal_.find(v);
+  if (literalIt != value_to_literal_.end()) {
+    value_to_op_[v] = builder_.ConstantLiteral(*literalIt->second);
+  }
+}
+
 onnxStatus XlaTransform::handleInputs() {
   if (ir_->initializers().size() != 0 && weight_descriptors_) {
     throw std::runtime_error(
@@ -264,10 +773,7 @@ onnxStatus XlaTransform::handleInputs() {
           return ONNXIFI_STATUS_MISMATCHING_SHAPE;
         }
       }
-      auto l_ptr = executor_->descriptorToLiteral(t);
-      auto constant = builder_.ConstantLiteral(*l_ptr);
-      value_to_op_[v] = constant;
-      value_to_literal_[v] = std::move(l_ptr);
+      value_to_literal_[v] = executor_->descriptorToLiteral(t);
     }
   } else {
     executor_->num_inputs_ = (uint32_t)((int64_t)(ir_->inputs().size()) -
@@ -275,23 +781,99 @@ onnxStatus XlaTransform::handleInputs() {
     for (const Tensor& t : ir_->initializers()) {
       std::string name(t.name());
       isInitialized[name] = true;
-      auto l_ptr = executor_->tensorToLiteral(t);
-      auto constant = builder_.ConstantLiteral(*l_ptr);
       const Value* v = inputNameToValue[name];
-      value_to_op_[v] = constant;
-      value_to_literal_[v] = std::move(l_ptr);
+      value_to_literal_[v] = tensorToLiteral(t);
     }
   }
+  bool hasImageInput = false;
   for (const Value* v : ir_->inputs()) {
     if (isInitialized.find(v->uniqueName()) == isInitialized.end()) {
       executor_->param_input_name_.push_back(v->uniqueName());
-      auto param = builder_.Parameter(global_param_number_++, shapeOfValue(v),
+      if (options_.stateValues.count(v->uniqueName())) {
+        --executor_->num_inputs_;
+      }
+      if (v->uniqueName() == options_.imageInput) {
+        auto imageStatus = handleImageInput(v);
+        if (imageStatus != ONNXIFI_STATUS_SUCCESS) {
+          return imageStatus;
+        }
+        hasImageInput = true;
+        continue;
+      }
+      // Inputs transferred in reduced precision are converted on the server
+      auto shape = shapeOfValue(v);
+      auto transferType = transferTypeOf(v);
+      if (transferType != xla::F32) {
+        shape.set_element_type(transferType);
+      }
+      auto param = builder_.Parameter(global_param_number_++, shape,
                                       v->uniqueName());
+      if (transferType != xla::F32) {
+        executor_->transfer_types_[v->uniqueName()] = transferType;
+        param = builder_.ConvertElementType(param, xla::F32);
+      }
       value_to_op_[v] = param;
       executor_->io_data_type_[v->uniqueName()] = v->elemType();
       executor_->io_shape_[v->uniqueName()] = v->sizes();
     }
   }
+  if (!options_.imageInput.empty() && !hasImageInput) {
+    std::cerr << "No runtime input named " << options_.imageInput << std::endl;
+    return ONNXIFI_STATUS_INVALID_NAME;
+  }
+  return ONNXIFI_STATUS_SUCCESS;
+}
+
+onnxStatus XlaTransform::handleImageInput(const Value* v) {
+  const auto& mean = options_.imageMean;
+  const auto& scale = options_.imageScale;
+  auto shape = shapeOfValue(v);
+  if (v->elemType() != ONNX_NAMESPACE::TensorProto_DataType_FLOAT ||
+      ShapeUtil::Rank(shape) != 4) {
+    std::cerr << "The image input must be a float32 NCHW tensor" << std::endl;
+    return ONNXIFI_STATUS_MISMATCHING_SHAPE;
+  }
+  auto channels = static_cast<size_t>(shape.dimensions(1));
+  if ((mean.size() > 1 && mean.size() != channels) ||
+      (scale.size() > 1 && scale.size() != channels)) {
+    std::cerr << "The image normalization must have one value per channel"
+              << std::endl;
+    return ONNXIFI_STATUS_MISMATCHING_SHAPE;
+  }
+
+  // Pixels dimension i is dimension layout[i] of the model input
+  const std::vector<int64> layout = options_.imageNHWC
+                                        ? std::vector<int64>{0, 2, 3, 1}
+                                        : std::vector<int64>{0, 1, 2, 3};
+  std::vector<Dimension> pixelSizes;
+  std::vector<int64> pixelDims;
+  for (auto d : layout) {
+    pixelSizes.push_back(v->sizes()[d]);
+    pixelDims.push_back(shape.dimensions(d));
+  }
+  auto imageOp = builder_.ConvertElementType(
+      builder_.Parameter(global_param_number_++,
+                         ShapeUtil::MakeShape(xla::U8, pixelDims),
+                         v->uniqueName()),
+      xla::F32);
+  if (options_.imageNHWC) {
+    imageOp = builder_.Transpose(imageOp, {0, 3, 1, 2});
+  }
+  if (mean.size() == 1) {
+    imageOp = builder_.Sub(imageOp, builder_.ConstantR0<float>(mean[0]));
+  } else if (!mean.empty()) {
+    imageOp = builder_.Sub(imageOp, builder_.ConstantR1<float>(mean), {1});
+  }
+  if (scale.size() == 1) {
+    imageOp = builder_.Div(imageOp, builder_.ConstantR0<float>(scale[0]));
+  } else if (!scale.empty()) {
+    imageOp = builder_.Div(imageOp, builder_.ConstantR1<float>(scale), {1});
+  }
+  value_to_op_[v] = imageOp;
+  executor_->transfer_types_[v->uniqueName()] = xla::U8;
+  executor_->io_data_type_[v->uniqueName()] =
+      ONNX_NAMESPACE::TensorProto_DataType_UINT8;
+  executor_->io_shape_[v->uniqueName()] = pixelSizes;
   return ONNXIFI_STATUS_SUCCESS;
 }
 
@@ -301,10 +883,49 @@ onnxStatus XlaTransform::handleOutputs() {
   for (const Value* v : ir_->outputs()) {
     executor_->io_data_type_[v->uniqueName()] = v->elemType();
     executor_->io_shape_[v->uniqueName()] = v->sizes();
-    retOps.push_back(value_to_op_[v]);
+    materializeConstant(v);
+    auto retOp = value_to_op_[v];
+    auto transferType = transferTypeOf(v);
+    if (transferType != xla::F32) {
+      executor_->transfer_types_[v->uniqueName()] = transferType;
+      retOp = builder_.ConvertElementType(retOp, transferType);
+    }
+    retOps.push_back(retOp);
     executor_->output_names_.push_back(v->uniqueName());
   }
-  builder_.Tuple(retOps);
+  for (const auto& state : options_.stateValues) {
+    const auto& outputs = executor_->output_names_;
+    auto outputIt = std::find(outputs.begin(), outputs.end(), state.second);
+    const auto& inputs = executor_->param_input_name_;
+    if (outputIt == outputs.end() ||
+        std::find(inputs.begin(), inputs.end(), state.first) == inputs.end()) {
+      std::cerr << "No runtime input " << state.first << " and output "
+                << state.second << " for the state" << std::endl;
+      return ONNXIFI_STATUS_INVALID_NAME;
+    }
+    if (!ShapeUtil::Equal(executor_->ioShape(state.first),
+                          executor_->ioShape(state.second))) {
+      std::cerr << "The state " << state.first
+                << " must have the type and shape of " << state.second
+                << std::endl;
+      return ONNXIFI_STATUS_MISMATCHING_SHAPE;
+    }
+    size_t outputIndex = outputIt - outputs.begin();
+    for (const auto& other : executor_->state_outputs_) {
+      if (other.second == outputIndex) {
+        std::cerr << "States " << other.first << " and " << state.first
+                  << " share an output" << std::endl;
+        return ONNXIFI_STATUS_INVALID_NAME;
+      }
+    }
+    executor_->state_outputs_[state.first] = outputIndex;
+  }
+  // The last op built is the root. A single output is returned without a
+  // tuple wrapper (the tuple is simplified away by the compiler).
+  auto tupleOp = builder_.Tuple(retOps);
+  if (retOps.size() == 1) {
+    builder_.GetTupleElement(tupleOp, 0);
+  }
   return ONNXIFI_STATUS_SUCCESS;
 }
 
@@ -313,10 +934,15 @@ onnxStatus XlaTransform::translateGraph() {
   if (handleInputsStatus != ONNXIFI_STATUS_SUCCESS) {
     return handleInputsStatus;
   }
+  pass_stats_ =
+      optimizeGraph(*ir_, value_to_literal_, options_, opset_versions_);
   auto& registry = OperatorRegistry::registry();
   for (auto it = ir_->begin(); it != ir_->end(); ++it) {
-    auto translateStatus =
-        registry.translate(**it, builder_, value_to_op_, value_to_literal_);
+    for (const Value* v : (*it)->inputs()) {
+      materializeConstant(v);
+    }
+    auto translateStatus = registry.translate(
+        **it, builder_, value_to_op_, value_to_literal_, opset_versions_);
     if (translateStatus != ONNXIFI_STATUS_SUCCESS) {
       return translateStatus;
     }
@@ -331,6 +957,9 @@ onnxStatus XlaTransform::translateGraph() {
     throw std::runtime_error("The graph was not able to be built");
   }
   executor_->computation_ = computation_status.ConsumeValueOrDie();
+  if (options_.pipelineDepth) {
+    executor_->startPipeline(options_.pipelineDepth);
+  }
   return ONNXIFI_STATUS_SUCCESS;
 }
 
@@ -338,11 +967,16 @@ XlaExecutor* XlaTransform::executor() {
   return executor_.release();
 }
 
+const PassStats& XlaTransform::passStats() const {
+  return pass_stats_;
+}
+
 OnnxParser::OnnxParser(const void* serializedModel, size_t serializedModelSize)
     : serialized_model_(serializedModel),
       serialized_model_size_(serializedModelSize) {}
 
-onnxStatus OnnxParser::parse(std::unique_ptr<Graph>& ir) {
+onnxStatus OnnxParser::parse(std::unique_ptr<Graph>& ir,
+                             OpsetVersionMap& opsetVersions) {
   ModelProto deserializedModel;
   if (!ONNX_NAMESPACE::ParseProtoFromBytes(&deserializedModel,
                                            (const char*)serialized_model_,
@@ -352,6 +986,10 @@ onnxStatus OnnxParser::parse(std::unique_ptr<Graph>& ir) {
   try {
     ONNX_NAMESPACE::shape_inference::InferShapes(deserializedModel);
     ir = ONNX_NAMESPACE::ImportModelProto(deserializedModel);
+    for (const auto& opset : deserializedModel.opset_import()) {
+      opsetVersions[opset.domain() == "ai.onnx" ? "" : opset.domain()] =
+          opset.version();
+    }
     return ONNXIFI_STATUS_SUCCESS;
   } catch (const std::exception& e) {
     std::cerr << e.what() << std::endl;
@@ -360,5 +998,4 @@ onnxStatus OnnxParser::parse(std::unique_ptr<Graph>& ir) {
     return ONNXIFI_STATUS_INVALID_MODEL;
   }
 }
-#undef SWITCH
 }
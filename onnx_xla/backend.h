@@ -12,10 +12,17 @@
 #include "tensorflow/compiler/xla/rpc/xla_service.grpc.pb.h"
 #include <grpcpp/grpcpp.h>
 
+#include "onnx_xla/bounded_queue.h"
+#include "onnx_xla/onnx_xla_extensions.h"
 #include "onnx_xla/utils.h"
 #include "onnx_xla/operator_registry.h"
+#include "onnx_xla/passes/graph_passes.h"
 
+#include <future>
 #include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
 
 namespace onnx_xla {
 using ::xla::GlobalData;
@@ -28,18 +35,89 @@ class XlaTransform;
 class XlaExecutor;
 class OnnxParser;
 
+// Bytes of inputs and outputs transferred between client and server by a run,
+// and bytes saved by reduced precision transfers (see
+// ONNX_XLA_GRAPH_PROPERTY_TRANSFER_PRECISION)
+struct TransferStats {
+  uint64_t inputBytes = 0;
+  uint64_t outputBytes = 0;
+  uint64_t savedBytes = 0;
+};
+
+// Tensor kept on the XLA server, bound to graph inputs and outputs with the
+// ONNX_XLA_MEMORY_TYPE_XLA_DATA memory type (empty until an output fills it)
+struct XlaData {
+  std::unique_ptr<GlobalData> data;
+  Shape shape;
+};
+
+// Buffers bound to the inputs and outputs of a graph, by initIO or as an IO
+// slot (see XlaExecutor::addIOSlot)
+struct IOBinding {
+  std::unordered_map<std::string, onnxPointer> inputBuffers;
+  std::unordered_map<std::string, onnxPointer> outputBuffers;
+  // Names of the inputs and outputs whose buffers are XlaData handles
+  std::unordered_set<std::string> dataHandles;
+  // Names of the inputs whose buffers were allocated by the backend (see
+  // buffer_allocator.h), transferred without staging copies
+  std::unordered_set<std::string> borrowedInputs;
+};
+
+// Inputs of an IOBinding transferred to the server, in parameter order (null
+// for state inputs and XlaData handles), and the bytes transferred. status is
+// that of the wait on the input event of a prefetch, if it failed.
+struct UploadedInputs {
+  std::vector<std::unique_ptr<GlobalData>> data;
+  TransferStats stats;
+  onnxStatus status = ONNXIFI_STATUS_SUCCESS;
+};
+
+// IO slot: a binding validated once, and the transfer of its inputs started
+// by XlaExecutor::prefetchSlot, if any, taken by its next run
+struct IOSlot {
+  IOBinding binding;
+  std::future<UploadedInputs> prefetched;
+};
+
+// Run in flight in the run pipeline (see GraphOptions::pipelineDepth), filled
+// by its stages in turn
+struct PipelineRun {
+  // Copy of the buffers bound when the run was queued
+  IOBinding binding;
+  onnxEvent inputEvent;
+  onnxEvent outputEvent;
+  // First failure of a stage; the later stages skip the run
+  onnxStatus status = ONNXIFI_STATUS_SUCCESS;
+  // Transfer of the inputs started by prefetchSlot, if any
+  std::future<UploadedInputs> prefetched;
+  // Inputs converted on the host, in parameter order (null for the inputs not
+  // transferred), then on the server
+  std::vector<std::unique_ptr<xla::LiteralBase>> inputLiterals;
+  UploadedInputs uploaded;
+  // Outputs to transfer from the server, their data there, and then their
+  // literals (in the order of fetched)
+  std::vector<size_t> fetched;
+  std::vector<std::shared_ptr<GlobalData>> outputData;
+  std::vector<std::unique_ptr<Literal>> outputLiterals;
+  TransferStats stats;
+};
+
 // Engine to execute an XlaComputation constructed by XlaTransform. The
 // computation_ is filled by the XlaTransform object. To run, call initIO
 // to verify IO metadata and to declare IO locations. Once IO data is
 // present, execute executeComputation to run. If successful, output
-// tensors will be present at the output_buffers_ pointers.
+// tensors will be present in the bound output buffers.
 
 class XlaExecutor final {
  public:
   // Constructor initialized with backend handle
   XlaExecutor(onnxBackend backend);
+  // Waits for the runs in the pipeline, if any
+  ~XlaExecutor();
 
-  // Used to pass IO metadata and locations to the engine
+  // Used to pass IO metadata and locations to the engine. outputDescriptors
+  // may list a subset of the outputs, and their buffers may be null: only the
+  // outputs with a buffer are transferred from the server.
   onnxStatus initIO(uint32_t inputsCount,
                     const onnxTensorDescriptorV1* inputDescriptors,
                     uint32_t outputsCount,
@@ -52,6 +130,46 @@ class XlaExecutor final {
   onnxStatus executeComputation(const onnxMemoryFenceV1* inputFence,
                                 onnxMemoryFenceV1* outputFence);
 
+  // Binds the buffers of the descriptors (as initIO) to a new IO slot, and
+  // returns its index in slot. Must not be called while the graph runs.
+  onnxStatus addIOSlot(uint32_t inputsCount,
+                       const onnxTensorDescriptorV1* inputDescriptors,
+                       uint32_t outputsCount,
+                       const onnxTensorDescriptorV1* outputDescriptors,
+                       uint32_t* slot);
+
+  // Starts transferring the inputs of slot to the server on another thread,
+  // e.g. while the previous slot runs, once the event of inputFence
+  // (initialized) is signalled. Does nothing if a transfer is pending.
+  onnxStatus prefetchSlot(uint32_t slot, const onnxMemoryFenceV1* inputFence);
+
+  // Whether slot was returned by addIOSlot
+  bool hasSlot(uint32_t slot) const;
+
+  // As executeComputation, on the buffers of slot
+  onnxStatus executeSlot(uint32_t slot,
+                         const onnxMemoryFenceV1* inputFence,
+                         onnxMemoryFenceV1* outputFence);
+
+  // What the last executeComputation transferred (with the pipeline, the
+  // last run whose output fence was signalled)
+  TransferStats transferStats() const;
+
+  // Status of the run whose output fence has event outputEvent, once it is
+  // signalled: with the pipeline, the failure of one of its stages, if any
+  // (runs otherwise return their failure). Forgets the failure.
+  onnxStatus runStatus(onnxEvent outputEvent);
+
+  // Sets the persistent state inputs named by the descriptors to their
+  // buffers, and the other state inputs to zero
+  onnxStatus resetState(uint32_t stateCount,
+                        const onnxTensorDescriptorV1* stateDescriptors);
+
+  // Copies the persistent state inputs named by the descriptors to their
+  // buffers
+  onnxStatus snapshotState(uint32_t stateCount,
+                           const onnxTensorDescriptorV1* stateDescriptors);
+
   // backend handle
   const onnxBackend backend_;
 
@@ -67,8 +185,8 @@ class XlaExecutor final {
   std::unordered_map<std::string, ONNX_NAMESPACE::TensorProto_DataType>
       io_data_type_;
   std::unordered_map<std::string, std::vector<Dimension>> io_shape_;
-  std::unordered_map<std::string, onnxPointer> input_buffers_;
-  std::unordered_map<std::string, onnxPointer> output_buffers_;
+  // Buffers of initIO
+  IOBinding io_;
 
   // Mapping of parameter number to input name; use to fill arguments_ in the
   // correct order
@@ -77,9 +195,122 @@ class XlaExecutor final {
   // Used to copy output returned from XLA to output buffers
   std::vector<std::string> output_names_;
 
-  // Helper functions to translate tensors, inputs, and weights to literals
-  std::unique_ptr<Literal> tensorToLiteral(const Tensor& t);
-  std::unique_ptr<Literal> inputNameToLiteral(const std::string& name);
+  // Type of the float32 inputs and outputs transferred in another type
+  // (float16 or bfloat16, or uint8 for the image input), keyed on name
+  std::unordered_map<std::string, PrimitiveType> transfer_types_;
+
+  // Guards transfer_stats_, written by the last stage of the pipeline
+  mutable std::mutex stats_mutex_;
+  TransferStats transfer_stats_;
+
+  // Persistent state inputs (see GraphOptions::stateValues): index in
+  // output_names_ of the output giving the next value of each, and their
+  // current values on the server (missing for zero), keyed on name
+  std::unordered_map<std::string, size_t> state_outputs_;
+  std::unordered_map<std::string, std::shared_ptr<GlobalData>> state_data_;
+
+  // IO slots of addIOSlot. Last, so pending prefetches finish before the
+  // members they read are destroyed.
+  std::vector<std::unique_ptr<IOSlot>> slots_;
+
+  // Run pipeline (see startPipeline): the queue feeding each stage, the
+  // thread of each stage, and the failures of the finished runs until
+  // runStatus returns them, keyed on output event. Empty unless started.
+  using RunQueue = BoundedQueue<std::unique_ptr<PipelineRun>>;
+  std::vector<std::unique_ptr<RunQueue>> pipeline_queues_;
+  std::vector<std::thread> pipeline_threads_;
+  std::mutex run_status_mutex_;
+  std::unordered_map<onnxEvent, onnxStatus> run_status_;
+
+  // Verifies the tag, data type, shape and memory type of a descriptor of
+  // input or output
+  onnxStatus checkDescriptor(const onnxTensorDescriptorV1& d);
+
+  // Verifies the descriptors and binds their buffers to binding
+  onnxStatus bindIO(uint32_t inputsCount,
+                    const onnxTensorDescriptorV1* inputDescriptors,
+                    uint32_t outputsCount,
+                    const onnxTensorDescriptorV1* outputDescriptors,
+                    IOBinding& binding);
+
+  // Transfers the inputs bound in binding to the server. Only reads the IO
+  // metadata, so it may run on another thread while the graph runs.
+  UploadedInputs uploadInputs(const IOBinding& binding) const;
+
+  // Whether runs transfer input name of binding from its buffer (all but
+  // state inputs and XlaData handles)
+  bool transfersInput(const IOBinding& binding, const std::string& name) const;
+
+  // Literal of input name of binding, adding its size to stats
+  std::unique_ptr<xla::LiteralBase> inputLiteral(const IOBinding& binding,
+                                                 const std::string& name,
+                                                 TransferStats& stats) const;
+
+  // Fills the arguments of the computation, in parameter order
+  onnxStatus resolveArguments(const IOBinding& binding,
+                              const UploadedInputs& uploaded,
+                              std::vector<GlobalData*>& arguments);
+
+  // Indices of the outputs to transfer from the server, and of the outputs
+  // bound to XlaData handles
+  void selectOutputs(const IOBinding& binding,
+                     std::vector<size_t>& fetched,
+                     std::vector<size_t>& kept) const;
+
+  // Runs the computation keeping its result on the server, moves the kept
+  // and state outputs, and returns the data of the outputs (empty if none is
+  // used)
+  std::vector<std::shared_ptr<GlobalData>> executeOnServer(
+      const IOBinding& binding,
+      const std::vector<GlobalData*>& arguments,
+      const std::vector<size_t>& fetched,
+      const std::vector<size_t>& kept);
+
+  // Copies output i, at index of result, to its buffer in binding
+  void copyOutput(const IOBinding& binding,
+                  size_t i,
+                  const Literal& result,
+                  const xla::ShapeIndex& index,
+                  TransferStats& stats) const;
+
+  // Runs the computation on the buffers of binding, with the inputs of
+  // prefetched if it holds a pending transfer. With the pipeline, queues the
+  // run and returns.
+  onnxStatus run(const IOBinding& binding,
+                 std::future<UploadedInputs>* prefetched,
+                 const onnxMemoryFenceV1* inputFence,
+                 onnxMemoryFenceV1* outputFence);
+
+  // Starts the run pipeline: a thread per stage (host conversion of the
+  // inputs, upload, execution, download, copy to the output buffers), with
+  // at most depth runs queued before each stage. Consecutive runs then
+  // overlap, each stage working on a different run.
+  void startPipeline(size_t depth);
+
+  // Queues a run in the pipeline, waiting while its first queue is full
+  onnxStatus enqueueRun(const IOBinding& binding,
+                        std::future<UploadedInputs>* prefetched,
+                        const onnxMemoryFenceV1* inputFence,
+                        onnxMemoryFenceV1* outputFence);
+
+  // Stages of the pipeline. The execution stage is the only one to use the
+  // state, so runs update it in order.
+  void convertStage(PipelineRun& run) const;
+  void uploadStage(PipelineRun& run) const;
+  void executeStage(PipelineRun& run);
+  void downloadStage(PipelineRun& run) const;
+  void copyStage(PipelineRun& run);
+
+  // Records the failure of run, if any, for runStatus and signals its output
+  // fence
+  void finishRun(PipelineRun& run);
+
+  // Shape of input or output name
+  Shape ioShape(const std::string& name) const;
+
+  // Helper functions to translate inputs and weights to literals
+  std::unique_ptr<Literal> inputNameToLiteral(const std::string& name,
+                                              onnxPointer buffer) const;
   std::unique_ptr<Literal> descriptorToLiteral(const onnxTensorDescriptorV1& t);
 
   friend class XlaTransform;
@@ -96,20 +327,25 @@ class XlaExecutor final {
 // done once).
 class XlaTransform final {
  public:
-  // Passes IR graph to be transformed, name of builder, and weightDescriptor
-  // info
+  // Passes IR graph to be transformed, name of builder, weightDescriptor
+  // info, the opset versions imported by the model (used to select
+  // operator translators; empty if unknown) and the build options
   // TODO: Remove build_name? or keep for debugging purposes?
   XlaTransform(onnxBackend backend,
                std::unique_ptr<Graph> ir,
                const std::string& build_name,
                uint32_t weightsCount,
-               const onnxTensorDescriptorV1* weightDescriptors);
+               const onnxTensorDescriptorV1* weightDescriptors,
+               OpsetVersionMap opsetVersions = OpsetVersionMap(),
+               GraphOptions options = GraphOptions());
   ~XlaTransform();
 
   // Fills up XlaExecutor based on the IR graph. Function accomplishes:
-  //  Initializer/weight values added as constants to the graph
+  //  Initializer/weight values recorded as constant literals
   //  Fills up executor_'s expected IO metadata, which can be verified in initIO
-  //  Translates IR graph node by node dispatching to operator registry
+  //  Runs the graph passes (see passes/graph_passes.h) on the IR graph
+  //  Translates IR graph node by node dispatching to operator registry,
+  //    adding constants to the graph when first used
   //    TODO: Fix kUndefinded translation, which is present for relu test
   //  Fills up exector_'s output names
   //  Returns status
@@ -120,10 +356,19 @@ class XlaTransform final {
   // memory must be handled by caller.
   XlaExecutor* executor();
 
+  // What the graph passes did during translateGraph
+  const PassStats& passStats() const;
+
  private:
   // IR graph to be translated
   std::unique_ptr<Graph> ir_;
 
+  // Opset versions imported by the model
+  OpsetVersionMap opset_versions_;
+
+  // Build options (e.g. mixed precision)
+  GraphOptions options_;
+
   // Weight Descriptor information
   uint32_t weights_count_;
   const onnxTensorDescriptorV1* weight_descriptors_;
@@ -142,6 +387,9 @@ class XlaTransform final {
   // Keep track of constant literals
   ValueLiteralMap value_to_literal_;
 
+  // Stats returned by the graph passes
+  PassStats pass_stats_;
+
   // Keeps track of number of parameters in computation
   //  TODO: Make local? Only used by one function
   int64 global_param_number_;
@@ -149,12 +397,23 @@ class XlaTransform final {
   // Helper to get shape of associated value
   static inline Shape shapeOfValue(const Value* v);
 
-  // Create ConstantLiteral XlaOps for initializers/weights, verifying weight
+  // Returns the type graph input or output v is transferred in
+  PrimitiveType transferTypeOf(const Value* v) const;
+
+  // Create ConstantLiteral XlaOp for v if it is a build time constant that
+  // has no XlaOp yet
+  inline void materializeConstant(const Value* v);
+
+  // Create literals for initializers/weights, verifying weight
   // descriptors;
   // Creates params for other runtime inputs
   // Fill executor_'s input metadata (type, shape) to be verified later
   onnxStatus handleInputs();
 
+  // Creates the uint8 parameter of the image input v (see
+  // GraphOptions::imageInput) and its conversion to the model input
+  onnxStatus handleImageInput(const Value* v);
+
   // Fill output_names_
   // Create output XlaOp
   // Fill executor_'s output metadata (type, shape) to be verified later
@@ -169,8 +428,8 @@ class OnnxParser {
   OnnxParser(const void* serializedModel, size_t serializedModelSize);
 
   // Deserialize to modelProto, shape inference, and conversion to IR
-  //(model validation) stored in ir
-  onnxStatus parse(std::unique_ptr<Graph>& ir);
+  //(model validation) stored in ir; opset imports stored in opsetVersions
+  onnxStatus parse(std::unique_ptr<Graph>& ir, OpsetVersionMap& opsetVersions);
 
  private:
   const void* serialized_model_;
@@ -1,7 +1,11 @@
 #include "onnx_xla/onnxifi_helper.h"
+#include "onnx_xla/buffer_allocator.h"
+#include "onnx_xla/plugin_loader.h"
 #include "onnx_xla/backend_test.h"
 #include <stdlib.h>
+#include <algorithm>
 #include <cmath>
+#include <numeric>
 
 namespace onnx_xla {
 
@@ -9,6 +13,129 @@ bool almost_equal(float a, float b, float epsilon) {
   return std::abs(a - b) < epsilon;
 }
 
+// Adds a float input of the given sizes to graph
+static Value* addFloatInput(Graph& graph,
+                            const char* name,
+                            const std::vector<Dimension>& sizes) {
+  Value* input = graph.addInput();
+  input->setElemType(ONNX_NAMESPACE::TensorProto_DataType_FLOAT);
+  input->setSizes(sizes);
+  input->setUniqueName(name);
+  return input;
+}
+
+// Appends a node of kind to graph, whose float output has the given sizes
+static Value* appendNode(Graph& graph,
+                         const char* kind,
+                         const std::vector<Value*>& inputs,
+                         const std::vector<Dimension>& sizes) {
+  auto node = graph.create(Symbol(kind), inputs);
+  graph.appendNode(node);
+  auto output = node->output();
+  output->setElemType(ONNX_NAMESPACE::TensorProto_DataType_FLOAT);
+  output->setSizes(sizes);
+  return output;
+}
+
+// Graph computing kind (e.g. Relu, Sum) of numInputs copies of one float
+// input of the given sizes
+static std::unique_ptr<Graph> makeGraph(const char* kind,
+                                        const std::vector<Dimension>& sizes,
+                                        const char* inputName,
+                                        size_t numInputs,
+                                        const char* outputName) {
+  std::unique_ptr<Graph> graph(new Graph());
+  graph->setName(std::string(kind) + "_graph");
+  auto input = addFloatInput(*graph, inputName, sizes);
+  auto output = appendNode(*graph, kind, std::vector<Value*>(numInputs, input),
+                           sizes);
+  output->setUniqueName(outputName);
+  graph->return_node()->addInput(output);
+  return graph;
+}
+
+static size_t numNodes(Graph& graph) {
+  size_t count = 0;
+  for (auto it = graph.begin(); it != graph.end(); ++it) {
+    ++count;
+  }
+  return count;
+}
+
+// Relu of relu_input into relu_output, of sizes {2, 3, 4}
+static std::unique_ptr<Graph> makeReluGraph() {
+  return makeGraph("Relu", {2, 3, 4}, "relu_input", 1, "relu_output");
+}
+
+// next_sum = Sum(input, sum), of sizes {2, 3}, with sum meant as the
+// persistent state of next_sum
+static std::unique_ptr<Graph> makeRunningSumGraph() {
+  std::unique_ptr<Graph> graph(new Graph());
+  graph->setName("running_sum_graph");
+  std::vector<Dimension> sizes = {2, 3};
+  auto input = addFloatInput(*graph, "input", sizes);
+  auto sum = addFloatInput(*graph, "sum", sizes);
+  auto next_sum = appendNode(*graph, "Sum", {input, sum}, sizes);
+  next_sum->setUniqueName("next_sum");
+  graph->return_node()->addInput(next_sum);
+  return graph;
+}
+
+// Float32 CPU descriptor of name, with a new buffer of its elements (freed
+// by freeDescriptor). shape must outlive the descriptor.
+static onnxTensorDescriptorV1 makeDescriptor(const char* name,
+                                             uint32_t dimensions,
+                                             const uint64_t* shape) {
+  onnxTensorDescriptorV1 d;
+  d.tag = ONNXIFI_TAG_TENSOR_DESCRIPTOR_V1;
+  d.name = name;
+  d.dataType = ONNXIFI_DATATYPE_FLOAT32;
+  d.memoryType = ONNXIFI_MEMORY_TYPE_CPU;
+  d.dimensions = dimensions;
+  d.shape = shape;
+  auto size = std::accumulate(shape, shape + dimensions, (uint64_t)1,
+                              std::multiplies<uint64_t>());
+  d.buffer = (onnxPointer) new float[size];
+  return d;
+}
+
+static void freeDescriptor(const onnxTensorDescriptorV1& d) {
+  delete[] reinterpret_cast<float*>(d.buffer);
+}
+
+// Signalled input fence and unsignalled output fence of a run, on events
+// owned by the struct rather than created through onnxInitEvent, as the
+// tests drive the executor without an onnxifi backend
+struct TestFences {
+  TestFences() {
+    inputEvent.signalled_ = true;
+    inputFence.tag = ONNXIFI_TAG_MEMORY_FENCE_V1;
+    inputFence.type = ONNXIFI_SYNCHRONIZATION_EVENT;
+    inputFence.event = reinterpret_cast<onnxEvent>(&inputEvent);
+    outputFence.tag = ONNXIFI_TAG_MEMORY_FENCE_V1;
+    outputFence.type = ONNXIFI_SYNCHRONIZATION_EVENT;
+    outputFence.event = reinterpret_cast<onnxEvent>(&outputEvent);
+  }
+
+  EventControl inputEvent;
+  EventControl outputEvent;
+  onnxMemoryFenceV1 inputFence;
+  onnxMemoryFenceV1 outputFence;
+};
+
+// Runs executor on its initIO buffers, or on an IO slot, and checks the
+// output fence was signalled
+static void runWithFences(XlaExecutor* executor, int slot = -1) {
+  TestFences fences;
+  auto status =
+      slot < 0 ? executor->executeComputation(&fences.inputFence,
+                                              &fences.outputFence)
+               : executor->executeSlot(slot, &fences.inputFence,
+                                       &fences.outputFence);
+  ONNX_ASSERT(status == ONNXIFI_STATUS_SUCCESS);
+  ONNX_ASSERT(fences.outputEvent.signalled_);
+}
+
 void static_relu_test() {
   // Set up IR graph
   std::unique_ptr<Graph> relu_graph(new Graph());
@@ -174,4 +301,1440 @@ void dynamic_relu_test() {
   delete inputEvent;
   delete outputEvent;
 }
+
+// Conv (1x1 kernel) followed by BatchNormalization with constant parameters
+// should be folded into a single Conv and match the unfolded result
+void conv_batchnorm_fold_test() {
+  // Set up IR graph
+  std::unique_ptr<Graph> graph(new Graph());
+  graph->setName("conv_bn_graph");
+  std::vector<Dimension> inputSizes = {1, 2, 2, 2};
+  Value* x = graph->addInput();
+  x->setElemType(ONNX_NAMESPACE::TensorProto_DataType_FLOAT);
+  x->setSizes(inputSizes);
+  x->setUniqueName("x");
+
+  auto makeTensor = [](const std::vector<float>& values,
+                       const std::vector<int64_t>& sizes) {
+    Tensor t;
+    t.elem_type() = ONNX_NAMESPACE::TensorProto_DataType_FLOAT;
+    t.floats() = values;
+    t.sizes() = sizes;
+    return t;
+  };
+  const std::vector<float> weights = {0.5f, -1.0f, 2.0f, 0.25f};
+  const std::vector<float> scale = {1.5f, -0.5f};
+  const std::vector<float> bias = {0.1f, 0.2f};
+  const std::vector<float> mean = {0.3f, -0.4f};
+  const std::vector<float> var = {2.0f, 0.5f};
+  const float epsilon = 1e-5f;
+  Value* w = graph->addInitializerAndInput(makeTensor(weights, {2, 2, 1, 1}),
+                                           "w");
+  Value* s = graph->addInitializerAndInput(makeTensor(scale, {2}), "scale");
+  Value* b = graph->addInitializerAndInput(makeTensor(bias, {2}), "bias");
+  Value* m = graph->addInitializerAndInput(makeTensor(mean, {2}), "mean");
+  Value* v = graph->addInitializerAndInput(makeTensor(var, {2}), "var");
+
+  auto conv_node = graph->create(kConv, {x, w});
+  graph->appendNode(conv_node);
+  conv_node->output()->setElemType(ONNX_NAMESPACE::TensorProto_DataType_FLOAT);
+  conv_node->output()->setSizes(inputSizes);
+  conv_node->output()->setUniqueName("conv_output");
+  auto bn_node =
+      graph->create(Symbol("BatchNormalization"),
+                    {conv_node->output(), s, b, m, v});
+  graph->appendNode(bn_node);
+  bn_node->f_(kepsilon, epsilon);
+  bn_node->output()->setElemType(ONNX_NAMESPACE::TensorProto_DataType_FLOAT);
+  bn_node->output()->setSizes(inputSizes);
+  bn_node->output()->setUniqueName("y");
+  graph->return_node()->addInput(bn_node->output());
+
+  // Set up IO information
+  uint64_t shape[4] = {1, 2, 2, 2};
+  auto input = makeDescriptor("x", 4, shape);
+  auto output = makeDescriptor("y", 4, shape);
+  float* input_ptr = (float*)input.buffer;
+  for (int i = 0; i < 8; ++i) {
+    input_ptr[i] = 0.125f * i - 0.5f;
+  }
+
+  // Execute using XLA backend, checking BatchNormalization was folded
+  XlaTransform runner(NULL, std::move(graph), "conv_bn", 0, nullptr);
+  runner.translateGraph();
+  ONNX_ASSERT(runner.passStats().at("fold_batch_normalization") == 1);
+  auto executor = runner.executor();
+  executor->initIO(1, &input, 1, &output);
+  runWithFences(executor);
+
+  // Check correctness against the unfolded computation
+  float* output_ptr = (float*)output.buffer;
+  for (int c = 0; c < 2; ++c) {
+    for (int p = 0; p < 4; ++p) {
+      float conv = weights[2 * c] * input_ptr[p] +
+                   weights[2 * c + 1] * input_ptr[4 + p];
+      float expected = (conv - mean[c]) * scale[c] /
+                           std::sqrt(var[c] + epsilon) +
+                       bias[c];
+      ONNX_ASSERT(almost_equal(expected, output_ptr[4 * c + p], 1e-4));
+    }
+  }
+
+  // Free memory
+  delete executor;
+  freeDescriptor(input);
+  freeDescriptor(output);
+}
+
+// Relu with its input and output transferred as float16: results match up to
+// float16 rounding and half of the transferred bytes are saved
+void reduced_precision_transfer_test() {
+  // Set up IO information
+  uint64_t shape[3] = {2, 3, 4};
+  auto input = makeDescriptor("relu_input", 3, shape);
+  auto output = makeDescriptor("relu_output", 3, shape);
+  float* input_ptr = (float*)input.buffer;
+  for (int i = 0; i < 24; ++i) {
+    input_ptr[i] = 0.1f * i - 1.2f;
+  }
+
+  // Execute using XLA backend
+  GraphOptions options;
+  options.transferType = xla::F16;
+  XlaTransform runner(NULL, makeReluGraph(), "relu", 0, nullptr,
+                      OpsetVersionMap(), options);
+  runner.translateGraph();
+  auto executor = runner.executor();
+  executor->initIO(1, &input, 1, &output);
+  runWithFences(executor);
+
+  // Check correctness and transferred bytes
+  float* output_ptr = (float*)output.buffer;
+  for (int i = 0; i < 24; ++i) {
+    ONNX_ASSERT(
+        almost_equal(std::max(input_ptr[i], 0.0f), output_ptr[i], 1e-3));
+  }
+  auto stats = executor->transferStats();
+  ONNX_ASSERT(stats.inputBytes == 24 * sizeof(half));
+  ONNX_ASSERT(stats.outputBytes == 24 * sizeof(half));
+  ONNX_ASSERT(stats.savedBytes == 2 * 24 * sizeof(half));
+
+  // Free memory
+  delete executor;
+  freeDescriptor(input);
+  freeDescriptor(output);
+}
+
+// Relu_output and Softmax_output of input, of sizes {2, 3, 4}
+static std::unique_ptr<Graph> makeReluSoftmaxGraph() {
+  std::unique_ptr<Graph> graph(new Graph());
+  graph->setName("relu_softmax_graph");
+  std::vector<Dimension> sizes = {2, 3, 4};
+  auto input = addFloatInput(*graph, "input", sizes);
+  for (const auto& kind : {"Relu", "Softmax"}) {
+    auto output = appendNode(*graph, kind, {input}, sizes);
+    output->setUniqueName(std::string(kind) + "_output");
+    graph->return_node()->addInput(output);
+  }
+  return graph;
+}
+
+// Relu and Softmax outputs, with only the Relu output passed to initIO: the
+// Softmax output is not transferred
+void output_selection_test() {
+  // Set up IR graph
+  auto graph = makeReluSoftmaxGraph();
+
+  // Set up IO information
+  uint64_t shape[3] = {2, 3, 4};
+  auto inputDescriptor = makeDescriptor("input", 3, shape);
+  auto outputDescriptor = makeDescriptor("Relu_output", 3, shape);
+  float* input_ptr = (float*)inputDescriptor.buffer;
+  for (int i = 0; i < 24; ++i) {
+    input_ptr[i] = 0.1f * i - 1.2f;
+  }
+
+  // Execute using XLA backend
+  XlaTransform runner(NULL, std::move(graph), "output_selection", 0, nullptr);
+  runner.translateGraph();
+  auto executor = runner.executor();
+  executor->initIO(1, &inputDescriptor, 1, &outputDescriptor);
+  runWithFences(executor);
+
+  // Check correctness and transferred bytes
+  float* output_ptr = (float*)outputDescriptor.buffer;
+  for (int i = 0; i < 24; ++i) {
+    ONNX_ASSERT(almost_equal(std::max(input_ptr[i], 0.0f), output_ptr[i]));
+  }
+  ONNX_ASSERT(executor->transferStats().outputBytes == 24 * sizeof(float));
+
+  // Free memory
+  delete executor;
+  freeDescriptor(inputDescriptor);
+  freeDescriptor(outputDescriptor);
+}
+
+// Relu and Softmax outputs, both passed to initIO: the outputs are copied
+// from the elements of the result tuple, the Softmax output from float16
+void multiple_outputs_test() {
+  // Set up IO information
+  uint64_t shape[3] = {2, 3, 4};
+  auto inputDescriptor = makeDescriptor("input", 3, shape);
+  onnxTensorDescriptorV1 outputDescriptors[2] = {
+      makeDescriptor("Relu_output", 3, shape),
+      makeDescriptor("Softmax_output", 3, shape)};
+  float* input_ptr = (float*)inputDescriptor.buffer;
+  for (int i = 0; i < 24; ++i) {
+    input_ptr[i] = 0.1f * i - 1.2f;
+  }
+
+  // Execute using XLA backend
+  GraphOptions options;
+  options.transferType = xla::F16;
+  options.transferValues = {"Softmax_output"};
+  XlaTransform runner(NULL, makeReluSoftmaxGraph(), "multiple_outputs", 0,
+                      nullptr, OpsetVersionMap(), options);
+  runner.translateGraph();
+  auto executor = runner.executor();
+  executor->initIO(1, &inputDescriptor, 2, outputDescriptors);
+  runWithFences(executor);
+
+  // Check correctness and transferred bytes: Softmax coerces the input to
+  // {2, 12} (default axis 1)
+  float* relu_ptr = (float*)outputDescriptors[0].buffer;
+  float* softmax_ptr = (float*)outputDescriptors[1].buffer;
+  for (int b = 0; b < 2; ++b) {
+    float sum = 0.0f;
+    for (int i = 12 * b; i < 12 * (b + 1); ++i) {
+      sum += std::exp(input_ptr[i]);
+    }
+    for (int i = 12 * b; i < 12 * (b + 1); ++i) {
+      ONNX_ASSERT(almost_equal(std::max(input_ptr[i], 0.0f), relu_ptr[i]));
+      ONNX_ASSERT(
+          almost_equal(std::exp(input_ptr[i]) / sum, softmax_ptr[i], 1e-3));
+    }
+  }
+  auto stats = executor->transferStats();
+  ONNX_ASSERT(stats.outputBytes == 24 * (sizeof(float) + sizeof(half)));
+
+  // Free memory
+  delete executor;
+  freeDescriptor(inputDescriptor);
+  freeDescriptor(outputDescriptors[0]);
+  freeDescriptor(outputDescriptors[1]);
+}
+
+// Running sum kept as persistent state: each run adds its input to the state
+// on the server, and the state can be read and reset between runs
+void persistent_state_test() {
+  // Set up IO information
+  uint64_t shape[2] = {2, 3};
+  auto input = makeDescriptor("input", 2, shape);
+  auto output = makeDescriptor("next_sum", 2, shape);
+  auto state = makeDescriptor("sum", 2, shape);
+  float* input_ptr = (float*)input.buffer;
+  for (int i = 0; i < 6; ++i) {
+    input_ptr[i] = (float)i;
+  }
+
+  // Execute using XLA backend
+  GraphOptions options;
+  options.stateValues["sum"] = "next_sum";
+  XlaTransform runner(NULL, makeRunningSumGraph(), "running_sum", 0, nullptr,
+                      OpsetVersionMap(), options);
+  runner.translateGraph();
+  auto executor = runner.executor();
+  ONNX_ASSERT(executor->initIO(1, &input, 1, &output) ==
+              ONNXIFI_STATUS_SUCCESS);
+
+  // Check correctness: the state only crosses the wire when read or reset
+  float* output_ptr = (float*)output.buffer;
+  float* state_ptr = (float*)state.buffer;
+  for (int step = 1; step <= 3; ++step) {
+    runWithFences(executor);
+    for (int i = 0; i < 6; ++i) {
+      ONNX_ASSERT(almost_equal(step * input_ptr[i], output_ptr[i]));
+    }
+    ONNX_ASSERT(executor->transferStats().inputBytes == 6 * sizeof(float));
+  }
+  ONNX_ASSERT(executor->snapshotState(1, &state) == ONNXIFI_STATUS_SUCCESS);
+  for (int i = 0; i < 6; ++i) {
+    ONNX_ASSERT(almost_equal(3 * input_ptr[i], state_ptr[i]));
+    state_ptr[i] = 1.0f;
+  }
+  ONNX_ASSERT(executor->resetState(1, &state) == ONNXIFI_STATUS_SUCCESS);
+  runWithFences(executor);
+  for (int i = 0; i < 6; ++i) {
+    ONNX_ASSERT(almost_equal(input_ptr[i] + 1.0f, output_ptr[i]));
+  }
+  // A reset naming a non state input fails and keeps the state
+  onnxTensorDescriptorV1 invalid_reset[2] = {state, input};
+  ONNX_ASSERT(executor->resetState(2, invalid_reset) ==
+              ONNXIFI_STATUS_INVALID_NAME);
+  runWithFences(executor);
+  for (int i = 0; i < 6; ++i) {
+    ONNX_ASSERT(almost_equal(2 * input_ptr[i] + 1.0f, output_ptr[i]));
+  }
+  ONNX_ASSERT(executor->resetState(0, nullptr) == ONNXIFI_STATUS_SUCCESS);
+  runWithFences(executor);
+  for (int i = 0; i < 6; ++i) {
+    ONNX_ASSERT(almost_equal(input_ptr[i], output_ptr[i]));
+  }
+
+  // Free memory
+  delete executor;
+  freeDescriptor(input);
+  freeDescriptor(output);
+  freeDescriptor(state);
+}
+
+// Relu graph whose output stays on the server in an XlaData handle, bound as
+// the input of a second graph computing Sum(hidden, hidden)
+void chained_graphs_test() {
+  // Set up IO information
+  std::vector<Dimension> sizes = {2, 3};
+  uint64_t shape[2] = {2, 3};
+  auto input = makeDescriptor("input", 2, shape);
+  XlaData hidden_data;
+  onnxTensorDescriptorV1 hidden = input;
+  hidden.name = "hidden";
+  hidden.memoryType = ONNX_XLA_MEMORY_TYPE_XLA_DATA;
+  hidden.buffer = (onnxPointer)&hidden_data;
+  auto output = makeDescriptor("output", 2, shape);
+  float* input_ptr = (float*)input.buffer;
+  for (int i = 0; i < 6; ++i) {
+    input_ptr[i] = (float)i - 2.5f;
+  }
+
+  // Execute using XLA backend
+  XlaTransform reluRunner(NULL, makeGraph("Relu", sizes, "input", 1, "hidden"),
+                          "relu", 0, nullptr);
+  reluRunner.translateGraph();
+  auto reluExecutor = reluRunner.executor();
+  ONNX_ASSERT(reluExecutor->initIO(1, &input, 1, &hidden) ==
+              ONNXIFI_STATUS_SUCCESS);
+  XlaTransform sumRunner(NULL, makeGraph("Sum", sizes, "hidden", 2, "output"),
+                         "sum", 0, nullptr);
+  sumRunner.translateGraph();
+  auto sumExecutor = sumRunner.executor();
+  ONNX_ASSERT(sumExecutor->initIO(1, &hidden, 1, &output) ==
+              ONNXIFI_STATUS_SUCCESS);
+  runWithFences(reluExecutor);
+  runWithFences(sumExecutor);
+
+  // Check correctness: the hidden tensor never crossed the wire
+  float* output_ptr = (float*)output.buffer;
+  for (int i = 0; i < 6; ++i) {
+    ONNX_ASSERT(almost_equal(2 * std::max(input_ptr[i], 0.0f), output_ptr[i]));
+  }
+  ONNX_ASSERT(reluExecutor->transferStats().outputBytes == 0);
+  ONNX_ASSERT(sumExecutor->transferStats().inputBytes == 0);
+
+  // Free memory
+  delete reluExecutor;
+  delete sumExecutor;
+  freeDescriptor(input);
+  freeDescriptor(output);
+}
+
+// Relu with its input in a buffer of the backend allocator, transferred
+// without a staging copy
+void backend_buffer_test() {
+  // Set up IO information
+  uint64_t shape[3] = {2, 3, 4};
+  float* input_ptr = (float*)allocateBuffer(24 * sizeof(float),
+                                            ONNX_XLA_BUFFER_HUGE_PAGES);
+  ONNX_ASSERT(input_ptr);
+  ONNX_ASSERT((uintptr_t)input_ptr % kBufferAlignment == 0);
+  // Too small for huge pages: the size is only rounded up to the alignment
+  ONNX_ASSERT(isBackendBuffer(input_ptr, 2 * kBufferAlignment));
+  ONNX_ASSERT(!isBackendBuffer(input_ptr, 2 * kBufferAlignment + 1));
+  ONNX_ASSERT(isBackendBuffer(input_ptr + 12, 12 * sizeof(float)));
+  ONNX_ASSERT(!isBackendBuffer(&shape, sizeof(shape)));
+  auto output = makeDescriptor("relu_output", 3, shape);
+  onnxTensorDescriptorV1 input = output;
+  input.name = "relu_input";
+  input.buffer = (onnxPointer)input_ptr;
+  for (int i = 0; i < 24; ++i) {
+    input_ptr[i] = 0.1f * i - 1.2f;
+  }
+
+  // Execute using XLA backend
+  XlaTransform runner(NULL, makeReluGraph(), "relu", 0, nullptr);
+  runner.translateGraph();
+  auto executor = runner.executor();
+  executor->initIO(1, &input, 1, &output);
+  runWithFences(executor);
+
+  // Check correctness
+  float* output_ptr = (float*)output.buffer;
+  for (int i = 0; i < 24; ++i) {
+    ONNX_ASSERT(almost_equal(std::max(input_ptr[i], 0.0f), output_ptr[i]));
+  }
+
+  // Free memory
+  delete executor;
+  ONNX_ASSERT(freeBuffer(input_ptr));
+  freeDescriptor(output);
+}
+
+// Relu run on two IO slots in turn, the inputs of each slot transferred while
+// the other one runs
+void io_slots_test() {
+  // Set up IO information, one input and output per slot
+  uint64_t shape[3] = {2, 3, 4};
+  onnxTensorDescriptorV1 inputs[2];
+  onnxTensorDescriptorV1 outputs[2];
+  for (int s = 0; s < 2; ++s) {
+    inputs[s] = makeDescriptor("relu_input", 3, shape);
+    outputs[s] = makeDescriptor("relu_output", 3, shape);
+  }
+
+  // Execute using XLA backend
+  XlaTransform runner(NULL, makeReluGraph(), "relu", 0, nullptr);
+  runner.translateGraph();
+  auto executor = runner.executor();
+  uint32_t slots[2];
+  for (int s = 0; s < 2; ++s) {
+    ONNX_ASSERT(executor->addIOSlot(1, &inputs[s], 1, &outputs[s],
+                                    &slots[s]) == ONNXIFI_STATUS_SUCCESS);
+    ONNX_ASSERT(slots[s] == s);
+  }
+  ONNX_ASSERT(executor->hasSlot(1) && !executor->hasSlot(2));
+  TestFences prefetchFences[2];
+  ONNX_ASSERT(executor->prefetchSlot(2, &prefetchFences[0].inputFence) ==
+              ONNXIFI_STATUS_INVALID_ID);
+
+  // Three rounds over both slots, prefetching the next slot before filling
+  // it: the transfer waits for the input event, signalled once it is filled
+  auto fill = [&](int s, int round) {
+    float* input_ptr = (float*)inputs[s].buffer;
+    for (int i = 0; i < 24; ++i) {
+      input_ptr[i] = 0.1f * i - 1.2f + round + s;
+    }
+  };
+  fill(0, 0);
+  for (int round = 0; round < 3; ++round) {
+    for (int s = 0; s < 2; ++s) {
+      int next = 1 - s;
+      // The previous prefetch of next was taken by its last run
+      prefetchFences[next].inputEvent.signalled_ = false;
+      ONNX_ASSERT(executor->prefetchSlot(slots[next],
+                                         &prefetchFences[next].inputFence) ==
+                  ONNXIFI_STATUS_SUCCESS);
+      fill(next, s ? round + 1 : round);
+      ONNX_ASSERT(onnxSignalEvent(prefetchFences[next].inputFence.event) ==
+                  ONNXIFI_STATUS_SUCCESS);
+      runWithFences(executor, slots[s]);
+
+      // Check correctness
+      float* output_ptr = (float*)outputs[s].buffer;
+      for (int i = 0; i < 24; ++i) {
+        ONNX_ASSERT(almost_equal(
+            std::max(0.1f * i - 1.2f + round + s, 0.0f), output_ptr[i]));
+      }
+    }
+  }
+
+  // Free memory
+  delete executor;
+  for (int s = 0; s < 2; ++s) {
+    freeDescriptor(inputs[s]);
+    freeDescriptor(outputs[s]);
+  }
+}
+
+// Running sum (see persistent_state_test) run through the pipeline: runs on
+// eight IO slots are queued before waiting for any of them, more than the
+// stages hold at depth 1, and the state shows they execute in order
+void pipelined_runs_test() {
+  // Set up IO information, one input and output per slot
+  const int numRuns = 8;
+  uint64_t shape[2] = {2, 3};
+  onnxTensorDescriptorV1 inputs[numRuns];
+  onnxTensorDescriptorV1 outputs[numRuns];
+  for (int s = 0; s < numRuns; ++s) {
+    inputs[s] = makeDescriptor("input", 2, shape);
+    outputs[s] = makeDescriptor("next_sum", 2, shape);
+    float* input_ptr = (float*)inputs[s].buffer;
+    for (int i = 0; i < 6; ++i) {
+      input_ptr[i] = (float)((s + 1) * i);
+    }
+  }
+
+  // Execute using XLA backend
+  GraphOptions options;
+  options.stateValues["sum"] = "next_sum";
+  options.pipelineDepth = 1;
+  XlaTransform runner(NULL, makeRunningSumGraph(), "running_sum", 0, nullptr,
+                      OpsetVersionMap(), options);
+  runner.translateGraph();
+  auto executor = runner.executor();
+  uint32_t slots[numRuns];
+  for (int s = 0; s < numRuns; ++s) {
+    ONNX_ASSERT(executor->addIOSlot(1, &inputs[s], 1, &outputs[s],
+                                    &slots[s]) == ONNXIFI_STATUS_SUCCESS);
+  }
+
+  // Queue a run per slot; the last ones wait for room in the pipeline
+  TestFences fences[numRuns];
+  for (int s = 0; s < numRuns; ++s) {
+    ONNX_ASSERT(executor->executeSlot(slots[s], &fences[s].inputFence,
+                                      &fences[s].outputFence) ==
+                ONNXIFI_STATUS_SUCCESS);
+  }
+
+  // Check correctness: run s adds (s + 1) * i to the sum
+  for (int s = 0; s < numRuns; ++s) {
+    ONNX_ASSERT(onnxWaitEvent(fences[s].outputFence.event) ==
+                ONNXIFI_STATUS_SUCCESS);
+    ONNX_ASSERT(executor->runStatus(fences[s].outputFence.event) ==
+                ONNXIFI_STATUS_SUCCESS);
+    float* output_ptr = (float*)outputs[s].buffer;
+    for (int i = 0; i < 6; ++i) {
+      ONNX_ASSERT(almost_equal((s + 1) * (s + 2) / 2 * i, output_ptr[i]));
+    }
+  }
+
+  // Free memory
+  delete executor;
+  for (int s = 0; s < numRuns; ++s) {
+    freeDescriptor(inputs[s]);
+    freeDescriptor(outputs[s]);
+  }
+}
+
+// Pipelined Relu runs around a run whose input is an empty XlaData handle:
+// its fence is signalled with the failure kept for it, and the runs around it
+// succeed
+void pipelined_run_failure_test() {
+  // Set up IO information: slot 0 on buffers, slot 1 on an empty handle
+  uint64_t shape[3] = {2, 3, 4};
+  auto input = makeDescriptor("relu_input", 3, shape);
+  auto output = makeDescriptor("relu_output", 3, shape);
+  XlaData empty_data;
+  onnxTensorDescriptorV1 empty = input;
+  empty.memoryType = ONNX_XLA_MEMORY_TYPE_XLA_DATA;
+  empty.buffer = (onnxPointer)&empty_data;
+  auto unused = makeDescriptor("relu_output", 3, shape);
+  float* input_ptr = (float*)input.buffer;
+  for (int i = 0; i < 24; ++i) {
+    input_ptr[i] = 0.1f * i - 1.2f;
+  }
+
+  // Execute using XLA backend
+  GraphOptions options;
+  options.pipelineDepth = 2;
+  XlaTransform runner(NULL, makeReluGraph(), "relu", 0, nullptr,
+                      OpsetVersionMap(), options);
+  runner.translateGraph();
+  auto executor = runner.executor();
+  uint32_t slots[2];
+  ONNX_ASSERT(executor->addIOSlot(1, &input, 1, &output, &slots[0]) ==
+              ONNXIFI_STATUS_SUCCESS);
+  ONNX_ASSERT(executor->addIOSlot(1, &empty, 1, &unused, &slots[1]) ==
+              ONNXIFI_STATUS_SUCCESS);
+
+  // The failing run is queued between two good ones
+  uint32_t order[3] = {slots[0], slots[1], slots[0]};
+  TestFences fences[3];
+  for (int r = 0; r < 3; ++r) {
+    ONNX_ASSERT(executor->executeSlot(order[r], &fences[r].inputFence,
+                                      &fences[r].outputFence) ==
+                ONNXIFI_STATUS_SUCCESS);
+  }
+  for (int r = 0; r < 3; ++r) {
+    ONNX_ASSERT(onnxWaitEvent(fences[r].outputFence.event) ==
+                ONNXIFI_STATUS_SUCCESS);
+  }
+
+  // Check each run reports its own status, once
+  ONNX_ASSERT(executor->runStatus(fences[0].outputFence.event) ==
+              ONNXIFI_STATUS_SUCCESS);
+  ONNX_ASSERT(executor->runStatus(fences[1].outputFence.event) ==
+              ONNXIFI_STATUS_INVALID_STATE);
+  ONNX_ASSERT(executor->runStatus(fences[1].outputFence.event) ==
+              ONNXIFI_STATUS_SUCCESS);
+  ONNX_ASSERT(executor->runStatus(fences[2].outputFence.event) ==
+              ONNXIFI_STATUS_SUCCESS);
+
+  // Check correctness of the last run
+  float* output_ptr = (float*)output.buffer;
+  for (int i = 0; i < 24; ++i) {
+    ONNX_ASSERT(almost_equal(std::max(input_ptr[i], 0.0f), output_ptr[i]));
+  }
+
+  // Free memory
+  delete executor;
+  freeDescriptor(input);
+  freeDescriptor(output);
+  freeDescriptor(unused);
+}
+
+// Squeeze and Unsqueeze taking their axes as an input (opset 13) fold; nodes
+// with invalid constant inputs are left for translation instead of throwing
+void fold_squeeze_unsqueeze_test() {
+  // Set up IR graph computing Unsqueeze(Squeeze(x, [0]), [-1]) of a constant
+  // x, and Squeeze(x, float axes) and Reshape(x, [0, 0, 0]), which cannot fold
+  std::unique_ptr<Graph> graph(new Graph());
+  graph->setName("fold_squeeze_graph");
+  ValueLiteralMap valueToLiteral;
+  auto addInitializer = [&](const char* name, int32_t elemType,
+                            const std::vector<float>& values) {
+    Tensor t;
+    t.elem_type() = elemType;
+    t.sizes().push_back(values.size());
+    for (auto value : values) {
+      if (elemType == ONNX_NAMESPACE::TensorProto_DataType_INT64) {
+        t.int64s().push_back((int64_t)value);
+      } else {
+        t.floats().push_back(value);
+      }
+    }
+    auto v = graph->addInitializerAndInput(t, name);
+    valueToLiteral[v] = tensorToLiteral(t);
+    return v;
+  };
+  Tensor x_tensor;
+  x_tensor.elem_type() = ONNX_NAMESPACE::TensorProto_DataType_FLOAT;
+  x_tensor.sizes() = {1, 3};
+  x_tensor.floats() = {1.0f, 2.0f, 3.0f};
+  auto x = graph->addInitializerAndInput(x_tensor, "x");
+  valueToLiteral[x] = tensorToLiteral(x_tensor);
+  auto first_axes =
+      addInitializer("first_axes", ONNX_NAMESPACE::TensorProto_DataType_INT64,
+                     {0.0f});
+  auto last_axes =
+      addInitializer("last_axes", ONNX_NAMESPACE::TensorProto_DataType_INT64,
+                     {-1.0f});
+  auto float_axes =
+      addInitializer("float_axes", ONNX_NAMESPACE::TensorProto_DataType_FLOAT,
+                     {0.0f});
+  auto shape = addInitializer(
+      "shape", ONNX_NAMESPACE::TensorProto_DataType_INT64, {0.0f, 0.0f, 0.0f});
+  auto squeezed = appendNode(*graph, "Squeeze", {x, first_axes}, {3});
+  auto y = appendNode(*graph, "Unsqueeze", {squeezed, last_axes}, {3, 1});
+  auto z = appendNode(*graph, "Squeeze", {x, float_axes}, {3});
+  auto w = appendNode(*graph, "Reshape", {x, shape}, {1, 3, 1});
+  for (Value* output : {y, z, w}) {
+    graph->return_node()->addInput(output);
+  }
+
+  // Check the Squeeze and Unsqueeze are replaced by Constants and the others
+  // are kept
+  ONNX_ASSERT(foldConstants(*graph, valueToLiteral) == 2);
+  ONNX_ASSERT(numNodes(*graph) == 4);
+  ONNX_ASSERT(graph->outputs()[1]->node()->kind() == Symbol("Squeeze"));
+  ONNX_ASSERT(graph->outputs()[2]->node()->kind() == kReshape);
+
+  // Check correctness
+  const auto& folded = constantLiteral(graph->outputs()[0], valueToLiteral);
+  ONNX_ASSERT(ShapeUtil::Rank(folded.shape()) == 2);
+  ONNX_ASSERT(ShapeUtil::GetDimension(folded.shape(), 0) == 3);
+  ONNX_ASSERT(ShapeUtil::GetDimension(folded.shape(), 1) == 1);
+  for (int i = 0; i < 3; ++i) {
+    ONNX_ASSERT(folded.data<float>()[i] == x_tensor.floats()[i]);
+  }
+}
+
+// Graph with duplicated Relu and Sum nodes and two dead nodes: the passes
+// remove them without changing the output
+void common_subexpressions_dead_code_test() {
+  // Set up IR graph computing 2 * (Relu(x) + x)
+  std::unique_ptr<Graph> graph(new Graph());
+  graph->setName("cse_dce_graph");
+  std::vector<Dimension> sizes = {2, 3};
+  auto x = addFloatInput(*graph, "x", sizes);
+  auto first = appendNode(*graph, "Sum",
+                          {appendNode(*graph, "Relu", {x}, sizes), x}, sizes);
+  auto second = appendNode(*graph, "Sum",
+                           {appendNode(*graph, "Relu", {x}, sizes), x}, sizes);
+  auto dead = appendNode(*graph, "Relu", {first}, sizes);
+  appendNode(*graph, "Sum", {dead, x}, sizes);
+  auto y = appendNode(*graph, "Sum", {first, second}, sizes);
+  y->setUniqueName("y");
+  graph->return_node()->addInput(y);
+
+  // Check counts: the second Relu, then the second Sum, are merged, and the
+  // two dead nodes are removed
+  ValueLiteralMap valueToLiteral;
+  ONNX_ASSERT(numNodes(*graph) == 7);
+  auto stats = optimizeGraph(*graph, valueToLiteral);
+  ONNX_ASSERT(stats.at("eliminate_common_subexpressions") == 2);
+  ONNX_ASSERT(stats.at("eliminate_dead_code") == 2);
+  ONNX_ASSERT(numNodes(*graph) == 3);
+
+  // Set up IO information
+  uint64_t shape[2] = {2, 3};
+  auto input = makeDescriptor("x", 2, shape);
+  auto output = makeDescriptor("y", 2, shape);
+  float* input_ptr = (float*)input.buffer;
+  for (int i = 0; i < 6; ++i) {
+    input_ptr[i] = (float)i - 2.5f;
+  }
+
+  // Execute using XLA backend; the optimized graph leaves nothing to remove
+  XlaTransform runner(NULL, std::move(graph), "cse_dce", 0, nullptr);
+  runner.translateGraph();
+  ONNX_ASSERT(runner.passStats().at("eliminate_common_subexpressions") == 0);
+  ONNX_ASSERT(runner.passStats().at("eliminate_dead_code") == 0);
+  auto executor = runner.executor();
+  executor->initIO(1, &input, 1, &output);
+  runWithFences(executor);
+
+  // Check correctness
+  float* output_ptr = (float*)output.buffer;
+  for (int i = 0; i < 6; ++i) {
+    ONNX_ASSERT(almost_equal(2 * (std::max(input_ptr[i], 0.0f) + input_ptr[i]),
+                             output_ptr[i]));
+  }
+
+  // Free memory
+  delete executor;
+  freeDescriptor(input);
+  freeDescriptor(output);
+}
+
+// Transposes cancelling each other, an identity Reshape and an identity
+// Transpose between an input and a Sum are removed by simplify_layout
+void simplify_layout_test() {
+  // Set up IR graph computing Sum(Transpose(Reshape(Transpose(Transpose(x)))),
+  // x), where every layout change cancels out
+  std::unique_ptr<Graph> graph(new Graph());
+  graph->setName("layout_graph");
+  std::vector<Dimension> sizes = {2, 3, 4};
+  auto x = addFloatInput(*graph, "x", sizes);
+  Tensor shape;
+  shape.elem_type() = ONNX_NAMESPACE::TensorProto_DataType_INT64;
+  shape.sizes().push_back(3);
+  shape.int64s() = {2, 3, 4};
+  auto shape_input = graph->addInitializerAndInput(shape, "shape");
+  auto swapped = appendNode(*graph, "Transpose", {x}, {3, 2, 4});
+  swapped->node()->is_(kperm, {1, 0, 2});
+  auto swapped_back = appendNode(*graph, "Transpose", {swapped}, sizes);
+  swapped_back->node()->is_(kperm, {1, 0, 2});
+  auto reshaped =
+      appendNode(*graph, "Reshape", {swapped_back, shape_input}, sizes);
+  auto identity = appendNode(*graph, "Transpose", {reshaped}, sizes);
+  identity->node()->is_(kperm, {0, 1, 2});
+  auto y = appendNode(*graph, "Sum", {identity, x}, sizes);
+  y->setUniqueName("y");
+  graph->return_node()->addInput(y);
+
+  // Check counts: the Transposes merge into an identity, which is removed on
+  // the second sweep with the Reshape and the identity Transpose
+  ValueLiteralMap valueToLiteral;
+  valueToLiteral[shape_input] = tensorToLiteral(shape);
+  ONNX_ASSERT(simplifyLayout(*graph, valueToLiteral) == 4);
+  ONNX_ASSERT(numNodes(*graph) == 1);
+
+  // Set up IO information
+  uint64_t io_shape[3] = {2, 3, 4};
+  auto input = makeDescriptor("x", 3, io_shape);
+  auto output = makeDescriptor("y", 3, io_shape);
+  float* input_ptr = (float*)input.buffer;
+  for (int i = 0; i < 24; ++i) {
+    input_ptr[i] = 0.1f * i - 1.2f;
+  }
+
+  // Execute using XLA backend
+  XlaTransform runner(NULL, std::move(graph), "layout", 0, nullptr);
+  runner.translateGraph();
+  ONNX_ASSERT(runner.passStats().at("simplify_layout") == 0);
+  auto executor = runner.executor();
+  executor->initIO(1, &input, 1, &output);
+  runWithFences(executor);
+
+  // Check correctness
+  float* output_ptr = (float*)output.buffer;
+  for (int i = 0; i < 24; ++i) {
+    ONNX_ASSERT(almost_equal(2 * input_ptr[i], output_ptr[i]));
+  }
+
+  // Free memory
+  delete executor;
+  freeDescriptor(input);
+  freeDescriptor(output);
+}
+
+// Conv with one group per channel selects the depthwise variant (priority 1)
+// and matches a direct computation
+void depthwise_conv_test() {
+  // Set up IR graph: 3 channels of 4x4, 3x3 kernels padded by 1
+  std::unique_ptr<Graph> graph(new Graph());
+  graph->setName("depthwise_conv_graph");
+  std::vector<Dimension> sizes = {1, 3, 4, 4};
+  auto x = addFloatInput(*graph, "x", sizes);
+  Tensor weights;
+  weights.elem_type() = ONNX_NAMESPACE::TensorProto_DataType_FLOAT;
+  weights.sizes() = {3, 1, 3, 3};
+  for (int i = 0; i < 27; ++i) {
+    weights.floats().push_back(0.05f * i - 0.6f);
+  }
+  auto w = graph->addInitializerAndInput(weights, "w");
+  auto y = appendNode(*graph, "Conv", {x, w}, sizes);
+  y->node()->i_(kgroup, 3);
+  y->node()->is_(kpads, {1, 1, 1, 1});
+  y->setUniqueName("y");
+  graph->return_node()->addInput(y);
+
+  // Check the depthwise variant is chosen over the default one
+  auto candidates =
+      OperatorRegistry::registry().candidates(*y->node(), ValueLiteralMap());
+  ONNX_ASSERT(candidates.size() == 2);
+  ONNX_ASSERT(candidates[0]->variant == "depthwise");
+  ONNX_ASSERT(candidates[1]->variant == "default");
+
+  // Set up IO information
+  uint64_t shape[4] = {1, 3, 4, 4};
+  auto input = makeDescriptor("x", 4, shape);
+  auto output = makeDescriptor("y", 4, shape);
+  float* input_ptr = (float*)input.buffer;
+  for (int i = 0; i < 48; ++i) {
+    input_ptr[i] = 0.1f * (i % 7) - 0.3f;
+  }
+
+  // Execute using XLA backend
+  XlaTransform runner(NULL, std::move(graph), "depthwise_conv", 0, nullptr);
+  runner.translateGraph();
+  auto executor = runner.executor();
+  executor->initIO(1, &input, 1, &output);
+  runWithFences(executor);
+
+  // Check correctness: each channel is convolved with its own kernel
+  float* output_ptr = (float*)output.buffer;
+  for (int c = 0; c < 3; ++c) {
+    for (int i = 0; i < 4; ++i) {
+      for (int j = 0; j < 4; ++j) {
+        float expected = 0.0f;
+        for (int ky = 0; ky < 3; ++ky) {
+          for (int kx = 0; kx < 3; ++kx) {
+            int yi = i + ky - 1;
+            int xj = j + kx - 1;
+            if (yi >= 0 && yi < 4 && xj >= 0 && xj < 4) {
+              expected += weights.floats()[9 * c + 3 * ky + kx] *
+                          input_ptr[16 * c + 4 * yi + xj];
+            }
+          }
+        }
+        ONNX_ASSERT(
+            almost_equal(expected, output_ptr[16 * c + 4 * i + j], 1e-4));
+      }
+    }
+  }
+
+  // Free memory
+  delete executor;
+  freeDescriptor(input);
+  freeDescriptor(output);
+}
+
+// Translators registered for a test operator are selected by opset version,
+// then predicate, then priority
+void registry_selection_test() {
+  static std::string translated;
+  auto translator = [](const char* variant) {
+    return [variant](const Node& n, XlaBuilder& builder, ValueOpMap& valueToOp,
+                     const ValueLiteralMap& valueToLiteral) {
+      translated = variant;
+      return ONNXIFI_STATUS_SUCCESS;
+    };
+  };
+  Symbol kind("RegistrySelectionTestOp");
+  auto special = [](const Node& n, const ValueLiteralMap& valueToLiteral) {
+    return n.hasAttribute(Symbol("special"));
+  };
+  OperatorRegistry::registerTranslator(
+      TranslatorEntry{"", kind, 1, 5, 0, "old", nullptr, translator("old")});
+  OperatorRegistry::registerTranslator(TranslatorEntry{
+      "", kind, 6, kMaxOpsetVersion, 0, "new", nullptr, translator("new")});
+  OperatorRegistry::registerTranslator(
+      TranslatorEntry{"", kind, 6, kMaxOpsetVersion, 2, "special", special,
+                      translator("special")});
+
+  // Overlapping opset ranges of one variant are refused
+  bool refused = false;
+  try {
+    OperatorRegistry::registerTranslator(TranslatorEntry{
+        "ai.onnx", kind, 3, 7, 0, "old", nullptr, translator("old")});
+  } catch (const std::runtime_error&) {
+    refused = true;
+  }
+  ONNX_ASSERT(refused);
+
+  Graph graph;
+  auto node = graph.create(kind, 1);
+  graph.appendNode(node);
+  auto& registry = OperatorRegistry::registry();
+  auto variants = [&](const OpsetVersionMap& opsetVersions) {
+    std::vector<std::string> names;
+    for (const auto* entry :
+         registry.candidates(*node, ValueLiteralMap(), opsetVersions)) {
+      names.push_back(entry->variant);
+    }
+    return names;
+  };
+
+  // Opset range
+  ONNX_ASSERT(variants({{"", 4}}) == std::vector<std::string>({"old"}));
+  ONNX_ASSERT(variants({{"", 6}}) == std::vector<std::string>({"new"}));
+  ONNX_ASSERT(variants({}) == std::vector<std::string>({"old", "new"}));
+
+  // Predicate and priority
+  node->i_(Symbol("special"), 1);
+  ONNX_ASSERT(variants({{"", 6}}) ==
+              std::vector<std::string>({"special", "new"}));
+  ONNX_ASSERT(variants({{"", 4}}) == std::vector<std::string>({"old"}));
+  XlaBuilder builder("registry_selection");
+  ValueOpMap valueToOp;
+  ONNX_ASSERT(registry.translate(*node, builder, valueToOp, ValueLiteralMap(),
+                                 {{"", 6}}) == ONNXIFI_STATUS_SUCCESS);
+  ONNX_ASSERT(translated == "special");
+
+  // Unknown operator
+  auto unknown = graph.create(Symbol("RegistrySelectionUnknownOp"), 1);
+  graph.appendNode(unknown);
+  ONNX_ASSERT(registry.candidates(*unknown, ValueLiteralMap()).empty());
+}
+
+// Runs the translation of n by entry on inputs (one per input of n),
+// returning its output
+static std::unique_ptr<Literal> runTranslator(
+    const TranslatorEntry& entry,
+    const Node& n,
+    const std::vector<const Literal*>& inputs) {
+  XlaBuilder builder(entry.variant);
+  ValueOpMap valueToOp;
+  std::vector<std::unique_ptr<xla::GlobalData>> data;
+  std::vector<xla::GlobalData*> dataPtrs;
+  for (auto i = 0; i < inputs.size(); ++i) {
+    valueToOp[n.inputs().at(i)] = builder.Parameter(
+        i, inputs[i]->shape(), "input_" + std::to_string(i));
+    data.push_back(xla::TransferParameterToServer(*inputs[i]));
+    dataPtrs.push_back(data.back().get());
+  }
+  ONNX_ASSERT(entry.translator(n, builder, valueToOp, ValueLiteralMap()) ==
+              ONNXIFI_STATUS_SUCCESS);
+  builder.Tuple({valueToOp.at(n.outputs().at(0))});
+  auto computation = builder.Build().ConsumeValueOrDie();
+  return xla::ExecuteComputation(computation, dataPtrs);
+}
+
+// Every registered lowering of LRN and Softmax, as the autotuner may select
+// them, matches a direct computation
+void lowering_variants_test() {
+  std::vector<Dimension> sizes = {1, 5, 2, 2};
+  Literal input(ShapeUtil::MakeShape(xla::F32, {1, 5, 2, 2}));
+  auto input_data = input.data<float>();
+  for (int i = 0; i < 20; ++i) {
+    input_data[i] = 0.15f * i - 1.4f;
+  }
+
+  // LRN over 3 channels
+  Graph lrn_graph;
+  auto x = addFloatInput(lrn_graph, "x", sizes);
+  auto lrn = appendNode(lrn_graph, "LRN", {x}, sizes)->node();
+  const float alpha = 0.5f;
+  const float beta = 0.75f;
+  const float bias = 2.0f;
+  lrn->i_(ksize, 3);
+  lrn->f_(kalpha, alpha);
+  lrn->f_(kbeta, beta);
+  lrn->f_(Symbol("bias"), bias);
+  auto candidates =
+      OperatorRegistry::registry().candidates(*lrn, ValueLiteralMap());
+  ONNX_ASSERT(candidates.size() == 3);
+  for (const auto* entry : candidates) {
+    auto result = runTranslator(*entry, *lrn, {&input});
+    auto output = result->data<float>({0});
+    for (int c = 0; c < 5; ++c) {
+      for (int p = 0; p < 4; ++p) {
+        float square_sum = 0.0f;
+        for (int k = std::max(c - 1, 0); k <= std::min(c + 1, 4); ++k) {
+          square_sum += input_data[4 * k + p] * input_data[4 * k + p];
+        }
+        float expected = input_data[4 * c + p] /
+                         std::pow(bias + alpha / 3 * square_sum, beta);
+        ONNX_ASSERT(almost_equal(expected, output[4 * c + p]));
+      }
+    }
+  }
+
+  // Softmax of each batch of 20 values
+  Graph softmax_graph;
+  x = addFloatInput(softmax_graph, "x", sizes);
+  auto softmax = appendNode(softmax_graph, "Softmax", {x}, sizes)->node();
+  softmax->i_(kaxis, 1);
+  candidates =
+      OperatorRegistry::registry().candidates(*softmax, ValueLiteralMap());
+  ONNX_ASSERT(candidates.size() == 2);
+  for (const auto* entry : candidates) {
+    auto result = runTranslator(*entry, *softmax, {&input});
+    auto output = result->data<float>({0});
+    float max = *std::max_element(input_data.begin(), input_data.end());
+    float sum = 0.0f;
+    for (int i = 0; i < 20; ++i) {
+      sum += std::exp(input_data[i] - max);
+    }
+    for (int i = 0; i < 20; ++i) {
+      ONNX_ASSERT(
+          almost_equal(std::exp(input_data[i] - max) / sum, output[i]));
+    }
+  }
+}
+
+// Plugin built from plugins/test_plugin.cc next to the tests binary, which
+// runs from the build directory
+static const char* kTestPluginPath = "./libonnx_xla_test_plugin.so";
+
+// Loads the test plugin and runs a graph of the operator it registers
+// (TestNegate of the onnx_xla.test domain)
+void plugin_test() {
+  ONNX_ASSERT(loadPlugins("/nonexistent/plugin.so") ==
+              ONNXIFI_STATUS_BACKEND_UNAVAILABLE);
+  ONNX_ASSERT(loadPlugins(kTestPluginPath) == ONNXIFI_STATUS_SUCCESS);
+  // Loaded plugins are skipped, rather than registering their translators
+  // twice
+  ONNX_ASSERT(loadPlugins(std::string(kTestPluginPath) + ":" +
+                          kTestPluginPath) == ONNXIFI_STATUS_SUCCESS);
+
+  // Set up IR graph
+  auto graph = makeGraph("TestNegate", {2, 3}, "x", 1, "y");
+  auto node = *graph->begin();
+  node->setDomain("onnx_xla.test");
+  auto candidates =
+      OperatorRegistry::registry().candidates(*node, ValueLiteralMap());
+  ONNX_ASSERT(candidates.size() == 1);
+
+  // Set up IO information
+  uint64_t shape[2] = {2, 3};
+  auto input = makeDescriptor("x", 2, shape);
+  auto output = makeDescriptor("y", 2, shape);
+  float* input_ptr = (float*)input.buffer;
+  for (int i = 0; i < 6; ++i) {
+    input_ptr[i] = (float)i - 2.5f;
+  }
+
+  // Execute using XLA backend
+  XlaTransform runner(NULL, std::move(graph), "plugin", 0, nullptr);
+  ONNX_ASSERT(runner.translateGraph() == ONNXIFI_STATUS_SUCCESS);
+  auto executor = runner.executor();
+  executor->initIO(1, &input, 1, &output);
+  runWithFences(executor);
+
+  // Check correctness
+  float* output_ptr = (float*)output.buffer;
+  for (int i = 0; i < 6; ++i) {
+    ONNX_ASSERT(almost_equal(-input_ptr[i], output_ptr[i]));
+  }
+
+  // Free memory
+  delete executor;
+  freeDescriptor(input);
+  freeDescriptor(output);
+}
+
+// Scalar initializer of elemType holding value (in floats or int32s)
+static Value* addScalarInitializer(Graph& graph,
+                                   ValueLiteralMap& valueToLiteral,
+                                   const char* name,
+                                   int32_t elemType,
+                                   float value) {
+  Tensor t;
+  t.elem_type() = elemType;
+  if (elemType == ONNX_NAMESPACE::TensorProto_DataType_FLOAT) {
+    t.floats().push_back(value);
+  } else {
+    t.int32s().push_back((int32_t)value);
+  }
+  auto v = graph.addInitializerAndInput(t, name);
+  valueToLiteral[v] = tensorToLiteral(t);
+  return v;
+}
+
+// Of three DequantizeLinear -> QuantizeLinear pairs between quantized values,
+// only the one whose scale and zero point match is removed, and the result is
+// unchanged
+void dequantize_quantize_test() {
+  // Set up IR graph computing the sum of the three branches
+  // DequantizeLinear(QuantizeLinear(DequantizeLinear(q, s, zp), s', zp'),
+  // s', zp'), with q = QuantizeLinear(x, s, zp), for (s', zp') in (s, zp),
+  // (s2, zp) and (s, zp2)
+  std::unique_ptr<Graph> graph(new Graph());
+  graph->setName("dequantize_quantize_graph");
+  std::vector<Dimension> sizes = {2, 3};
+  ValueLiteralMap valueToLiteral;
+  const float kScale = 0.1f, kScale2 = 0.25f;
+  const int kZeroPoint = 128, kZeroPoint2 = 100;
+  auto addParameter = [&](const char* name, int32_t elemType, float value) {
+    return addScalarInitializer(*graph, valueToLiteral, name, elemType, value);
+  };
+  auto scale =
+      addParameter("s", ONNX_NAMESPACE::TensorProto_DataType_FLOAT, kScale);
+  auto scale2 =
+      addParameter("s2", ONNX_NAMESPACE::TensorProto_DataType_FLOAT, kScale2);
+  auto zeroPoint = addParameter(
+      "zp", ONNX_NAMESPACE::TensorProto_DataType_UINT8, kZeroPoint);
+  auto zeroPoint2 = addParameter(
+      "zp2", ONNX_NAMESPACE::TensorProto_DataType_UINT8, kZeroPoint2);
+  auto x = addFloatInput(*graph, "x", sizes);
+  auto quantizeNode = [&](Value* input, Value* s, Value* zp) {
+    auto output = appendNode(*graph, "QuantizeLinear", {input, s, zp}, sizes);
+    output->setElemType(ONNX_NAMESPACE::TensorProto_DataType_UINT8);
+    return output;
+  };
+  auto q = quantizeNode(x, scale, zeroPoint);
+  std::vector<Value*> branches;
+  for (const auto& parameters :
+       {std::make_pair(scale, zeroPoint), std::make_pair(scale2, zeroPoint),
+        std::make_pair(scale, zeroPoint2)}) {
+    auto dequantized =
+        appendNode(*graph, "DequantizeLinear", {q, scale, zeroPoint}, sizes);
+    auto requantized =
+        quantizeNode(dequantized, parameters.first, parameters.second);
+    branches.push_back(appendNode(*graph, "DequantizeLinear",
+                                  {requantized, parameters.first,
+                                   parameters.second},
+                                  sizes));
+  }
+  auto y = appendNode(*graph, "Sum", branches, sizes);
+  y->setUniqueName("y");
+  graph->return_node()->addInput(y);
+
+  // Check counts: the first pair is removed, the pairs changing the scale or
+  // the zero point are kept
+  ONNX_ASSERT(numNodes(*graph) == 11);
+  ONNX_ASSERT(eliminateDequantizeQuantize(*graph, valueToLiteral) == 1);
+  ONNX_ASSERT(numNodes(*graph) == 9);
+
+  // Set up IO information
+  uint64_t shape[2] = {2, 3};
+  auto input = makeDescriptor("x", 2, shape);
+  auto output = makeDescriptor("y", 2, shape);
+  float* input_ptr = (float*)input.buffer;
+  for (int i = 0; i < 6; ++i) {
+    input_ptr[i] = 0.37f * i - 1.9f;
+  }
+
+  // Execute using XLA backend
+  XlaTransform runner(NULL, std::move(graph), "dequantize_quantize", 0,
+                      nullptr);
+  ONNX_ASSERT(runner.translateGraph() == ONNXIFI_STATUS_SUCCESS);
+  ONNX_ASSERT(runner.passStats().at("eliminate_dequantize_quantize") == 0);
+  auto executor = runner.executor();
+  executor->initIO(1, &input, 1, &output);
+  runWithFences(executor);
+
+  // Check correctness against the unoptimized round trips
+  auto quantize = [](float v, float s, int zp) {
+    return std::min(std::max(std::nearbyint(v / s) + zp, 0.0f), 255.0f);
+  };
+  auto dequantize = [](float v, float s, int zp) { return (v - zp) * s; };
+  float* output_ptr = (float*)output.buffer;
+  for (int i = 0; i < 6; ++i) {
+    auto real = dequantize(quantize(input_ptr[i], kScale, kZeroPoint), kScale,
+                           kZeroPoint);
+    auto expected =
+        dequantize(quantize(real, kScale, kZeroPoint), kScale, kZeroPoint) +
+        dequantize(quantize(real, kScale2, kZeroPoint), kScale2, kZeroPoint) +
+        dequantize(quantize(real, kScale, kZeroPoint2), kScale, kZeroPoint2);
+    ONNX_ASSERT(almost_equal(expected, output_ptr[i]));
+  }
+
+  // Free memory
+  delete executor;
+  freeDescriptor(input);
+  freeDescriptor(output);
+}
+
+// Literal of dims holding values (in row-major order)
+template <typename T>
+static std::unique_ptr<Literal> makeLiteral(const std::vector<T>& values,
+                                            const std::vector<int64>& dims) {
+  return Literal::CreateR1<T>(values)->Reshape(dims).ConsumeValueOrDie();
+}
+
+// QuantizeLinear, QLinearMatMul and QLinearConv with non-zero zero points and
+// per-axis scales match a direct computation (to one quantization step, as
+// the compiler may reorder the float scaling)
+void quantized_operators_test() {
+  const auto kUInt8 = ONNX_NAMESPACE::TensorProto_DataType_UINT8;
+  Graph graph;
+  auto addInput = [&](const char* name, int32_t elemType,
+                      const std::vector<Dimension>& sizes) {
+    auto input = addFloatInput(graph, name, sizes);
+    input->setElemType(elemType);
+    return input;
+  };
+  auto appendQuantizedNode = [&](const char* kind,
+                                 const std::vector<Value*>& inputs,
+                                 const std::vector<Dimension>& sizes) {
+    auto output = appendNode(graph, kind, inputs, sizes);
+    output->setElemType(kUInt8);
+    return output->node();
+  };
+  auto run = [](const Node* n, const std::vector<const Literal*>& inputs) {
+    auto candidates =
+        OperatorRegistry::registry().candidates(*n, ValueLiteralMap());
+    ONNX_ASSERT(!candidates.empty());
+    return runTranslator(*candidates.front(), *n, inputs);
+  };
+  auto quantize = [](float real, float scale, int zeroPoint) {
+    return std::min(std::max(std::nearbyint(real / scale) + zeroPoint, 0.0f),
+                    255.0f);
+  };
+  auto checkOutput = [](const Literal& result,
+                        const std::vector<float>& expected) {
+    auto output = result.data<uint8>({0});
+    ONNX_ASSERT(output.size() == expected.size());
+    for (auto i = 0; i < expected.size(); ++i) {
+      ONNX_ASSERT(std::abs(output[i] - expected[i]) <= 1.0f);
+    }
+  };
+
+  // QuantizeLinear of [2, 3] with a scale and zero point per column, which
+  // saturates at both ends
+  std::vector<float> xValues;
+  for (int i = 0; i < 6; ++i) {
+    xValues.push_back(0.37f * i - 0.9f);
+  }
+  std::vector<float> xScales = {0.01f, 0.05f, 0.002f};
+  std::vector<uint8> xZeroPoints = {10, 128, 250};
+  auto quantizeNode = appendQuantizedNode(
+      "QuantizeLinear",
+      {addFloatInput(graph, "x", {2, 3}), addFloatInput(graph, "x_scale", {3}),
+       addInput("x_zero_point", kUInt8, {3})},
+      {2, 3});
+  auto x = makeLiteral<float>(xValues, {2, 3});
+  auto xScale = makeLiteral<float>(xScales, {3});
+  auto xZeroPoint = makeLiteral<uint8>(xZeroPoints, {3});
+  std::vector<float> expected;
+  for (int i = 0; i < 6; ++i) {
+    expected.push_back(
+        quantize(xValues[i], xScales[i % 3], xZeroPoints[i % 3]));
+  }
+  checkOutput(*run(quantizeNode, {x.get(), xScale.get(), xZeroPoint.get()}),
+              expected);
+
+  // QLinearMatMul of [2, 3] by [3, 2], with b scaled and offset per column
+  std::vector<uint8> aValues = {3, 10, 20, 7, 0, 255};
+  std::vector<uint8> bValues = {3, 120, 200, 100, 50, 140};
+  const float aScale = 0.05f, yScale = 0.07f;
+  const int aZeroPoint = 7, yZeroPoint = 100;
+  std::vector<float> bScales = {0.1f, 0.02f};
+  std::vector<uint8> bZeroPoints = {3, 120};
+  auto matMulNode = appendQuantizedNode(
+      "QLinearMatMul",
+      {addInput("a", kUInt8, {2, 3}), addFloatInput(graph, "a_scale", {}),
+       addInput("a_zero_point", kUInt8, {}), addInput("b", kUInt8, {3, 2}),
+       addFloatInput(graph, "b_scale", {2}),
+       addInput("b_zero_point", kUInt8, {2}),
+       addFloatInput(graph, "y_scale", {}),
+       addInput("y_zero_point", kUInt8, {})},
+      {2, 2});
+  std::vector<std::unique_ptr<Literal>> matMulInputs;
+  matMulInputs.push_back(makeLiteral<uint8>(aValues, {2, 3}));
+  matMulInputs.push_back(Literal::CreateR0<float>(aScale));
+  matMulInputs.push_back(Literal::CreateR0<uint8>(aZeroPoint));
+  matMulInputs.push_back(makeLiteral<uint8>(bValues, {3, 2}));
+  matMulInputs.push_back(makeLiteral<float>(bScales, {2}));
+  matMulInputs.push_back(makeLiteral<uint8>(bZeroPoints, {2}));
+  matMulInputs.push_back(Literal::CreateR0<float>(yScale));
+  matMulInputs.push_back(Literal::CreateR0<uint8>(yZeroPoint));
+  expected.clear();
+  for (int m = 0; m < 2; ++m) {
+    for (int n = 0; n < 2; ++n) {
+      int32_t accumulator = 0;
+      for (int k = 0; k < 3; ++k) {
+        accumulator += (aValues[3 * m + k] - aZeroPoint) *
+                       (bValues[2 * k + n] - bZeroPoints[n]);
+      }
+      expected.push_back(quantize((float)accumulator * aScale * bScales[n],
+                                  yScale, yZeroPoint));
+    }
+  }
+  std::vector<const Literal*> matMulInputPtrs;
+  for (const auto& input : matMulInputs) {
+    matMulInputPtrs.push_back(input.get());
+  }
+  checkOutput(*run(matMulNode, matMulInputPtrs), expected);
+
+  // QLinearConv of a [1, 2, 3, 3] input by 2x2 kernels (kernel_shape
+  // inferred from the weights), with a scale and zero point per output
+  // channel
+  std::vector<uint8> inputValues, weightValues;
+  for (int i = 0; i < 18; ++i) {
+    inputValues.push_back((7 * i) % 23);
+  }
+  for (int i = 0; i < 8; ++i) {
+    weightValues.push_back((5 * i) % 17);
+  }
+  for (int i = 0; i < 8; ++i) {
+    weightValues.push_back(120 + (3 * i) % 21);
+  }
+  const float inputScale = 0.1f, outputScale = 0.5f;
+  const int inputZeroPoint = 5, outputZeroPoint = 20;
+  std::vector<float> weightScales = {0.05f, 0.02f};
+  std::vector<uint8> weightZeroPoints = {8, 130};
+  auto convNode = appendQuantizedNode(
+      "QLinearConv",
+      {addInput("input", kUInt8, {1, 2, 3, 3}),
+       addFloatInput(graph, "input_scale", {}),
+       addInput("input_zero_point", kUInt8, {}),
+       addInput("w", kUInt8, {2, 2, 2, 2}),
+       addFloatInput(graph, "w_scale", {2}),
+       addInput("w_zero_point", kUInt8, {2}),
+       addFloatInput(graph, "output_scale", {}),
+       addInput("output_zero_point", kUInt8, {})},
+      {1, 2, 2, 2});
+  std::vector<std::unique_ptr<Literal>> convInputs;
+  convInputs.push_back(makeLiteral<uint8>(inputValues, {1, 2, 3, 3}));
+  convInputs.push_back(Literal::CreateR0<float>(inputScale));
+  convInputs.push_back(Literal::CreateR0<uint8>(inputZeroPoint));
+  convInputs.push_back(makeLiteral<uint8>(weightValues, {2, 2, 2, 2}));
+  convInputs.push_back(makeLiteral<float>(weightScales, {2}));
+  convInputs.push_back(makeLiteral<uint8>(weightZeroPoints, {2}));
+  convInputs.push_back(Literal::CreateR0<float>(outputScale));
+  convInputs.push_back(Literal::CreateR0<uint8>(outputZeroPoint));
+  expected.clear();
+  for (int oc = 0; oc < 2; ++oc) {
+    for (int oh = 0; oh < 2; ++oh) {
+      for (int ow = 0; ow < 2; ++ow) {
+        int32_t accumulator = 0;
+        for (int ic = 0; ic < 2; ++ic) {
+          for (int kh = 0; kh < 2; ++kh) {
+            for (int kw = 0; kw < 2; ++kw) {
+              accumulator +=
+                  (inputValues[9 * ic + 3 * (oh + kh) + ow + kw] -
+                   inputZeroPoint) *
+                  (weightValues[8 * oc + 4 * ic + 2 * kh + kw] -
+                   weightZeroPoints[oc]);
+            }
+          }
+        }
+        expected.push_back(
+            quantize((float)accumulator * inputScale * weightScales[oc],
+                     outputScale, outputZeroPoint));
+      }
+    }
+  }
+  std::vector<const Literal*> convInputPtrs;
+  for (const auto& input : convInputs) {
+    convInputPtrs.push_back(input.get());
+  }
+  checkOutput(*run(convNode, convInputPtrs), expected);
+}
+
+// Scaled dot-product attention is fused whichever operand of the Add is the
+// mask, including a mask produced by Mul, and the Softmax axis defaults to
+// the last one only since opset 13
+void attention_fusion_test() {
+  // Set up IR graph computing
+  // MatMul(Softmax(Add(Div(MatMul(q, k_t), d), Mul(m, c))), v), with the Add
+  // operands in either order and no Softmax axis attribute
+  std::vector<Dimension> sizes = {1, 2, 3, 4};
+  std::vector<Dimension> scoreSizes = {1, 2, 3, 3};
+  Value* mask = nullptr;
+  auto makeAttentionGraph = [&](bool maskFirst,
+                                ValueLiteralMap& valueToLiteral) {
+    std::unique_ptr<Graph> graph(new Graph());
+    graph->setName("attention_graph");
+    auto q = addFloatInput(*graph, "q", sizes);
+    auto k_t = addFloatInput(*graph, "k_t", {1, 2, 4, 3});
+    auto v = addFloatInput(*graph, "v", sizes);
+    auto m = addFloatInput(*graph, "m", {1, 1, 1, 3});
+    auto d = addScalarInitializer(*graph, valueToLiteral, "d",
+                                  ONNX_NAMESPACE::TensorProto_DataType_FLOAT,
+                                  2.0f);
+    auto c = addScalarInitializer(*graph, valueToLiteral, "c",
+                                  ONNX_NAMESPACE::TensorProto_DataType_FLOAT,
+                                  -10000.0f);
+    auto scores = appendNode(
+        *graph, "Div", {appendNode(*graph, "MatMul", {q, k_t}, scoreSizes), d},
+        scoreSizes);
+    mask = appendNode(*graph, "Mul", {m, c}, {1, 1, 1, 3});
+    auto masked = appendNode(
+        *graph, "Add",
+        maskFirst ? std::vector<Value*>{mask, scores}
+                  : std::vector<Value*>{scores, mask},
+        scoreSizes);
+    auto probabilities = appendNode(*graph, "Softmax", {masked}, scoreSizes);
+    auto y = appendNode(*graph, "MatMul", {probabilities, v}, sizes);
+    y->setUniqueName("y");
+    graph->return_node()->addInput(y);
+    return graph;
+  };
+
+  // Check both orders fuse with opset 13, the mask becoming the last input
+  for (bool maskFirst : {false, true}) {
+    ValueLiteralMap valueToLiteral;
+    auto graph = makeAttentionGraph(maskFirst, valueToLiteral);
+    ONNX_ASSERT(fusePatterns(*graph, valueToLiteral, {{"", 13}}) == 1);
+    Node* fused = graph->outputs()[0]->node();
+    ONNX_ASSERT(fused->kind() == Symbol("Attention"));
+    ONNX_ASSERT(fused->inputs().size() == 4);
+    ONNX_ASSERT(fused->inputs()[3] == mask);
+    ONNX_ASSERT(almost_equal(fused->f(Symbol("scale")), 0.5f));
+  }
+
+  // Check the Softmax over axis 1 of earlier opsets is not fused
+  for (const auto& opsetVersions :
+       {OpsetVersionMap{{"", 12}}, OpsetVersionMap()}) {
+    ValueLiteralMap valueToLiteral;
+    auto graph = makeAttentionGraph(false, valueToLiteral);
+    ONNX_ASSERT(fusePatterns(*graph, valueToLiteral, opsetVersions) == 0);
+  }
+}
+
+// uint8 NHWC pixels passed for a float NCHW input are transposed and
+// normalized with a mean per channel and one scale
+void image_input_test() {
+  // Set up IO information
+  uint64_t pixel_shape[4] = {1, 2, 2, 3};
+  uint64_t shape[4] = {1, 3, 2, 2};
+  uint8_t pixels[12];
+  for (int i = 0; i < 12; ++i) {
+    pixels[i] = (uint8_t)(21 * i);
+  }
+  onnxTensorDescriptorV1 input;
+  input.tag = ONNXIFI_TAG_TENSOR_DESCRIPTOR_V1;
+  input.name = "image";
+  input.dataType = ONNXIFI_DATATYPE_UINT8;
+  input.memoryType = ONNXIFI_MEMORY_TYPE_CPU;
+  input.dimensions = 4;
+  input.shape = pixel_shape;
+  input.buffer = (onnxPointer)pixels;
+  auto output = makeDescriptor("normalized", 4, shape);
+
+  // Execute using XLA backend, on Sum(image) (the identity)
+  GraphOptions options;
+  options.imageInput = "image";
+  options.imageNHWC = true;
+  options.imageMean = {10.0f, 20.0f, 30.0f};
+  options.imageScale = {2.0f};
+  XlaTransform runner(NULL, makeGraph("Sum", {1, 3, 2, 2}, "image", 1,
+                                      "normalized"),
+                      "image", 0, nullptr, OpsetVersionMap(), options);
+  ONNX_ASSERT(runner.translateGraph() == ONNXIFI_STATUS_SUCCESS);
+  auto executor = runner.executor();
+  ONNX_ASSERT(executor->initIO(1, &input, 1, &output) ==
+              ONNXIFI_STATUS_SUCCESS);
+  runWithFences(executor);
+
+  // Check correctness against normalizing pixel (h, w, c) by hand
+  float* output_ptr = (float*)output.buffer;
+  for (int c = 0; c < 3; ++c) {
+    for (int h = 0; h < 2; ++h) {
+      for (int w = 0; w < 2; ++w) {
+        float pixel = pixels[(h * 2 + w) * 3 + c];
+        ONNX_ASSERT(almost_equal((pixel - options.imageMean[c]) / 2.0f,
+                                 output_ptr[(c * 2 + h) * 2 + w]));
+      }
+    }
+  }
+
+  // Free memory
+  delete executor;
+  freeDescriptor(output);
+}
 }
@@ -7,4 +7,25 @@ namespace onnx_xla {
 bool almost_equal(float a, float b, float epsilon = 1e-5);
 void static_relu_test();
 void dynamic_relu_test();
+void conv_batchnorm_fold_test();
+void reduced_precision_transfer_test();
+void output_selection_test();
+void multiple_outputs_test();
+void persistent_state_test();
+void chained_graphs_test();
+void backend_buffer_test();
+void io_slots_test();
+void pipelined_runs_test();
+void pipelined_run_failure_test();
+void fold_squeeze_unsqueeze_test();
+void common_subexpressions_dead_code_test();
+void simplify_layout_test();
+void depthwise_conv_test();
+void registry_selection_test();
+void lowering_variants_test();
+void plugin_test();
+void dequantize_quantize_test();
+void quantized_operators_test();
+void attention_fusion_test();
+void image_input_test();
 }
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+namespace onnx_xla {
+// Queue of at most capacity items between two threads, used between the stages
+// of the XlaExecutor run pipeline. push blocks while the queue is full, so a
+// slow stage holds back the stages before it.
+template <typename T>
+class BoundedQueue final {
+ public:
+  explicit BoundedQueue(size_t capacity) : capacity_(capacity) {}
+
+  // Appends item, waiting for room. Returns false if the queue is closed.
+  bool push(T item) {
+    std::unique_lock<std::mutex> lk(mutex_);
+    not_full_.wait(lk, [this] { return closed_ || items_.size() < capacity_; });
+    if (closed_) {
+      return false;
+    }
+    items_.push_back(std::move(item));
+    lk.unlock();
+    not_empty_.notify_one();
+    return true;
+  }
+
+  // Takes the first item, waiting for one. Returns false once the queue is
+  // closed and empty.
+  bool pop(T& item) {
+    std::unique_lock<std::mutex> lk(mutex_);
+    not_empty_.wait(lk, [this] { return closed_ || !items_.empty(); });
+    if (items_.empty()) {
+      return false;
+    }
+    item = std::move(items_.front());
+    items_.pop_front();
+    lk.unlock();
+    not_full_.notify_one();
+    return true;
+  }
+
+  // Refuses further items; the ones queued can still be popped
+  void close() {
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      closed_ = true;
+    }
+    not_full_.notify_all();
+    not_empty_.notify_all();
+  }
+
+ private:
+  const size_t capacity_;
+  bool closed_ = false;
+  std::deque<T> items_;
+  std::mutex mutex_;
+  std::condition_variable not_full_;
+  std::condition_variable not_empty_;
+};
+}
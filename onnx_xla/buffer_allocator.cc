@@ -0,0 +1,108 @@
+#include "onnx_xla/buffer_allocator.h"
+
+#include <sys/mman.h>
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <mutex>
+
+namespace onnx_xla {
+namespace {
+constexpr size_t kHugePageSize = 2 << 20;
+// Buffers below this size ignore the huge page flags: rounding them up to a
+// huge page would more than double them, for at most one TLB entry saved
+constexpr size_t kHugePagesMinSize = kHugePageSize / 2;
+
+struct Allocation {
+  size_t size;
+  // Mapped with MAP_HUGETLB (else from posix_memalign)
+  bool mapped;
+};
+
+// Live buffers, keyed on address
+std::mutex& allocationsMutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+
+std::map<const char*, Allocation>& allocations() {
+  static std::map<const char*, Allocation> allocations;
+  return allocations;
+}
+
+size_t roundUp(size_t size, size_t alignment) {
+  return (size + alignment - 1) / alignment * alignment;
+}
+}
+
+void* allocateBuffer(size_t size, uint64_t flags) {
+  if (size < kHugePagesMinSize) {
+    flags &= ~(ONNX_XLA_BUFFER_TRANSPARENT_HUGE_PAGES |
+               ONNX_XLA_BUFFER_HUGE_PAGES);
+  }
+  bool hugePages = flags & (ONNX_XLA_BUFFER_TRANSPARENT_HUGE_PAGES |
+                            ONNX_XLA_BUFFER_HUGE_PAGES);
+  size_t alignment = hugePages ? kHugePageSize : kBufferAlignment;
+  Allocation allocation{roundUp(std::max<size_t>(size, 1), alignment), false};
+  void* buffer = nullptr;
+  if (flags & ONNX_XLA_BUFFER_HUGE_PAGES) {
+    buffer = mmap(nullptr, allocation.size, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (buffer == MAP_FAILED) {
+      // No huge pages reserved: fall back to transparent huge pages, warning
+      // on the first failure only
+      static std::once_flag warned;
+      std::call_once(warned, [] {
+        std::cerr << "Could not map huge pages, using transparent huge pages"
+                  << std::endl;
+      });
+      buffer = nullptr;
+    } else {
+      allocation.mapped = true;
+    }
+  }
+  if (!buffer) {
+    if (posix_memalign(&buffer, alignment, allocation.size) != 0) {
+      return nullptr;
+    }
+    if (hugePages) {
+      // Advisory: ignored by kernels without transparent huge pages
+      madvise(buffer, allocation.size, MADV_HUGEPAGE);
+    }
+  }
+  std::lock_guard<std::mutex> lock(allocationsMutex());
+  allocations()[static_cast<const char*>(buffer)] = allocation;
+  return buffer;
+}
+
+bool freeBuffer(void* buffer) {
+  Allocation allocation;
+  {
+    std::lock_guard<std::mutex> lock(allocationsMutex());
+    auto it = allocations().find(static_cast<const char*>(buffer));
+    if (it == allocations().end()) {
+      return false;
+    }
+    allocation = it->second;
+    allocations().erase(it);
+  }
+  if (allocation.mapped) {
+    munmap(buffer, allocation.size);
+  } else {
+    free(buffer);
+  }
+  return true;
+}
+
+bool isBackendBuffer(const void* data, size_t size) {
+  auto begin = static_cast<const char*>(data);
+  std::lock_guard<std::mutex> lock(allocationsMutex());
+  auto it = allocations().upper_bound(begin);
+  if (it == allocations().begin()) {
+    return false;
+  }
+  --it;
+  return begin + size <= it->first + it->second.size;
+}
+}
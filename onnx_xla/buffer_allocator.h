@@ -0,0 +1,24 @@
+#pragma once
+
+#include "onnx_xla/onnx_xla_extensions.h"
+
+#include <cstddef>
+
+namespace onnx_xla {
+// IO buffers allocated by the backend (see onnxXlaAllocateBuffer): aligned to
+// kBufferAlignment bytes, with sizes rounded up to it, and optionally on huge
+// pages. XlaExecutor transfers inputs in them without staging copies.
+constexpr size_t kBufferAlignment = 64;
+
+// Returns a buffer of at least size bytes allocated with the
+// ONNX_XLA_BUFFER_* flags, or null if the allocation fails. Buffers under half
+// a huge page (1MB) are allocated without huge pages.
+void* allocateBuffer(size_t size, uint64_t flags);
+
+// Frees a buffer returned by allocateBuffer, returning false if buffer is not
+// one
+bool freeBuffer(void* buffer);
+
+// Whether the size bytes at data lie in a buffer returned by allocateBuffer
+bool isBackendBuffer(const void* data, size_t size);
+}
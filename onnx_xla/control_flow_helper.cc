@@ -0,0 +1,185 @@
+#include "onnx_xla/control_flow_helper.h"
+#include "onnx_xla/utils.h"
+
+namespace onnx_xla {
+using ::ONNX_NAMESPACE::AttributeKind;
+
+static const Symbol kCapturedKind("Captured");
+
+std::vector<Symbol> subgraphAttributes(const Node& n) {
+  std::vector<Symbol> attributes;
+  for (const auto& name : n.attributeNames()) {
+    if (n.kindOf(name) == AttributeKind::g) {
+      attributes.push_back(name);
+    }
+  }
+  std::sort(attributes.begin(), attributes.end(),
+            [](const Symbol& a, const Symbol& b) {
+              return std::string(a.toString()) < std::string(b.toString());
+            });
+  return attributes;
+}
+
+std::vector<Value*> capturedValues(const Graph& g) {
+  std::vector<Value*> captured;
+  for (const Node* n : g.nodes()) {
+    if (n->kind() == kCapturedKind) {
+      captured.push_back(n->outputs().at(0));
+    }
+  }
+  return captured;
+}
+
+std::vector<const Value*> capturedInputs(const Node& n, const Symbol& attr) {
+  auto attributes = subgraphAttributes(n);
+  size_t numCaptured = 0;
+  for (const auto& name : attributes) {
+    numCaptured += capturedValues(*n.g(name)).size();
+  }
+  if (numCaptured > n.inputs().size()) {  // TODO: ENFORCE
+    throw std::runtime_error("Captured values are not bound to node inputs");
+  }
+  auto offset = n.inputs().size() - numCaptured;
+  for (const auto& name : attributes) {
+    auto count = capturedValues(*n.g(name)).size();
+    if (name == attr) {
+      return std::vector<const Value*>(n.inputs().begin() + offset,
+                                       n.inputs().begin() + offset + count);
+    }
+    offset += count;
+  }
+  throw std::runtime_error("Missing subgraph attribute");
+}
+
+std::vector<int64> staticSizesOf(const Value* v) {
+  if (!v->has_sizes()) {  // TODO: ENFORCE
+    throw std::runtime_error("Missing shape of " + v->uniqueName());
+  }
+  std::vector<int64> sizes;
+  for (const auto& d : v->sizes()) {
+    if (!d.is_int) {  // TODO: ENFORCE
+      throw std::runtime_error("Dynamic shape of " + v->uniqueName());
+    }
+    sizes.push_back(d.dim);
+  }
+  return sizes;
+}
+
+XlaOp leadingStartIndices(XlaBuilder& builder,
+                          const XlaOp& index,
+                          int64 rank) {
+  auto indexOp = builder.Reshape(builder.ConvertElementType(index, xla::S64),
+                                 {1});
+  if (rank == 1) {
+    return indexOp;
+  }
+  return builder.ConcatInDim(
+      {indexOp, builder.ConstantR1<int64>(std::vector<int64>(rank - 1, 0))},
+      0);
+}
+
+SubgraphTranslator::SubgraphTranslator(
+    const Graph& g,
+    const std::vector<const Value*>& capturedInputs,
+    XlaBuilder& builder,
+    const ValueOpMap& valueToOp,
+    const ValueLiteralMap& valueToLiteral)
+    : g_(g), builder_(builder) {
+  if (g.initializers().size() > 0) {  // TODO: ENFORCE
+    throw std::runtime_error("Subgraph initializers are not supported");
+  }
+  auto captured = capturedValues(g);
+  if (captured.size() != capturedInputs.size()) {  // TODO: ENFORCE
+    throw std::runtime_error("Captured values are not bound to node inputs");
+  }
+  for (auto i = 0; i < captured.size(); ++i) {
+    auto literalIt = valueToLiteral.find(capturedInputs[i]);
+    if (literalIt != valueToLiteral.end()) {
+      captured_literals_[captured[i]] = literalIt->second->CloneToUnique();
+    } else {
+      captured_values_.push_back(captured[i]);
+      captured_ops_.push_back(valueToOp.at(capturedInputs[i]));
+      captured_shapes_.push_back(
+          builder.GetShape(captured_ops_.back()).ValueOrDie());
+    }
+  }
+}
+
+const std::vector<XlaOp>& SubgraphTranslator::capturedOps() const {
+  return captured_ops_;
+}
+
+const std::vector<Shape>& SubgraphTranslator::capturedShapes() const {
+  return captured_shapes_;
+}
+
+XlaComputation SubgraphTranslator::build(const std::string& name,
+                                         const std::vector<Shape>& stateShapes,
+                                         const InputBinder& bindInputs,
+                                         const RootBuilder& buildRoot) {
+  auto subBuilder = builder_.CreateSubBuilder(name);
+  std::vector<Shape> parameterShapes(stateShapes);
+  parameterShapes.insert(parameterShapes.end(), captured_shapes_.begin(),
+                         captured_shapes_.end());
+  auto parameterOp = subBuilder->Parameter(
+      0, ShapeUtil::MakeTupleShape(parameterShapes), name + "_parameter");
+  std::vector<XlaOp> state;
+  for (auto i = 0; i < stateShapes.size(); ++i) {
+    state.push_back(subBuilder->GetTupleElement(parameterOp, i));
+  }
+  std::vector<XlaOp> captured;
+  ValueOpMap valueToOp;
+  for (auto i = 0; i < captured_values_.size(); ++i) {
+    captured.push_back(
+        subBuilder->GetTupleElement(parameterOp, stateShapes.size() + i));
+    valueToOp[captured_values_[i]] = captured.back();
+  }
+  if (bindInputs) {
+    bindInputs(*subBuilder, state, valueToOp);
+  }
+
+  // Literals of the subgraph: captured constants and Constant nodes
+  ValueLiteralMap valueToLiteral;
+  for (const auto& entry : captured_literals_) {
+    valueToLiteral[entry.first] = entry.second->CloneToUnique();
+  }
+  auto materializeConstant = [&](const Value* v) {
+    auto literalIt = valueToLiteral.find(v);
+    if (!valueToOp.count(v) && literalIt != valueToLiteral.end()) {
+      valueToOp[v] = subBuilder->ConstantLiteral(*literalIt->second);
+    }
+  };
+
+  auto& registry = OperatorRegistry::registry();
+  for (const Node* n : g_.nodes()) {
+    if (n->kind() == kCapturedKind) {
+      continue;
+    }
+    if (n->kind() == kConstant && n->hasAttribute(kvalue)) {
+      valueToLiteral[n->outputs().at(0)] = tensorToLiteral(n->t(kvalue));
+    }
+    for (const Value* v : n->inputs()) {
+      materializeConstant(v);
+    }
+    if (registry.translate(*n, *subBuilder, valueToOp, valueToLiteral) !=
+        ONNXIFI_STATUS_SUCCESS) {  // TODO: ENFORCE
+      throw std::runtime_error("Unable to translate " +
+                               std::string(n->kind().toString()) +
+                               " in subgraph " + name);
+    }
+  }
+
+  std::vector<XlaOp> outputs;
+  for (const Value* v : g_.outputs()) {
+    materializeConstant(v);
+    outputs.push_back(valueToOp.at(v));
+  }
+  buildRoot(*subBuilder, state, outputs, captured);
+  auto computationStatus = subBuilder->Build();
+  if (!computationStatus.ok()) {  // TODO: ENFORCE
+    throw std::runtime_error("Unable to build subgraph " + name + ": " +
+                             computationStatus.status().ToString());
+  }
+  return computationStatus.ConsumeValueOrDie();
+}
+}
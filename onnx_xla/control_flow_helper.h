@@ -0,0 +1,84 @@
+#pragma once
+
+#include "onnx_xla/operator_registry.h"
+
+#include <memory>
+#include <string>
+
+namespace onnx_xla {
+using ::ONNX_NAMESPACE::Graph;
+
+// Utilities to translate the subgraph attributes of control flow operators
+// (If, Loop, Scan) into computations built with sub builders.
+//
+// Values of enclosing graphs used by a subgraph appear in it as outputs of
+// Captured nodes. Before translation, the bind_captured_values pass appends
+// the corresponding enclosing values to the inputs of the control flow node
+// (see capturedInputs), so that passes see them as used and translators can
+// bind them by position.
+
+// Returns the graph attributes of n in the fixed order in which their
+// captured values are appended to the inputs of n
+std::vector<Symbol> subgraphAttributes(const Node& n);
+
+// Returns the outputs of the Captured nodes of g, in node order
+std::vector<Value*> capturedValues(const Graph& g);
+
+// Returns the inputs of n bound to the captured values of its subgraph attr
+std::vector<const Value*> capturedInputs(const Node& n, const Symbol& attr);
+
+// Returns the static sizes of v, or throws if they are unknown
+std::vector<int64> staticSizesOf(const Value* v);
+
+// Returns [0, ..., 0] start indices of a dynamic slice of rank dimensions,
+// with index as the start of the first one
+XlaOp leadingStartIndices(XlaBuilder& builder, const XlaOp& index, int64 rank);
+
+// Translates a subgraph into an XlaComputation taking a single tuple
+// parameter, made of caller-defined state elements followed by the captured
+// values that are not build time constants. Build time constants (captured
+// or Constant nodes of the subgraph) are embedded in the computation.
+class SubgraphTranslator final {
+ public:
+  // Binds the Captured nodes of g to capturedInputs (values of the enclosing
+  // graph, whose ops are in valueToOp or literals in valueToLiteral)
+  SubgraphTranslator(const Graph& g,
+                     const std::vector<const Value*>& capturedInputs,
+                     XlaBuilder& builder,
+                     const ValueOpMap& valueToOp,
+                     const ValueLiteralMap& valueToLiteral);
+
+  // Ops and shapes of the captured values passed through the parameter, to
+  // append to the state when calling the computation
+  const std::vector<XlaOp>& capturedOps() const;
+  const std::vector<Shape>& capturedShapes() const;
+
+  // Sets the ops of the subgraph inputs from the state elements
+  using InputBinder = std::function<
+      void(XlaBuilder&, const std::vector<XlaOp>& state, ValueOpMap&)>;
+  // Builds the root of the computation from the state elements, the ops of
+  // the subgraph outputs and the captured ops (which must be passed through
+  // when the computation is a While body)
+  using RootBuilder =
+      std::function<XlaOp(XlaBuilder&,
+                          const std::vector<XlaOp>& state,
+                          const std::vector<XlaOp>& outputs,
+                          const std::vector<XlaOp>& captured)>;
+
+  // Builds the computation, throwing if a node cannot be translated
+  XlaComputation build(const std::string& name,
+                       const std::vector<Shape>& stateShapes,
+                       const InputBinder& bindInputs,
+                       const RootBuilder& buildRoot);
+
+ private:
+  const Graph& g_;
+  XlaBuilder& builder_;
+  // Literals of the Captured nodes bound to build time constants
+  ValueLiteralMap captured_literals_;
+  // Captured nodes bound to values passed through the parameter, in order
+  std::vector<const Value*> captured_values_;
+  std::vector<XlaOp> captured_ops_;
+  std::vector<Shape> captured_shapes_;
+};
+}
@@ -14,7 +14,8 @@ ConvPoolHelper::ConvPoolHelper(const Node& n) {
     windowStrides.insert(windowStrides.end(), 2, 1);
     windowDilations.insert(windowDilations.end(), 2, 1);
     inputPadding.insert(inputPadding.end(), 2, std::pair<int64, int64>(0, 0));
-  } else if (n.kind() != kConv) {  // TODO: ENFORCE
+  } else if (n.kind() != kConv &&
+             n.kind() != Symbol("QLinearConv")) {  // TODO: ENFORCE
     throw std::runtime_error("Not a conv or pool node");
   }
 
@@ -94,12 +95,16 @@ void ConvPoolHelper::appendVecFromSimpleAttr(const Symbol& attr,
                                              size_t numSpatialAxes,
                                              std::vector<int64>& vec) {
   if (!n.hasAttribute(attr)) {
-    if (attr == kkernel_shape && n.kind() == kConv) {
-      const std::vector<int64_t> kernelDims = parseOnnxInputSizes(n, 1);
-      if (kernelDims.size() != numSpatialAxes) {
+    if (attr == kkernel_shape && n.kind() != Symbol("MaxPool") &&
+        n.kind() != Symbol("AveragePool")) {
+      // Spatial sizes of the weights (input 3 of QLinearConv, else 1), which
+      // follow the output and input channels
+      const std::vector<int64_t> kernelDims =
+          parseOnnxInputSizes(n, n.kind() == kConv ? 1 : 3);
+      if (kernelDims.size() != numSpatialAxes + 2) {
         throw std::runtime_error("Valid kernel shape could not be inferred");
       }
-      vec.insert(vec.end(), kernelDims.begin(), kernelDims.end());
+      vec.insert(vec.end(), kernelDims.begin() + 2, kernelDims.end());
     } else {
       vec.insert(vec.end(), numSpatialAxes, 1);
     }
@@ -113,6 +118,41 @@ void ConvPoolHelper::appendVecFromSimpleAttr(const Symbol& attr,
   }
 }
 
+XlaOp ConvPoolHelper::groupedConvolution(XlaBuilder& builder,
+                                         const XlaOp& inputOp,
+                                         const XlaOp& windowOp,
+                                         int64 numGroups,
+                                         int64 inputChannels,
+                                         int64 outputChannels) const {
+  auto dimensionNumbers =
+      XlaBuilder::CreateDefaultConvDimensionNumbers(windowStrides.size());
+  if (numGroups == 1) {
+    return builder.ConvGeneralDilated(inputOp, windowOp, windowStrides,
+                                      inputPadding, {}, windowDilations,
+                                      dimensionNumbers);
+  }
+  if (inputChannels % numGroups != 0 || outputChannels % numGroups != 0) {
+    throw std::runtime_error(
+        "Input and kernel channel numbers should be divisible by group "
+        "number");
+  }
+  auto inputChannelsPerGroup = inputChannels / numGroups;
+  auto outputChannelsPerGroup = outputChannels / numGroups;
+  std::vector<XlaOp> convOps;
+  for (auto i = 0; i < numGroups; ++i) {
+    auto inputSliceOp = builder.SliceInDim(
+        inputOp, i * inputChannelsPerGroup, (i + 1) * inputChannelsPerGroup,
+        1, 1);
+    auto windowSliceOp = builder.SliceInDim(
+        windowOp, i * outputChannelsPerGroup,
+        (i + 1) * outputChannelsPerGroup, 1, 0);
+    convOps.push_back(builder.ConvGeneralDilated(
+        inputSliceOp, windowSliceOp, windowStrides, inputPadding, {},
+        windowDilations, dimensionNumbers));
+  }
+  return builder.ConcatInDim(convOps, 1);
+}
+
 const std::vector<int64>& ConvPoolHelper::getWindowDimensions() const {
   return windowDimensions;
 }
@@ -6,11 +6,20 @@ namespace onnx_xla {
 // Utility struct to help translate Conv/MaxPool/AveragePool operators
 struct ConvPoolHelper {
  public:
-  // Given a node of kind Conv, AveragePool, or MaxPool will set the
-  // window dimensions, strides, and dilations as well as the input padding
+  // Given a node of kind Conv, QLinearConv, AveragePool, or MaxPool will set
+  // the window dimensions, strides, and dilations as well as the input padding
   // in the format compatible with XlaBuilder
   ConvPoolHelper(const Node& n);
 
+  // Convolution of inputOp by windowOp with numGroups groups, as one
+  // convolution per group concatenated along the channel axis
+  XlaOp groupedConvolution(XlaBuilder& builder,
+                           const XlaOp& inputOp,
+                           const XlaOp& windowOp,
+                           int64 numGroups,
+                           int64 inputChannels,
+                           int64 outputChannels) const;
+
   // Getter functions for relevant attributes
   const std::vector<int64>& getWindowDimensions() const;
 
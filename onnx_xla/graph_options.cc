@@ -0,0 +1,149 @@
+#include "onnx_xla/graph_options.h"
+
+#include <sstream>
+
+namespace onnx_xla {
+// Inserts the names of a ',' separated list passed as property value,
+// returning false if it is null
+static bool insertNames(uint64_t value, std::set<std::string>& set) {
+  auto names = reinterpret_cast<const char*>(value);
+  if (!names) {
+    return false;
+  }
+  std::stringstream stream(names);
+  std::string name;
+  while (std::getline(stream, name, ',')) {
+    if (!name.empty()) {
+      set.insert(name);
+    }
+  }
+  return true;
+}
+
+// Parses the numbers of a ',' separated list passed as property value,
+// returning false if it is null or malformed
+static bool parseNumbers(uint64_t value, std::vector<float>& numbers) {
+  auto text = reinterpret_cast<const char*>(value);
+  if (!text) {
+    return false;
+  }
+  std::stringstream stream(text);
+  std::string number;
+  numbers.clear();
+  while (std::getline(stream, number, ',')) {
+    try {
+      numbers.push_back(std::stof(number));
+    } catch (const std::exception& e) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Sets type from an onnxEnum data type of float32, float16 or bfloat16,
+// returning false for other data types
+static bool floatType(uint64_t dataType, PrimitiveType& type) {
+  switch (dataType) {
+    case ONNXIFI_DATATYPE_FLOAT32: {
+      type = xla::F32;
+      return true;
+    }
+    case ONNXIFI_DATATYPE_FLOAT16: {
+      type = xla::F16;
+      return true;
+    }
+    case ONNX_XLA_DATATYPE_BFLOAT16: {
+      type = xla::BF16;
+      return true;
+    }
+    default: { return false; }
+  }
+}
+
+onnxStatus parseGraphOptions(const uint64_t* auxPropertiesList,
+                             GraphOptions& options) {
+  for (auto property = auxPropertiesList;
+       property && *property != ONNXIFI_GRAPH_PROPERTY_NONE; property += 2) {
+    switch (property[0]) {
+      case ONNX_XLA_GRAPH_PROPERTY_MIXED_PRECISION: {
+        if (!floatType(property[1], options.computeType)) {
+          std::cerr << "Mixed precision must use float16 or bfloat16"
+                    << std::endl;
+          return ONNXIFI_STATUS_UNSUPPORTED_DATATYPE;
+        }
+        break;
+      }
+      case ONNX_XLA_GRAPH_PROPERTY_TRANSFER_PRECISION: {
+        if (!floatType(property[1], options.transferType)) {
+          std::cerr << "Transfers must use float16 or bfloat16" << std::endl;
+          return ONNXIFI_STATUS_UNSUPPORTED_DATATYPE;
+        }
+        break;
+      }
+      case ONNX_XLA_GRAPH_PROPERTY_FP32_OPERATORS: {
+        if (!insertNames(property[1], options.fp32Operators)) {
+          return ONNXIFI_STATUS_INVALID_POINTER;
+        }
+        break;
+      }
+      case ONNX_XLA_GRAPH_PROPERTY_REDUCED_PRECISION_OPERATORS: {
+        if (!insertNames(property[1], options.reducedPrecisionOperators)) {
+          return ONNXIFI_STATUS_INVALID_POINTER;
+        }
+        break;
+      }
+      case ONNX_XLA_GRAPH_PROPERTY_TRANSFER_VALUES: {
+        if (!insertNames(property[1], options.transferValues)) {
+          return ONNXIFI_STATUS_INVALID_POINTER;
+        }
+        break;
+      }
+      case ONNX_XLA_GRAPH_PROPERTY_IMAGE_INPUT: {
+        auto name = reinterpret_cast<const char*>(property[1]);
+        if (!name) {
+          return ONNXIFI_STATUS_INVALID_POINTER;
+        }
+        options.imageInput = name;
+        break;
+      }
+      case ONNX_XLA_GRAPH_PROPERTY_IMAGE_NHWC: {
+        options.imageNHWC = property[1] != 0;
+        break;
+      }
+      case ONNX_XLA_GRAPH_PROPERTY_IMAGE_MEAN:
+      case ONNX_XLA_GRAPH_PROPERTY_IMAGE_SCALE: {
+        if (!parseNumbers(property[1],
+                          property[0] == ONNX_XLA_GRAPH_PROPERTY_IMAGE_MEAN
+                              ? options.imageMean
+                              : options.imageScale)) {
+          std::cerr << "Invalid image normalization" << std::endl;
+          return ONNXIFI_STATUS_INVALID_POINTER;
+        }
+        break;
+      }
+      case ONNX_XLA_GRAPH_PROPERTY_STATE_VALUES: {
+        std::set<std::string> pairs;
+        if (!insertNames(property[1], pairs)) {
+          return ONNXIFI_STATUS_INVALID_POINTER;
+        }
+        for (const auto& pair : pairs) {
+          auto separator = pair.find(':');
+          if (separator == std::string::npos) {
+            std::cerr << "Invalid state value " << pair << std::endl;
+            return ONNXIFI_STATUS_INVALID_POINTER;
+          }
+          options.stateValues[pair.substr(0, separator)] =
+              pair.substr(separator + 1);
+        }
+        break;
+      }
+      case ONNX_XLA_GRAPH_PROPERTY_PIPELINE_DEPTH: {
+        options.pipelineDepth = property[1];
+        break;
+      }
+      default: { break; }
+    }
+  }
+  return ONNXIFI_STATUS_SUCCESS;
+}
+}
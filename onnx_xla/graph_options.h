@@ -0,0 +1,47 @@
+#pragma once
+
+#include "onnx_xla/operator_registry.h"
+#include "onnx_xla/onnx_xla_properties.h"
+
+#include <map>
+#include <set>
+#include <string>
+
+namespace onnx_xla {
+// Options of a graph build, set from the auxiliary properties of
+// onnxInitGraph (see onnx_xla_properties.h)
+struct GraphOptions {
+  // Float type of mixed precision computation (F16 or BF16), or F32 if mixed
+  // precision is disabled
+  PrimitiveType computeType = xla::F32;
+  // Operator types added to, and removed from, the default float32 operators
+  // of mixed precision
+  std::set<std::string> fp32Operators;
+  std::set<std::string> reducedPrecisionOperators;
+  // Float type float32 graph inputs and outputs are transferred in (F16 or
+  // BF16), or F32 if they are transferred as is
+  PrimitiveType transferType = xla::F32;
+  // Names of the inputs and outputs transferred in transferType (all float32
+  // ones if empty)
+  std::set<std::string> transferValues;
+  // Name of the float32 NCHW input passed as uint8 pixels (none if empty),
+  // whether they are NHWC, and the per channel normalization
+  // (pixel - imageMean[c]) / imageScale[c] (one value for all channels, or
+  // empty for the identity)
+  std::string imageInput;
+  bool imageNHWC = false;
+  std::vector<float> imageMean;
+  std::vector<float> imageScale;
+  // Output giving the next value of each persistent state input, keyed on the
+  // input name
+  std::map<std::string, std::string> stateValues;
+  // Runs queued between the stages of the run pipeline, or 0 to run
+  // synchronously
+  size_t pipelineDepth = 0;
+};
+
+// Fills options from an auxiliary property list terminated by
+// ONNXIFI_GRAPH_PROPERTY_NONE (or null), ignoring unknown keys
+onnxStatus parseGraphOptions(const uint64_t* auxPropertiesList,
+                             GraphOptions& options);
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+// Functions of the onnx-xla backend beyond the ONNXIFI interface
+
+#include "onnx/onnxifi.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Memory type of tensors kept on the XLA server, to chain graphs without
+// transfers through the host. The buffer of their descriptors is an
+// onnxXlaData handle cast to onnxPointer: each run of a graph with the handle
+// bound to an output replaces its tensor, and runs with the handle bound to
+// an input read the tensor on the server. Inputs and outputs transferred in
+// another type (reduced precision transfers, image input) and state outputs
+// cannot be bound to handles.
+#define ONNX_XLA_MEMORY_TYPE_XLA_DATA 0x100000000ULL
+
+// Handle to a tensor kept on the XLA server
+typedef void* onnxXlaData;
+
+// Creates an empty handle, to be filled by binding it to an output
+ONNXIFI_PUBLIC ONNXIFI_CHECK_RESULT onnxStatus ONNXIFI_ABI
+onnxXlaCreateData(onnxXlaData* data);
+
+// Releases the handle and its tensor on the server
+ONNXIFI_PUBLIC ONNXIFI_CHECK_RESULT onnxStatus ONNXIFI_ABI
+onnxXlaReleaseData(onnxXlaData data);
+
+// Sets the persistent state inputs of graph (see
+// ONNX_XLA_GRAPH_PROPERTY_STATE_VALUES) named by the descriptors to their
+// buffers, and the other state inputs to zero. Must not be called while the
+// graph runs.
+ONNXIFI_PUBLIC ONNXIFI_CHECK_RESULT onnxStatus ONNXIFI_ABI
+onnxXlaResetGraphState(onnxGraph graph,
+                       uint32_t stateCount,
+                       const onnxTensorDescriptorV1* stateDescriptors);
+
+// Copies the current value of the persistent state inputs of graph named by
+// the descriptors to their buffers. Must not be called while the graph runs.
+ONNXIFI_PUBLIC ONNXIFI_CHECK_RESULT onnxStatus ONNXIFI_ABI
+onnxXlaSnapshotGraphState(onnxGraph graph,
+                          uint32_t stateCount,
+                          const onnxTensorDescriptorV1* stateDescriptors);
+
+// Flags of onnxXlaAllocateBuffer: back the buffer with transparent huge pages,
+// or with huge pages reserved by the system (falling back to transparent huge
+// pages if none are available). Both are ignored for buffers under 1MB, which
+// would otherwise be rounded up to a 2MB huge page.
+#define ONNX_XLA_BUFFER_TRANSPARENT_HUGE_PAGES 0x1ULL
+#define ONNX_XLA_BUFFER_HUGE_PAGES 0x2ULL
+
+// Allocates a CPU IO buffer of size bytes, 64-byte aligned and allocated with
+// the ONNX_XLA_BUFFER_* flags. Inputs bound to such buffers are transferred to
+// the XLA server without staging copies.
+ONNXIFI_PUBLIC ONNXIFI_CHECK_RESULT onnxStatus ONNXIFI_ABI
+onnxXlaAllocateBuffer(size_t size, uint64_t flags, onnxPointer* buffer);
+
+// Frees a buffer allocated by onnxXlaAllocateBuffer
+ONNXIFI_PUBLIC ONNXIFI_CHECK_RESULT onnxStatus ONNXIFI_ABI
+onnxXlaReleaseBuffer(onnxPointer buffer);
+
+// IO slots: sets of IO buffers bound to graph once (validated as by
+// onnxSetGraphIO), to run the graph on any of them by index, e.g. to double
+// or triple buffer a serving loop. While slot i runs, the application fills
+// slot i + 1 and calls onnxXlaPrefetchGraphIOSlot, which transfers its inputs
+// in the background. Slots are numbered from 0 in the order they are added,
+// and unknown slots return ONNXIFI_STATUS_INVALID_ID. Slots must not be added
+// while the graph runs, and runs of a graph must not be concurrent.
+ONNXIFI_PUBLIC ONNXIFI_CHECK_RESULT onnxStatus ONNXIFI_ABI
+onnxXlaAddGraphIOSlot(onnxGraph graph,
+                      uint32_t inputsCount,
+                      const onnxTensorDescriptorV1* inputDescriptors,
+                      uint32_t outputsCount,
+                      const onnxTensorDescriptorV1* outputDescriptors,
+                      uint32_t* slot);
+
+// Transfers the inputs of slot to the XLA server in the background once the
+// event of inputFence is signalled, taken by the next run of slot. The
+// application signals the event when it has filled the input buffers, which
+// must then hold their values until the run; the event must stay alive until
+// the run too. If the wait on the event fails, so does the run.
+ONNXIFI_PUBLIC ONNXIFI_CHECK_RESULT onnxStatus ONNXIFI_ABI
+onnxXlaPrefetchGraphIOSlot(onnxGraph graph,
+                           uint32_t slot,
+                           const onnxMemoryFenceV1* inputFence);
+
+// Runs graph on the buffers of slot, as onnxRunGraph does on the buffers of
+// onnxSetGraphIO
+ONNXIFI_PUBLIC ONNXIFI_CHECK_RESULT onnxStatus ONNXIFI_ABI
+onnxXlaRunGraphIOSlot(onnxGraph graph,
+                      uint32_t slot,
+                      const onnxMemoryFenceV1* inputFence,
+                      onnxMemoryFenceV1* outputFence);
+
+// Returns in runStatus the status of the run of graph whose output fence has
+// event outputEvent, after the event is signalled. Pipelined runs (see
+// ONNX_XLA_GRAPH_PROPERTY_PIPELINE_DEPTH) signal their fence even when they
+// fail, which only this status tells; other runs return their failure, and
+// ONNXIFI_STATUS_SUCCESS is set for them. A failure is only returned once.
+ONNXIFI_PUBLIC ONNXIFI_CHECK_RESULT onnxStatus ONNXIFI_ABI
+onnxXlaGetRunStatus(onnxGraph graph,
+                    onnxEvent outputEvent,
+                    onnxStatus* runStatus);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,5 +1,8 @@
 #include "onnx/onnxifi.h"
 #include "onnx_xla/onnxifi_helper.h"
+#include "onnx_xla/buffer_allocator.h"
+#include "onnx_xla/onnx_xla_extensions.h"
+#include "onnx_xla/plugin_loader.h"
 #include <thread>
 #include <mutex>
 #include <condition_variable>
@@ -117,7 +120,8 @@ onnxGetBackendInfo(onnxBackendID backendID,
         return SET_UINT64(0UL);
       }
       case ONNXIFI_BACKEND_MEMORY_TYPES: {
-        return SET_UINT64(ONNXIFI_MEMORY_TYPE_CPU);
+        return SET_UINT64(ONNXIFI_MEMORY_TYPE_CPU |
+                          ONNX_XLA_MEMORY_TYPE_XLA_DATA);
       }
       case ONNXIFI_BACKEND_MEMORY_SIZE: {
         // TODO
@@ -162,13 +166,33 @@ onnxGetBackendCompatibility(onnxBackendID backendID,
   });
 }
 
-// TODO: any arguments to pass?
 // Create and return a BackendControl object
+// Loads translator plugins listed in ONNX_XLA_PLUGINS and in the
+// ONNX_XLA_BACKEND_PROPERTY_PLUGINS auxiliary property (see
+// onnx_xla_plugin.h); other auxiliary properties are ignored
 ONNXIFI_PUBLIC ONNXIFI_CHECK_RESULT onnxStatus ONNXIFI_ABI
 onnxInitBackend(onnxBackendID backendID,
                 const uint64_t* auxPropertiesList,
                 onnxBackend* backend) {
   return onnxifiTryCatch([&] {
+    auto pluginStatus = onnx_xla::loadPluginsFromEnvironment();
+    if (pluginStatus != ONNXIFI_STATUS_SUCCESS) {
+      return pluginStatus;
+    }
+    for (auto property = auxPropertiesList;
+         property && *property != ONNXIFI_BACKEND_PROPERTY_NONE;
+         property += 2) {
+      if (*property == ONNX_XLA_BACKEND_PROPERTY_PLUGINS) {
+        auto paths = reinterpret_cast<const char*>(property[1]);
+        if (!paths) {
+          return ONNXIFI_STATUS_INVALID_POINTER;
+        }
+        pluginStatus = onnx_xla::loadPlugins(paths);
+        if (pluginStatus != ONNXIFI_STATUS_SUCCESS) {
+          return pluginStatus;
+        }
+      }
+    }
     auto* backend_id = reinterpret_cast<OnnxXlaBackendID*>(backendID);
     *backend = reinterpret_cast<onnxBackend>(new BackendControl(backend_id));
     return ONNXIFI_STATUS_SUCCESS;
@@ -189,6 +213,7 @@ onnxReleaseBackend(onnxBackend backend) {
 }
 
 // Create and return XlaExecutor object
+// Auxiliary properties set the build options (see onnx_xla_properties.h)
 // TODO: Ignore the weightDescriptors for now and rely on initialization list
 // TODO: more robust error handling in header file to be included
 ONNXIFI_PUBLIC ONNXIFI_CHECK_RESULT onnxStatus ONNXIFI_ABI
@@ -210,13 +235,20 @@ onnxInitGraph(onnxBackend backend,
     if (onnxModelSize == 0) {
       return ONNXIFI_STATUS_INVALID_SIZE;
     }
+    onnx_xla::GraphOptions options;
+    auto optionsStatus =
+        onnx_xla::parseGraphOptions(auxPropertiesList, options);
+    if (optionsStatus != ONNXIFI_STATUS_SUCCESS) {
+      return optionsStatus;
+    }
     auto* backendController = reinterpret_cast<BackendControl*>(backend);
     return backendController->build(onnxModel, onnxModelSize, weightsCount,
-                                    weightDescriptors, graph);
+                                    weightDescriptors, options, graph);
   });
 }
 
-// Verify IO metadata and use initIO to store location of IO
+// Verify IO metadata and use initIO to store location of IO. Outputs left out,
+// or passed with a null buffer, are not transferred by onnxRunGraph
 // TODO: memoryType field ignored for now
 // TODO: more robust error handling in header file to be included
 ONNXIFI_PUBLIC ONNXIFI_CHECK_RESULT onnxStatus ONNXIFI_ABI
@@ -229,7 +261,8 @@ onnxSetGraphIO(onnxGraph graph,
     if (!graph) {
       return ONNXIFI_STATUS_INVALID_GRAPH;
     }
-    if (!inputDescriptors || !outputDescriptors) {
+    if ((inputsCount && !inputDescriptors) ||
+        (outputsCount && !outputDescriptors)) {
       return ONNXIFI_STATUS_INVALID_POINTER;
     }
     auto* executor = reinterpret_cast<onnx_xla::XlaExecutor*>(graph);
@@ -238,6 +271,40 @@ onnxSetGraphIO(onnxGraph graph,
   });
 }
 
+// Verifies the memory fences of a run and initializes the output event
+// TODO: Status code specific to events
+// TODO: Inform user that only ONNXIFI_SYNCHRONIZATION_EVENT is the only
+// acceptable type
+static onnxStatus initRunFences(onnx_xla::XlaExecutor* executor,
+                                const onnxMemoryFenceV1* inputFence,
+                                onnxMemoryFenceV1* outputFence) {
+  if (!inputFence) {
+    throw std::runtime_error("Invalid input memory fence");
+  }
+  if (inputFence->tag != ONNXIFI_TAG_MEMORY_FENCE_V1) {
+    return ONNXIFI_STATUS_UNSUPPORTED_TAG;
+  }
+  if (inputFence->type != ONNXIFI_SYNCHRONIZATION_EVENT) {
+    throw std::runtime_error(
+        "The input memory fence must have type "
+        "ONNXIFI_SYNCHRONIZATION_EVENT. "
+        "The event must be initialized.");
+  }
+  if (!outputFence) {
+    throw std::runtime_error("Invalid output memory fence");
+  }
+  if (outputFence->tag != ONNXIFI_TAG_MEMORY_FENCE_V1) {
+    return ONNXIFI_STATUS_UNSUPPORTED_TAG;
+  }
+  if (outputFence->type != ONNXIFI_SYNCHRONIZATION_EVENT) {
+    throw std::runtime_error(
+        "The output memory fence must have type "
+        "ONNXIFI_SYNCHRONIZATION_EVENT. "
+        "The event cannot be initialized.");
+  }
+  return onnxInitEvent(executor->backend_, &outputFence->event);
+}
+
 // Runs the XlaExecutor by sending literals to server and executing computation
 // TODO: support for synchronization primitives; For now assume, they are always
 // set
@@ -250,36 +317,8 @@ onnxRunGraph(onnxGraph graph,
     if (!graph) {
       return ONNXIFI_STATUS_INVALID_GRAPH;
     }
-    // TODO: Status code specific to events
-    // TODO: Inform user that only ONNXIFI_SYNCHRONIZATION_EVENT is the only
-    // acceptable type
-    if (!inputFence) {
-      throw std::runtime_error("Invalid input memory fence");
-    }
-    if (inputFence->tag != ONNXIFI_TAG_MEMORY_FENCE_V1) {
-      return ONNXIFI_STATUS_UNSUPPORTED_TAG;
-    }
-    if (inputFence->type != ONNXIFI_SYNCHRONIZATION_EVENT) {
-      throw std::runtime_error(
-          "The input memory fence must have type "
-          "ONNXIFI_SYNCHRONIZATION_EVENT. "
-          "The event must be initialized.");
-    }
-    if (!outputFence) {
-      throw std::runtime_error("Invalid output memory fence");
-    }
-    if (outputFence->tag != ONNXIFI_TAG_MEMORY_FENCE_V1) {
-      return ONNXIFI_STATUS_UNSUPPORTED_TAG;
-    }
-    if (outputFence->type != ONNXIFI_SYNCHRONIZATION_EVENT) {
-      throw std::runtime_error(
-          "The output memory fence must have type "
-          "ONNXIFI_SYNCHRONIZATION_EVENT. "
-          "The event cannot be initialized.");
-    }
-
     auto* executor = reinterpret_cast<onnx_xla::XlaExecutor*>(graph);
-    auto initStatus = onnxInitEvent(executor->backend_, &outputFence->event);
+    auto initStatus = initRunFences(executor, inputFence, outputFence);
     if (initStatus != ONNXIFI_STATUS_SUCCESS) {
       return initStatus;
     }
@@ -389,3 +428,182 @@ onnxReleaseEvent(onnxEvent event) {
     return ONNXIFI_STATUS_SUCCESS;
   });
 }
+
+// Sets the persistent state of the XlaExecutor (see onnx_xla_extensions.h)
+ONNXIFI_PUBLIC ONNXIFI_CHECK_RESULT onnxStatus ONNXIFI_ABI
+onnxXlaResetGraphState(onnxGraph graph,
+                       uint32_t stateCount,
+                       const onnxTensorDescriptorV1* stateDescriptors) {
+  return onnxifiTryCatch([&] {
+    if (!graph) {
+      return ONNXIFI_STATUS_INVALID_GRAPH;
+    }
+    if (stateCount && !stateDescriptors) {
+      return ONNXIFI_STATUS_INVALID_POINTER;
+    }
+    auto* executor = reinterpret_cast<onnx_xla::XlaExecutor*>(graph);
+    return executor->resetState(stateCount, stateDescriptors);
+  });
+}
+
+// Reads the persistent state of the XlaExecutor (see onnx_xla_extensions.h)
+ONNXIFI_PUBLIC ONNXIFI_CHECK_RESULT onnxStatus ONNXIFI_ABI
+onnxXlaSnapshotGraphState(onnxGraph graph,
+                          uint32_t stateCount,
+                          const onnxTensorDescriptorV1* stateDescriptors) {
+  return onnxifiTryCatch([&] {
+    if (!graph) {
+      return ONNXIFI_STATUS_INVALID_GRAPH;
+    }
+    if (stateCount && !stateDescriptors) {
+      return ONNXIFI_STATUS_INVALID_POINTER;
+    }
+    auto* executor = reinterpret_cast<onnx_xla::XlaExecutor*>(graph);
+    return executor->snapshotState(stateCount, stateDescriptors);
+  });
+}
+
+// Creates an empty XlaData (see onnx_xla_extensions.h)
+ONNXIFI_PUBLIC ONNXIFI_CHECK_RESULT onnxStatus ONNXIFI_ABI
+onnxXlaCreateData(onnxXlaData* data) {
+  return onnxifiTryCatch([&] {
+    if (!data) {
+      return ONNXIFI_STATUS_INVALID_POINTER;
+    }
+    *data = reinterpret_cast<onnxXlaData>(new onnx_xla::XlaData());
+    return ONNXIFI_STATUS_SUCCESS;
+  });
+}
+
+// Frees the XlaData, which releases its tensor on the server
+ONNXIFI_PUBLIC ONNXIFI_CHECK_RESULT onnxStatus ONNXIFI_ABI
+onnxXlaReleaseData(onnxXlaData data) {
+  return onnxifiTryCatch([&] {
+    if (!data) {
+      return ONNXIFI_STATUS_INVALID_POINTER;
+    }
+    delete reinterpret_cast<onnx_xla::XlaData*>(data);
+    return ONNXIFI_STATUS_SUCCESS;
+  });
+}
+
+// Allocates an IO buffer (see onnx_xla_extensions.h)
+ONNXIFI_PUBLIC ONNXIFI_CHECK_RESULT onnxStatus ONNXIFI_ABI
+onnxXlaAllocateBuffer(size_t size, uint64_t flags, onnxPointer* buffer) {
+  return onnxifiTryCatch([&] {
+    if (!buffer) {
+      return ONNXIFI_STATUS_INVALID_POINTER;
+    }
+    auto data = onnx_xla::allocateBuffer(size, flags);
+    if (!data) {
+      return ONNXIFI_STATUS_NO_SYSTEM_MEMORY;
+    }
+    *buffer = reinterpret_cast<onnxPointer>(data);
+    return ONNXIFI_STATUS_SUCCESS;
+  });
+}
+
+// Frees an IO buffer of onnxXlaAllocateBuffer
+ONNXIFI_PUBLIC ONNXIFI_CHECK_RESULT onnxStatus ONNXIFI_ABI
+onnxXlaReleaseBuffer(onnxPointer buffer) {
+  return onnxifiTryCatch([&] {
+    if (!onnx_xla::freeBuffer(reinterpret_cast<void*>(buffer))) {
+      return ONNXIFI_STATUS_INVALID_POINTER;
+    }
+    return ONNXIFI_STATUS_SUCCESS;
+  });
+}
+
+// Binds IO buffers to a new IO slot of the XlaExecutor (see
+// onnx_xla_extensions.h)
+ONNXIFI_PUBLIC ONNXIFI_CHECK_RESULT onnxStatus ONNXIFI_ABI
+onnxXlaAddGraphIOSlot(onnxGraph graph,
+                      uint32_t inputsCount,
+                      const onnxTensorDescriptorV1* inputDescriptors,
+                      uint32_t outputsCount,
+                      const onnxTensorDescriptorV1* outputDescriptors,
+                      uint32_t* slot) {
+  return onnxifiTryCatch([&] {
+    if (!graph) {
+      return ONNXIFI_STATUS_INVALID_GRAPH;
+    }
+    if ((inputsCount && !inputDescriptors) ||
+        (outputsCount && !outputDescriptors) || !slot) {
+      return ONNXIFI_STATUS_INVALID_POINTER;
+    }
+    auto* executor = reinterpret_cast<onnx_xla::XlaExecutor*>(graph);
+    return executor->addIOSlot(inputsCount, inputDescriptors, outputsCount,
+                               outputDescriptors, slot);
+  });
+}
+
+// Starts transferring the inputs of an IO slot to the server once the input
+// fence is signalled
+ONNXIFI_PUBLIC ONNXIFI_CHECK_RESULT onnxStatus ONNXIFI_ABI
+onnxXlaPrefetchGraphIOSlot(onnxGraph graph,
+                           uint32_t slot,
+                           const onnxMemoryFenceV1* inputFence) {
+  return onnxifiTryCatch([&] {
+    if (!graph) {
+      return ONNXIFI_STATUS_INVALID_GRAPH;
+    }
+    if (!inputFence) {
+      throw std::runtime_error("Invalid input memory fence");
+    }
+    if (inputFence->tag != ONNXIFI_TAG_MEMORY_FENCE_V1) {
+      return ONNXIFI_STATUS_UNSUPPORTED_TAG;
+    }
+    if (inputFence->type != ONNXIFI_SYNCHRONIZATION_EVENT) {
+      throw std::runtime_error(
+          "The input memory fence must have type "
+          "ONNXIFI_SYNCHRONIZATION_EVENT. "
+          "The event must be initialized.");
+    }
+    auto* executor = reinterpret_cast<onnx_xla::XlaExecutor*>(graph);
+    return executor->prefetchSlot(slot, inputFence);
+  });
+}
+
+// Runs the XlaExecutor on the buffers of an IO slot, as onnxRunGraph
+ONNXIFI_PUBLIC ONNXIFI_CHECK_RESULT onnxStatus ONNXIFI_ABI
+onnxXlaRunGraphIOSlot(onnxGraph graph,
+                      uint32_t slot,
+                      const onnxMemoryFenceV1* inputFence,
+                      onnxMemoryFenceV1* outputFence) {
+  return onnxifiTryCatch([&] {
+    if (!graph) {
+      return ONNXIFI_STATUS_INVALID_GRAPH;
+    }
+    auto* executor = reinterpret_cast<onnx_xla::XlaExecutor*>(graph);
+    // Before the output event is created, which an unknown slot would leak
+    if (!executor->hasSlot(slot)) {
+      return ONNXIFI_STATUS_INVALID_ID;
+    }
+    auto initStatus = initRunFences(executor, inputFence, outputFence);
+    if (initStatus != ONNXIFI_STATUS_SUCCESS) {
+      return initStatus;
+    }
+    return executor->executeSlot(slot, inputFence, outputFence);
+  });
+}
+
+// Returns the status of a run of the XlaExecutor, by output event
+ONNXIFI_PUBLIC ONNXIFI_CHECK_RESULT onnxStatus ONNXIFI_ABI
+onnxXlaGetRunStatus(onnxGraph graph,
+                    onnxEvent outputEvent,
+                    onnxStatus* runStatus) {
+  return onnxifiTryCatch([&] {
+    if (!graph) {
+      return ONNXIFI_STATUS_INVALID_GRAPH;
+    }
+    if (!outputEvent) {
+      return ONNXIFI_STATUS_INVALID_EVENT;
+    }
+    if (!runStatus) {
+      return ONNXIFI_STATUS_INVALID_POINTER;
+    }
+    auto* executor = reinterpret_cast<onnx_xla::XlaExecutor*>(graph);
+    *runStatus = executor->runStatus(outputEvent);
+    return ONNXIFI_STATUS_SUCCESS;
+  });
+}
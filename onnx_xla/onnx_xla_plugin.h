@@ -0,0 +1,71 @@
+#pragma once
+
+// Interface between the onnx-xla backend and shared libraries providing
+// operator translators (e.g. for operators of custom domains).
+//
+// A plugin exports ONNX_XLA_PLUGIN_INIT_SYMBOL with the OnnxXlaPluginInit
+// signature. When the plugin is loaded (see onnxInitBackend), the backend
+// calls it with ONNX_XLA_PLUGIN_API_VERSION and a registration function, which
+// the plugin calls once per translator.
+//
+// Only the entry point and registration use C types. Translate functions
+// receive the backend's C++ objects through opaque pointers, so a plugin must
+// be built against the same ONNX (and ONNX_NAMESPACE) and XLA headers:
+//  node: const ONNX_NAMESPACE::Node*
+//  builder: xla::XlaBuilder*
+//  valueToOp: onnx_xla::ValueOpMap* (inputs are set, outputs must be set)
+//  valueToLiteral: const onnx_xla::ValueLiteralMap*
+
+#include "onnx/onnxifi.h"
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ONNX_XLA_PLUGIN_API_VERSION 1
+
+#define ONNX_XLA_PLUGIN_INIT_SYMBOL "onnxXlaPluginInit"
+
+// Paths of plugins to load, separated by ':'. Used as key of an auxiliary
+// property of onnxInitBackend whose value is a const char* cast to uint64_t
+#define ONNX_XLA_BACKEND_PROPERTY_PLUGINS 0x4F58504C5547494EULL
+
+// Environment variable holding paths of plugins to load, separated by ':'
+#define ONNX_XLA_PLUGINS_ENV "ONNX_XLA_PLUGINS"
+
+typedef onnxStatus (*OnnxXlaTranslateFunction)(const void* node,
+                                               void* builder,
+                                               void* valueToOp,
+                                               const void* valueToLiteral);
+
+// Returns nonzero if the translator applies to the node (NULL: always applies)
+typedef int (*OnnxXlaPredicateFunction)(const void* node,
+                                        const void* valueToLiteral);
+
+typedef struct OnnxXlaTranslatorDescriptor {
+  // Operator set domain and operator type
+  const char* domain;
+  const char* opType;
+  // Opset versions of domain the translator is valid for (inclusive)
+  int64_t sinceVersion;
+  int64_t untilVersion;
+  // Higher priorities are preferred among applicable translators
+  int32_t priority;
+  // Name of the implementation, unique for domain, opType and versions
+  const char* variant;
+  OnnxXlaPredicateFunction predicate;
+  OnnxXlaTranslateFunction translate;
+} OnnxXlaTranslatorDescriptor;
+
+typedef onnxStatus (*OnnxXlaRegisterTranslatorFunction)(
+    const OnnxXlaTranslatorDescriptor* descriptor);
+
+typedef onnxStatus (*OnnxXlaPluginInit)(
+    uint32_t apiVersion,
+    OnnxXlaRegisterTranslatorFunction registerTranslator);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,81 @@
+#pragma once
+
+// Auxiliary properties of onnxInitGraph understood by the onnx-xla backend.
+// Each key is followed in the property list by its value cast to uint64_t;
+// other keys are ignored.
+
+#include "onnx/onnxifi.h"
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// onnxEnum value of the bfloat16 data type (TensorProto.BFLOAT16), which
+// onnxifi.h does not define
+#define ONNX_XLA_DATATYPE_BFLOAT16 16
+
+// Automatic mixed precision: float operators compute in the given data type
+// (ONNXIFI_DATATYPE_FLOAT16 or ONNX_XLA_DATATYPE_BFLOAT16) and float weights
+// are stored in it. Graph inputs and outputs keep their declared types.
+// Default: ONNXIFI_DATATYPE_FLOAT32 (disabled)
+#define ONNX_XLA_GRAPH_PROPERTY_MIXED_PRECISION 0x4F584D4958505243ULL
+
+// Operator types to keep in float32 under mixed precision, in addition to the
+// default ones (normalizations, Softmax, reductions), separated by ','. Value
+// is a const char* cast to uint64_t
+#define ONNX_XLA_GRAPH_PROPERTY_FP32_OPERATORS 0x4F58465033324F50ULL
+
+// Operator types to compute in the reduced type under mixed precision even if
+// kept in float32 by default, separated by ','. Value is a const char* cast to
+// uint64_t
+#define ONNX_XLA_GRAPH_PROPERTY_REDUCED_PRECISION_OPERATORS \
+  0x4F584C4F57504F50ULL
+
+// Reduced precision transfers: float32 graph inputs and outputs travel between
+// the client and the XLA server in the given data type
+// (ONNXIFI_DATATYPE_FLOAT16 or ONNX_XLA_DATATYPE_BFLOAT16) and are converted on
+// both ends. Buffers passed to onnxSetGraphIO stay float32.
+// Default: ONNXIFI_DATATYPE_FLOAT32 (disabled)
+#define ONNX_XLA_GRAPH_PROPERTY_TRANSFER_PRECISION 0x4F58584652505243ULL
+
+// Names of the graph inputs and outputs transferred in reduced precision,
+// separated by ','. Value is a const char* cast to uint64_t.
+// Default: all float32 inputs and outputs
+#define ONNX_XLA_GRAPH_PROPERTY_TRANSFER_VALUES 0x4F5858465256414CULL
+
+// Name of a float32 NCHW image input of the model that clients pass as raw
+// uint8 pixels instead: the computation converts, transposes (see
+// ONNX_XLA_GRAPH_PROPERTY_IMAGE_NHWC) and normalizes it to
+// (pixel - mean[c]) / scale[c]. Value is a const char* cast to uint64_t
+#define ONNX_XLA_GRAPH_PROPERTY_IMAGE_INPUT 0x4F58494D47494E50ULL
+
+// Nonzero if the uint8 image input is passed in NHWC layout (default: NCHW)
+#define ONNX_XLA_GRAPH_PROPERTY_IMAGE_NHWC 0x4F58494D474E4857ULL
+
+// Per channel mean and scale of the uint8 image input, as decimal numbers
+// separated by ',' (one per channel, or one for all channels). Value is a
+// const char* cast to uint64_t. Default: mean 0, scale 1
+#define ONNX_XLA_GRAPH_PROPERTY_IMAGE_MEAN 0x4F58494D474D4541ULL
+#define ONNX_XLA_GRAPH_PROPERTY_IMAGE_SCALE 0x4F58494D4753434CULL
+
+// Persistent state, as pairs "input:output" separated by ',' where output is
+// the next value of input (e.g. the hidden state of a streaming model). State
+// inputs are not passed to onnxSetGraphIO: they stay on the XLA server between
+// onnxRunGraph calls, start at zero, and are set and read with the functions
+// of onnx_xla_extensions.h. Value is a const char* cast to uint64_t
+#define ONNX_XLA_GRAPH_PROPERTY_STATE_VALUES 0x4F58535441544556ULL
+
+// Pipelined runs: onnxRunGraph queues the run and returns, and a thread per
+// stage (input conversion, upload, execution, download, output copy) works
+// on consecutive runs at once, with at most the given number of runs queued
+// before each stage. The output fence is signalled when the outputs are in
+// their buffers, or when the run failed: onnxXlaGetRunStatus then returns its
+// failure.
+// Default: 0 (runs complete before onnxRunGraph returns)
+#define ONNX_XLA_GRAPH_PROPERTY_PIPELINE_DEPTH 0x4F58504950454C4EULL
+
+#ifdef __cplusplus
+}
+#endif
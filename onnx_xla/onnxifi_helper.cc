@@ -9,17 +9,20 @@ onnxStatus BackendControl::build(
     size_t serializedModelSize,
     uint32_t weightsCount,
     const onnxTensorDescriptorV1* weightDescriptors,
+    const onnx_xla::GraphOptions& options,
     onnxGraph* graph) {
   onnx_xla::OnnxParser parser(serializedModel, serializedModelSize);
   std::unique_ptr<ONNX_NAMESPACE::Graph> ir(nullptr);
-  auto parseStatus = parser.parse(ir);
+  onnx_xla::OpsetVersionMap opsetVersions;
+  auto parseStatus = parser.parse(ir, opsetVersions);
   if (parseStatus != ONNXIFI_STATUS_SUCCESS) {
     return parseStatus;
   }
   std::string build_name = ir->name();
   onnx_xla::XlaTransform runner(reinterpret_cast<onnxBackend>(this),
                                 std::move(ir), build_name, weightsCount,
-                                weightDescriptors);
+                                weightDescriptors, std::move(opsetVersions),
+                                options);
   auto translateStatus = runner.translateGraph();
   if (translateStatus != ONNXIFI_STATUS_SUCCESS) {
     return translateStatus;
@@ -25,6 +25,7 @@ struct BackendControl {
                    size_t serializedModelSize,
                    uint32_t weightsCount,
                    const onnxTensorDescriptorV1* weightDescriptors,
+                   const onnx_xla::GraphOptions& options,
                    onnxGraph* graph);
 
  private:
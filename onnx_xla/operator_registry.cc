@@ -1,25 +1,77 @@
 #include "onnx_xla/operator_registry.h"
+#include "onnx_xla/autotuner.h"
 
 namespace onnx_xla {
+// "ai.onnx" is an alias of the default domain
+static std::string canonicalDomain(const std::string& domain) {
+  return domain == "ai.onnx" ? "" : domain;
+}
 
 OperatorRegistry::OperatorRegisterOnce::OperatorRegisterOnce(
-    const Symbol& nodeKind,
-    TranslationFunction translator) {
+    TranslatorEntry entry) {
+  OperatorRegistry::registerTranslator(std::move(entry));
+}
+
+void OperatorRegistry::registerTranslator(TranslatorEntry entry) {
+  std::lock_guard<std::mutex> lock(OperatorRegistry::mutex());
+  entry.domain = canonicalDomain(entry.domain);
+  auto& entries = OperatorRegistry::map()[entry.kind];
+  for (const auto& other : entries) {
+    if (other->domain == entry.domain && other->variant == entry.variant &&
+        other->sinceVersion <= entry.untilVersion &&
+        entry.sinceVersion <= other->untilVersion) {
+      throw std::runtime_error("Registry error: Operator added more than once");
+    }
+  }
+  // Keep entries sorted by decreasing priority (stable for equal priorities)
+  auto position =
+      std::find_if(entries.begin(), entries.end(),
+                   [&](const std::unique_ptr<TranslatorEntry>& other) {
+                     return other->priority < entry.priority;
+                   });
+  entries.emplace(position, new TranslatorEntry(std::move(entry)));
+}
+
+std::vector<const TranslatorEntry*> OperatorRegistry::candidates(
+    const Node& n,
+    const ValueLiteralMap& valueToLiteral,
+    const OpsetVersionMap& opsetVersions) {
+  std::vector<const TranslatorEntry*> applicable;
+  std::lock_guard<std::mutex> lock(OperatorRegistry::mutex());
   auto& map = OperatorRegistry::map();
-  if (!map.insert(std::pair<Symbol, TranslationFunction>(nodeKind, translator))
-           .second) {
-    throw std::runtime_error("Registry error: Operator added more than once");
+  auto it = map.find(n.kind());
+  if (it == map.end()) {
+    return applicable;
+  }
+  const std::string domain = canonicalDomain(n.domain());
+  auto versionIt = opsetVersions.find(domain);
+  for (const auto& entry : it->second) {
+    if (entry->domain != domain) {
+      continue;
+    }
+    if (versionIt != opsetVersions.end() &&
+        (versionIt->second < entry->sinceVersion ||
+         versionIt->second > entry->untilVersion)) {
+      continue;
+    }
+    if (entry->predicate && !entry->predicate(n, valueToLiteral)) {
+      continue;
+    }
+    applicable.push_back(entry.get());
   }
+  return applicable;
 }
 
 onnxStatus OperatorRegistry::translate(const Node& n,
                                        XlaBuilder& builder,
                                        ValueOpMap& valueToOp,
-                                       const ValueLiteralMap& valueToLiteral) {
-  auto& map = OperatorRegistry::map();
-  auto it = map.find(n.kind());
-  if (it != map.end()) {
-    return it->second(n, builder, valueToOp, valueToLiteral);
+                                       const ValueLiteralMap& valueToLiteral,
+                                       const OpsetVersionMap& opsetVersions) {
+  auto applicable = candidates(n, valueToLiteral, opsetVersions);
+  if (!applicable.empty()) {
+    auto entry =
+        TranslationTuner::tuner().choose(n, applicable, valueToLiteral);
+    return entry->translator(n, builder, valueToOp, valueToLiteral);
   } else {
     std::cerr << "Operator translator not found" << std::endl;
     return ONNXIFI_STATUS_UNSUPPORTED_OPERATOR;
@@ -31,8 +83,13 @@ OperatorRegistry& OperatorRegistry::registry() {
   return registry_;
 }
 
-TranslationMap& OperatorRegistry::map() {
-  static TranslationMap map;
+TranslatorMap& OperatorRegistry::map() {
+  static TranslatorMap map;
   return map;
 }
+
+std::mutex& OperatorRegistry::mutex() {
+  static std::mutex mutex;
+  return mutex;
+}
 }
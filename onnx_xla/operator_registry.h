@@ -13,6 +13,8 @@
 #include <utility>
 #include <algorithm>
 #include <cmath>
+#include <limits>
+#include <mutex>
 #include <numeric>
 
 namespace onnx_xla {
@@ -39,7 +41,38 @@ using ValueLiteralMap =
 using ValueOpMap = std::unordered_map<const Value*, XlaOp>;
 using TranslationFunction = std::function<
     onnxStatus(const Node&, XlaBuilder&, ValueOpMap&, const ValueLiteralMap&)>;
-using TranslationMap = std::unordered_map<Symbol, TranslationFunction>;
+
+// Returns true if a translator applies to the given node (e.g. supports its
+// attributes or shapes)
+using ApplicabilityPredicate =
+    std::function<bool(const Node&, const ValueLiteralMap&)>;
+
+// Maps each operator set domain ("" for the default ONNX domain) imported by
+// the model to its version
+using OpsetVersionMap = std::unordered_map<std::string, int64>;
+
+// Highest opset version a translator can be registered for
+const int64 kMaxOpsetVersion = std::numeric_limits<int64>::max();
+
+// Domain of the operators that graph passes create (e.g. fused patterns),
+// which models do not import
+const char* const kOnnxXlaDomain = "onnx_xla";
+
+// One implementation of an operator, valid for the opset versions
+// [sinceVersion, untilVersion] of domain. Among applicable implementations,
+// the one with the highest priority is used by default.
+struct TranslatorEntry {
+  std::string domain;
+  Symbol kind;
+  int64 sinceVersion;
+  int64 untilVersion;
+  int priority;
+  std::string variant;
+  ApplicabilityPredicate predicate;  // Always applies if empty
+  TranslationFunction translator;
+};
+using TranslatorMap =
+    std::unordered_map<Symbol, std::vector<std::unique_ptr<TranslatorEntry>>>;
 
 // Class for registry of ONNX operators with corresponding translation functions
 class OperatorRegistry final {
@@ -47,18 +80,33 @@ class OperatorRegistry final {
   // Use constructor (through macro) to register translator at static time
   class OperatorRegisterOnce final {
    public:
-    OperatorRegisterOnce(const Symbol& nodeKind,
-                         TranslationFunction translator);
+    OperatorRegisterOnce(TranslatorEntry entry);
   };
 
-  // Translate given node
+  // Adds entry to the registry, at static time (through the macros) or when
+  // loading plugins. Throws if an entry with the same domain, kind and variant
+  // overlaps its opset range.
+  static void registerTranslator(TranslatorEntry entry);
+
+  // Translate given node with the applicable implementation chosen by the
+  // TranslationTuner (see autotuner.h)
   // Updates builder
   // In: Expect valueToOp to exist for every node input
+  //     opsetVersions of the model (any version matches a domain missing
+  //     from it)
   // Out: Expect valueToOp to be assigned for every node output
   onnxStatus translate(const Node& n,
                        XlaBuilder& builder,
                        ValueOpMap& valueToOp,
-                       const ValueLiteralMap& valueToLiteral);
+                       const ValueLiteralMap& valueToLiteral,
+                       const OpsetVersionMap& opsetVersions = {});
+
+  // Returns the implementations applicable to n, in decreasing priority
+  std::vector<const TranslatorEntry*> candidates(
+      const Node& n,
+      const ValueLiteralMap& valueToLiteral,
+      const OpsetVersionMap& opsetVersions = {});
+
   // Returns reference to static singleton registry
   static OperatorRegistry& registry();
 
@@ -66,14 +114,28 @@ class OperatorRegistry final {
   // Singleton instance should only be made in the class
   OperatorRegistry() = default;
   // Wrapper for registry map - should not be directly accessed
-  // Register in map through below macro
-  // Execute translation function through registry()->executeTranslation
-  static TranslationMap& map();
+  // Register in map through below macros
+  // Execute translation function through registry()->translate
+  static TranslatorMap& map();
+  // Guards map() against plugins registering while graphs are translated
+  static std::mutex& mutex();
 };
 
-// Use this macro to register Symbol("name") with translator of type
-// TranslationFunction
+// Use this macro to register translator of type TranslationFunction as the
+// general implementation of Symbol("name") in the default domain, for every
+// opset version
 #define REGISTER_OPERATOR_TRANSLATOR(name, translator)                        \
-  static OperatorRegistry::OperatorRegisterOnce register##name(Symbol(#name), \
-                                                               translator);
+  static OperatorRegistry::OperatorRegisterOnce register##name(               \
+      TranslatorEntry{"", Symbol(#name), 1, kMaxOpsetVersion, 0, "default",   \
+                      nullptr, translator});
+
+// Use this macro to register an alternative implementation (named variant) of
+// Symbol("name") from domain, valid for opset versions [since, until], used
+// over lower priority ones for nodes satisfying predicate
+#define REGISTER_OPERATOR_TRANSLATOR_VARIANT(domain, name, since, until,       \
+                                             priority, variant, predicate,     \
+                                             translator)                       \
+  static OperatorRegistry::OperatorRegisterOnce register##name##_##variant(    \
+      TranslatorEntry{domain, Symbol(#name), since, until, priority, #variant, \
+                      predicate, translator});
 }
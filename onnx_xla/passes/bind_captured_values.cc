@@ -0,0 +1,48 @@
+#include "onnx_xla/passes/graph_passes.h"
+#include "onnx_xla/control_flow_helper.h"
+
+namespace onnx_xla {
+// Binds the captured values of the subgraphs of the nodes of g. Names not
+// defined in g are captured from the graph enclosing g (nested subgraphs), or
+// are an error if g is the main graph.
+static size_t bindCapturedValues(Graph& g, bool isSubgraph) {
+  std::unordered_map<std::string, Value*> scope;
+  for (Value* v : g.inputs()) {
+    scope[v->uniqueName()] = v;
+  }
+  for (Node* n : g.nodes()) {
+    for (Value* v : n->outputs()) {
+      scope[v->uniqueName()] = v;
+    }
+  }
+
+  size_t numBound = 0;
+  for (Node* n : g.nodes()) {
+    for (const auto& attr : subgraphAttributes(*n)) {
+      auto& subgraph = *n->g(attr);
+      // Inner subgraphs first, so that their captures become ours
+      numBound += bindCapturedValues(subgraph, true);
+      for (Value* captured : capturedValues(subgraph)) {
+        auto it = scope.find(captured->uniqueName());
+        if (it == scope.end()) {
+          if (!isSubgraph) {  // TODO: ENFORCE
+            throw std::runtime_error("Subgraph captures undefined value " +
+                                     captured->uniqueName());
+          }
+          Node* capture = g.create(Symbol("Captured"), 1);
+          g.prependNode(capture);
+          capture->output()->setUniqueName(captured->uniqueName());
+          it = scope.emplace(captured->uniqueName(), capture->output()).first;
+        }
+        n->addInput(it->second);
+        ++numBound;
+      }
+    }
+  }
+  return numBound;
+}
+
+size_t bindCapturedValues(Graph& g, ValueLiteralMap& valueToLiteral) {
+  return bindCapturedValues(g, false);
+}
+}
@@ -0,0 +1,195 @@
+#include "onnx_xla/passes/graph_passes.h"
+#include "onnx_xla/control_flow_helper.h"
+
+#include <unordered_set>
+
+namespace onnx_xla {
+// How a node computes under mixed precision
+enum PrecisionMode {
+  // In the reduced type
+  kReducedPrecision,
+  // In float32, from inputs whose weights are stored in the reduced type.
+  // Used for products, which then accumulate in float32 (XLA dots accumulate
+  // in their operand type).
+  kFloatAccumulation,
+  // In float32, from float32 inputs
+  kFloatPrecision
+};
+
+// Operators whose translators only support float32, or whose output type is
+// an attribute
+static bool isFloatOnly(const Node* n) {
+  static const std::unordered_set<std::string> kinds = {
+      "QuantizeLinear", "DequantizeLinear", "QLinearConv", "QLinearMatMul",
+      "Cast"};
+  return kinds.count(n->kind().toString()) || !subgraphAttributes(*n).empty();
+}
+
+// Numerically sensitive operators, kept in float32 unless overridden
+static bool isFloatByDefault(const Node* n) {
+  static const std::unordered_set<std::string> kinds = {
+      "BatchNormalization", "InstanceNormalization", "LayerNormalization",
+      "LRN", "Softmax", "LogSoftmax", "GlobalAveragePool", "ReduceSum",
+      "ReduceMean", "ReduceSumSquare", "ReduceL1", "ReduceL2", "ReduceLogSum",
+      "ReduceLogSumExp", "ReduceProd", "RNN", "GRU", "LSTM"};
+  return kinds.count(n->kind().toString());
+}
+
+static bool isProduct(const Node* n) {
+  static const std::unordered_set<std::string> kinds = {
+      "Conv", "ConvTranspose", "Gemm", "MatMul", "Attention"};
+  return kinds.count(n->kind().toString());
+}
+
+struct PrecisionConverter {
+  Graph& g;
+  ValueLiteralMap& valueToLiteral;
+  const GraphOptions& options;
+  ONNX_NAMESPACE::TensorProto_DataType reducedType;
+  // Converted versions of values, keyed on value and type
+  std::map<std::pair<const Value*, int>, Value*> converted;
+
+  bool isFloat(const Value* v) const {
+    return !isMissingOptional(v) &&
+           (v->elemType() == ONNX_NAMESPACE::TensorProto_DataType_FLOAT ||
+            v->elemType() == reducedType);
+  }
+
+  PrecisionMode mode(const Node* n) const {
+    const auto kind = n->kind().toString();
+    if (isFloatOnly(n) || options.fp32Operators.count(kind)) {
+      return kFloatPrecision;
+    }
+    if (options.reducedPrecisionOperators.count(kind)) {
+      return kReducedPrecision;
+    }
+    if (isFloatByDefault(n)) {
+      return kFloatPrecision;
+    }
+    return isProduct(n) ? kFloatAccumulation : kReducedPrecision;
+  }
+
+  // Returns v converted to type by a Cast inserted before the node before
+  Value* cast(Value* v, ONNX_NAMESPACE::TensorProto_DataType type,
+              Node* before) {
+    auto& castValue = converted[{v, type}];
+    if (!castValue) {
+      Node* castNode = g.create(Symbol("Cast"), {v}, 1);
+      castNode->insertBefore(before);
+      castNode->i_(Symbol("to"), type);
+      castValue = castNode->output();
+      castValue->setElemType(type);
+      if (v->has_sizes()) {
+        castValue->setSizes(v->sizes());
+      }
+      castValue->setUniqueName(
+          v->uniqueName() +
+          (type == reducedType ? "_reduced" : "_float32"));
+    }
+    return castValue;
+  }
+
+  // Returns the float32 constant v stored in the reduced type
+  Value* reducedConstant(Value* v, Node* before) {
+    auto& reducedValue = converted[{v, reducedType}];
+    if (!reducedValue) {
+      auto literal = constantLiteral(v, valueToLiteral)
+                         .Convert(options.computeType)
+                         .ConsumeValueOrDie();
+      reducedValue =
+          insertConstant(g, before, std::move(literal),
+                         v->uniqueName() + "_reduced", valueToLiteral);
+    }
+    return reducedValue;
+  }
+
+  // Returns input v of n in the type n computes in
+  Value* convertInput(Value* v, PrecisionMode nodeMode, Node* n) {
+    auto type = nodeMode == kReducedPrecision
+                    ? reducedType
+                    : ONNX_NAMESPACE::TensorProto_DataType_FLOAT;
+    if (nodeMode != kFloatPrecision && isConstant(v, valueToLiteral) &&
+        v->elemType() == ONNX_NAMESPACE::TensorProto_DataType_FLOAT) {
+      v = reducedConstant(v, n);
+    }
+    return v->elemType() == type ? v : cast(v, type, n);
+  }
+
+  // Converts the float inputs of n, and the types of its float outputs if it
+  // computes in the reduced type. Nodes without float inputs (constants,
+  // generators) keep float32 outputs.
+  bool convert(Node* n) {
+    bool hasFloatInput = false;
+    for (const Value* v : n->inputs()) {
+      hasFloatInput |= isFloat(v);
+    }
+    if (!hasFloatInput) {
+      return false;
+    }
+    auto nodeMode = mode(n);
+    bool rewritten = false;
+    for (auto i = 0; i < n->inputs().size(); ++i) {
+      Value* input = n->inputs()[i];
+      if (!isFloat(input)) {
+        continue;
+      }
+      Value* convertedInput = convertInput(input, nodeMode, n);
+      if (convertedInput != input) {
+        n->replaceInput(i, convertedInput);
+        rewritten = true;
+      }
+    }
+    if (nodeMode == kReducedPrecision) {
+      for (Value* v : n->outputs()) {
+        if (v->elemType() == ONNX_NAMESPACE::TensorProto_DataType_FLOAT) {
+          v->setElemType(reducedType);
+          rewritten = true;
+        }
+      }
+    }
+    return rewritten;
+  }
+
+  // Converts graph outputs computed in the reduced type back to float32,
+  // keeping their names
+  void restoreOutputs() {
+    Node* returnNode = g.return_node();
+    for (auto i = 0; i < returnNode->inputs().size(); ++i) {
+      Value* v = returnNode->inputs()[i];
+      if (v->elemType() != reducedType) {
+        continue;
+      }
+      const std::string name = v->uniqueName();
+      Value* output =
+          cast(v, ONNX_NAMESPACE::TensorProto_DataType_FLOAT, returnNode);
+      returnNode->replaceInput(i, output);
+      v->setUniqueName(name + "_reduced");
+      output->setUniqueName(name);
+    }
+  }
+};
+
+// Nodes are visited in topological order, so the types of the inputs of a
+// node are final when it is converted. Casts are created once per value and
+// type, before its first consumer that needs them.
+size_t convertPrecision(Graph& g,
+                        ValueLiteralMap& valueToLiteral,
+                        const GraphOptions& options) {
+  if (options.computeType == xla::F32) {
+    return 0;
+  }
+  std::vector<Node*> nodes;
+  for (auto it = g.begin(); it != g.end(); ++it) {
+    nodes.push_back(*it);
+  }
+
+  PrecisionConverter converter{g, valueToLiteral, options,
+                               primitiveToOnnx(options.computeType), {}};
+  size_t numConverted = 0;
+  for (Node* n : nodes) {
+    numConverted += converter.convert(n);
+  }
+  converter.restoreOutputs();
+  return numConverted;
+}
+}
@@ -0,0 +1,148 @@
+#include "onnx_xla/passes/graph_passes.h"
+
+#include <sstream>
+#include <unordered_map>
+
+namespace onnx_xla {
+using ::ONNX_NAMESPACE::AttributeKind;
+
+// Operators that must not be merged even with identical inputs and attributes
+static bool isNondeterministic(const Node* n) {
+  const std::string kind = n->kind().toString();
+  return kind.compare(0, 6, "Random") == 0 || kind == "Multinomial" ||
+         kind == "Undefined" || kind == "Captured";
+}
+
+// Returns false if some attribute of n cannot be compared (tensors other than
+// Constant values, subgraphs)
+static bool hasComparableAttributes(const Node* n) {
+  for (const auto& name : n->attributeNames()) {
+    auto kind = n->kindOf(name);
+    if (kind == AttributeKind::g || kind == AttributeKind::gs ||
+        kind == AttributeKind::ts ||
+        (kind == AttributeKind::t && n->kind() != kConstant)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool equalAttributes(const Node* a, const Node* b) {
+  auto names = a->attributeNames();
+  if (names.size() != b->attributeNames().size()) {
+    return false;
+  }
+  for (const auto& name : names) {
+    if (!b->hasAttribute(name) || a->kindOf(name) != b->kindOf(name)) {
+      return false;
+    }
+    bool equal = true;
+    switch (a->kindOf(name)) {
+      case AttributeKind::f:
+        equal = a->f(name) == b->f(name);
+        break;
+      case AttributeKind::fs:
+        equal = a->fs(name) == b->fs(name);
+        break;
+      case AttributeKind::i:
+        equal = a->i(name) == b->i(name);
+        break;
+      case AttributeKind::is:
+        equal = a->is(name) == b->is(name);
+        break;
+      case AttributeKind::s:
+        equal = a->s(name) == b->s(name);
+        break;
+      case AttributeKind::ss:
+        equal = a->ss(name) == b->ss(name);
+        break;
+      default:
+        // Constant values are compared through their literals
+        break;
+    }
+    if (!equal) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Returns a key that is equal for any two nodes that may compute the same
+// values
+static std::string nodeKey(const Node* n,
+                           const ValueLiteralMap& valueToLiteral) {
+  std::ostringstream key;
+  key << n->domain() << "::" << n->kind().toString() << ":"
+      << n->outputs().size();
+  for (const Value* v : n->inputs()) {
+    key << ":" << v;
+  }
+  if (n->kind() == kConstant && isConstant(n->output(), valueToLiteral)) {
+    key << ":" << ShapeUtil::HumanString(
+                      constantLiteral(n->output(), valueToLiteral).shape());
+  }
+  return key.str();
+}
+
+static bool computeSameValues(const Node* a,
+                              const Node* b,
+                              const ValueLiteralMap& valueToLiteral) {
+  if (a->domain() != b->domain() || !equalAttributes(a, b)) {
+    return false;
+  }
+  if (a->kind() == kConstant) {
+    return isConstant(a->output(), valueToLiteral) &&
+           isConstant(b->output(), valueToLiteral) &&
+           constantLiteral(a->output(), valueToLiteral) ==
+               constantLiteral(b->output(), valueToLiteral);
+  }
+  return true;
+}
+
+// Returns true if some output of n is a graph output
+static bool producesGraphOutput(const Node* n) {
+  for (const Value* v : n->outputs()) {
+    if (isGraphOutput(v)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Nodes are visited in topological order and inputs are compared by identity,
+// so once duplicates are merged their consumers become duplicates in turn
+size_t eliminateCommonSubexpressions(Graph& g,
+                                     ValueLiteralMap& valueToLiteral) {
+  std::vector<Node*> nodes;
+  for (auto it = g.begin(); it != g.end(); ++it) {
+    nodes.push_back(*it);
+  }
+
+  std::unordered_map<std::string, std::vector<Node*>> seen;
+  size_t numRemoved = 0;
+  for (Node* n : nodes) {
+    if (isNondeterministic(n) || !hasComparableAttributes(n)) {
+      continue;
+    }
+    auto& candidates = seen[nodeKey(n, valueToLiteral)];
+    Node* original = nullptr;
+    for (Node* candidate : candidates) {
+      if (computeSameValues(candidate, n, valueToLiteral)) {
+        original = candidate;
+        break;
+      }
+    }
+    // Graph outputs keep their producer so that their names are preserved
+    if (!original || producesGraphOutput(n)) {
+      candidates.push_back(n);
+      continue;
+    }
+    for (auto i = 0; i < n->outputs().size(); ++i) {
+      n->outputs()[i]->replaceAllUsesWith(original->outputs()[i]);
+    }
+    destroyNode(n, valueToLiteral);
+    ++numRemoved;
+  }
+  return numRemoved;
+}
+}
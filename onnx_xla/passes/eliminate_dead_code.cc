@@ -0,0 +1,43 @@
+#include "onnx_xla/passes/graph_passes.h"
+
+namespace onnx_xla {
+// Operators whose execution is observable beyond their outputs are never
+// removed, even when nothing consumes them
+static bool hasSideEffects(const Node* n) {
+  return n->kind() == Symbol("Undefined") || n->kind() == Symbol("Captured");
+}
+
+// Nodes are visited in reverse topological order, so removing a node can make
+// its producers dead within the same sweep. Graph outputs are consumed by the
+// return node and are never removed.
+size_t eliminateDeadCode(Graph& g, ValueLiteralMap& valueToLiteral) {
+  std::vector<Node*> nodes;
+  for (auto it = g.begin(); it != g.end(); ++it) {
+    nodes.push_back(*it);
+  }
+
+  size_t numRemoved = 0;
+  for (auto it = nodes.rbegin(); it != nodes.rend(); ++it) {
+    Node* n = *it;
+    if (hasSideEffects(n)) {
+      continue;
+    }
+    bool used = false;
+    for (const Value* v : n->outputs()) {
+      used |= v->uses().size() > 0;
+    }
+    if (!used) {
+      destroyNode(n, valueToLiteral);
+      ++numRemoved;
+      continue;
+    }
+    // Unused trailing outputs (e.g. Dropout mask, BatchNormalization running
+    // statistics) are dropped so translators never see them
+    while (n->outputs().back()->uses().size() == 0) {
+      valueToLiteral.erase(n->outputs().back());
+      n->eraseOutput(n->outputs().size() - 1);
+    }
+  }
+  return numRemoved;
+}
+}
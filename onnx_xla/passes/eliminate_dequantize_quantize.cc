@@ -0,0 +1,71 @@
+#include "onnx_xla/passes/graph_passes.h"
+
+namespace onnx_xla {
+// Returns true if a and b are the same quantization parameter: the same value,
+// both omitted, or constants with equal literals
+static bool sameParameter(const Value* a,
+                          const Value* b,
+                          const ValueLiteralMap& valueToLiteral) {
+  if (a == b || (isMissingOptional(a) && isMissingOptional(b))) {
+    return true;
+  }
+  return isConstant(a, valueToLiteral) && isConstant(b, valueToLiteral) &&
+         constantLiteral(a, valueToLiteral) ==
+             constantLiteral(b, valueToLiteral);
+}
+
+static const Value* optionalInput(const Node* n, size_t i) {
+  return i < n->inputs().size() ? n->inputs()[i] : nullptr;
+}
+
+// QuantizeLinear(DequantizeLinear(x, scale, zp), scale, zp) = x whenever the
+// output type of QuantizeLinear is the type of x (the round trip is exact).
+// Such pairs are left between quantized operators by exporters that only
+// quantize some operators.
+size_t eliminateDequantizeQuantize(Graph& g, ValueLiteralMap& valueToLiteral) {
+  std::vector<Node*> nodes;
+  for (auto it = g.begin(); it != g.end(); ++it) {
+    nodes.push_back(*it);
+  }
+
+  size_t numRemoved = 0;
+  for (Node* quantize : nodes) {
+    if (quantize->kind() != Symbol("QuantizeLinear") ||
+        !isProducedBy(quantize->inputs().at(0), Symbol("DequantizeLinear")) ||
+        isGraphOutput(quantize->output())) {
+      continue;
+    }
+    Node* dequantize = quantize->inputs().at(0)->node();
+    Value* x = dequantize->inputs().at(0);
+    auto axis = [&](const Node* n) {
+      return n->hasAttribute(kaxis) ? n->i(kaxis) : 1;
+    };
+    const Value* quantizeZeroPoint = optionalInput(quantize, 2);
+    const Value* dequantizeZeroPoint = optionalInput(dequantize, 2);
+    bool quantizeHasZeroPoint =
+        quantizeZeroPoint && !isMissingOptional(quantizeZeroPoint);
+    bool dequantizeHasZeroPoint =
+        dequantizeZeroPoint && !isMissingOptional(dequantizeZeroPoint);
+    // Without a zero point QuantizeLinear outputs uint8
+    auto outputType = quantizeHasZeroPoint
+                          ? quantizeZeroPoint->elemType()
+                          : ONNX_NAMESPACE::TensorProto_DataType_UINT8;
+    if (x->elemType() != outputType || axis(quantize) != axis(dequantize) ||
+        quantizeHasZeroPoint != dequantizeHasZeroPoint ||
+        !sameParameter(quantize->inputs().at(1), dequantize->inputs().at(1),
+                       valueToLiteral) ||
+        (quantizeHasZeroPoint &&
+         !sameParameter(quantizeZeroPoint, dequantizeZeroPoint,
+                        valueToLiteral))) {
+      continue;
+    }
+    quantize->output()->replaceAllUsesWith(x);
+    destroyNode(quantize, valueToLiteral);
+    if (dequantize->output()->uses().empty()) {
+      destroyNode(dequantize, valueToLiteral);
+    }
+    ++numRemoved;
+  }
+  return numRemoved;
+}
+}
@@ -0,0 +1,145 @@
+#include "onnx_xla/passes/graph_passes.h"
+
+namespace onnx_xla {
+// Conv(X, W, B) -> BatchNormalization(scale, bias, mean, var) computes, per
+// output channel c,
+//   factor[c] = scale[c] / sqrt(var[c] + epsilon)
+//   W'[c]     = W[c] * factor[c]
+//   B'[c]     = (B[c] - mean[c]) * factor[c] + bias[c]
+// so the pair is replaced by Conv(X, W', B') when every parameter is constant
+template <typename T>
+static void foldIntoConvParameters(Literal& weights,
+                                   Literal& bias,
+                                   const Literal& scale,
+                                   const Literal& bnBias,
+                                   const Literal& mean,
+                                   const Literal& var,
+                                   float epsilon) {
+  auto weightsData = weights.data<T>();
+  auto biasData = bias.data<T>();
+  auto scaleData = scale.data<T>();
+  auto bnBiasData = bnBias.data<T>();
+  auto meanData = mean.data<T>();
+  auto varData = var.data<T>();
+  auto outputChannels = scaleData.size();
+  auto elementsPerChannel = weightsData.size() / outputChannels;
+  for (auto c = 0; c < outputChannels; ++c) {
+    T factor = scaleData[c] / std::sqrt(varData[c] + (T)epsilon);
+    for (auto j = 0; j < elementsPerChannel; ++j) {
+      weightsData[c * elementsPerChannel + j] *= factor;
+    }
+    biasData[c] = (biasData[c] - meanData[c]) * factor + bnBiasData[c];
+  }
+}
+
+size_t foldBatchNormalization(Graph& g, ValueLiteralMap& valueToLiteral) {
+  std::vector<Node*> batchNorms;
+  for (auto it = g.begin(); it != g.end(); ++it) {
+    if ((*it)->kind() == Symbol("BatchNormalization")) {
+      batchNorms.push_back(*it);
+    }
+  }
+
+  size_t numFolded = 0;
+  for (Node* bn : batchNorms) {
+    // Only test mode BatchNormalization (just the first output is used) with
+    // per-channel statistics can be folded
+    bool trainingOutputUsed = false;
+    for (auto i = 1; i < bn->outputs().size(); ++i) {
+      trainingOutputUsed |= bn->outputs()[i]->uses().size() > 0;
+    }
+    auto kspatial = Symbol("spatial");
+    if (trainingOutputUsed ||
+        (bn->hasAttribute(kspatial) && bn->i(kspatial) != 1) ||
+        bn->inputs().size() != 5) {
+      continue;
+    }
+
+    // Input must come from a Conv used only by this node
+    Value* convOutput = bn->inputs()[0];
+    if (!isProducedBy(convOutput, kConv) || convOutput->uses().size() != 1) {
+      continue;
+    }
+    Node* conv = convOutput->node();
+    bool hasBias = conv->inputs().size() == 3 &&
+                   !isMissingOptional(conv->inputs()[2]);
+
+    // Every parameter must be known at build time
+    bool allConstant = isConstant(conv->inputs()[1], valueToLiteral) &&
+                       (!hasBias || isConstant(conv->inputs()[2],
+                                               valueToLiteral));
+    for (auto i = 1; i < 5; ++i) {
+      allConstant &= isConstant(bn->inputs()[i], valueToLiteral);
+    }
+    if (!allConstant) {
+      continue;
+    }
+
+    const Literal& weights = constantLiteral(conv->inputs()[1], valueToLiteral);
+    auto dataType = weights.shape().element_type();
+    if (dataType != xla::F32 && dataType != xla::F64) {
+      continue;
+    }
+    auto outputChannels = ShapeUtil::GetDimension(weights.shape(), 0);
+    bool compatible = true;
+    for (auto i = 1; i < 5; ++i) {
+      const Shape& shape =
+          constantLiteral(bn->inputs()[i], valueToLiteral).shape();
+      compatible &= shape.element_type() == dataType &&
+                    ShapeUtil::ElementsIn(shape) == outputChannels;
+    }
+    if (hasBias) {
+      const Shape& shape =
+          constantLiteral(conv->inputs()[2], valueToLiteral).shape();
+      compatible &= shape.element_type() == dataType &&
+                    ShapeUtil::ElementsIn(shape) == outputChannels;
+    }
+    if (!compatible) {
+      continue;
+    }
+
+    // Fold into copies, as the original weights may be shared
+    auto foldedWeights = weights.CloneToUnique();
+    auto foldedBias =
+        hasBias
+            ? constantLiteral(conv->inputs()[2], valueToLiteral).CloneToUnique()
+            : Literal::CreateFromShape(
+                  ShapeUtil::MakeShape(dataType, {outputChannels}));
+    // TODO: Fetch default from ONNX Schema
+    float epsilon = 1e-5;
+    if (bn->hasAttribute(kepsilon)) {
+      epsilon = bn->f(kepsilon);
+    }
+#define FOLD(type)                                                          \
+  foldIntoConvParameters<type>(                                             \
+      *foldedWeights, *foldedBias,                                          \
+      constantLiteral(bn->inputs()[1], valueToLiteral),                     \
+      constantLiteral(bn->inputs()[2], valueToLiteral),                     \
+      constantLiteral(bn->inputs()[3], valueToLiteral),                     \
+      constantLiteral(bn->inputs()[4], valueToLiteral), epsilon);
+    if (dataType == xla::F32) {
+      FOLD(float)
+    } else {
+      FOLD(double)
+    }
+#undef FOLD
+
+    // Rewire Conv to the folded parameters and drop BatchNormalization
+    std::string name = convOutput->uniqueName();
+    Value* weightsValue = insertConstant(
+        g, conv, std::move(foldedWeights), name + "_folded_W", valueToLiteral);
+    Value* biasValue = insertConstant(g, conv, std::move(foldedBias),
+                                      name + "_folded_B", valueToLiteral);
+    conv->replaceInput(1, weightsValue);
+    if (conv->inputs().size() == 3) {
+      conv->replaceInput(2, biasValue);
+    } else {
+      conv->addInput(biasValue);
+    }
+    replaceValue(bn->outputs()[0], convOutput);
+    destroyNode(bn, valueToLiteral);
+    ++numFolded;
+  }
+  return numFolded;
+}
+}
@@ -0,0 +1,686 @@
+#include "onnx_xla/passes/graph_passes.h"
+#include "onnx_xla/utils.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+namespace onnx_xla {
+// Evaluates a node on the host from the literals of its inputs
+// Returns nullptr if the node cannot be folded (unsupported type or
+// attribute combination), in which case it is left for translation
+using ConstantEvaluator = std::function<std::unique_ptr<Literal>(
+    const Node&,
+    const std::vector<const Literal*>&)>;
+
+// Folded results of broadcasting operators larger than this (and larger than
+// every input) are left to runtime to keep the computation small
+static const int64 kMaxBroadcastFoldElements = 1 << 16;
+
+#define DISPATCH_FOLDABLE_TYPE(primitive_type, function, ...) \
+  switch (primitive_type) {                                   \
+    case xla::F32: {                                          \
+      return function<float>(__VA_ARGS__);                    \
+    }                                                         \
+    case xla::F64: {                                          \
+      return function<double>(__VA_ARGS__);                   \
+    }                                                         \
+    case xla::S32: {                                          \
+      return function<int32>(__VA_ARGS__);                    \
+    }                                                         \
+    case xla::S64: {                                          \
+      return function<int64>(__VA_ARGS__);                    \
+    }                                                         \
+    default: { return nullptr; }                              \
+  }
+
+/************************************************************************/
+/********************     SHAPE HELPERS     *****************************/
+
+static std::vector<int64> dimensionsOf(const Literal& l) {
+  const auto& dims = l.shape().dimensions();
+  return std::vector<int64>(dims.begin(), dims.end());
+}
+
+static std::vector<int64> stridesOf(const std::vector<int64>& dims) {
+  std::vector<int64> strides(dims.size(), 1);
+  for (int64 i = (int64)dims.size() - 2; i >= 0; --i) {
+    strides[i] = strides[i + 1] * dims[i + 1];
+  }
+  return strides;
+}
+
+static int64 numElementsOf(const std::vector<int64>& dims) {
+  return std::accumulate(dims.begin(), dims.end(), (int64)1,
+                         std::multiplies<int64>());
+}
+
+// Reads an integer literal (INT32 or INT64) as int64 values
+// Returns false if l is of another type
+static bool toInt64Vector(const Literal& l, std::vector<int64>& values) {
+  if (l.shape().element_type() == xla::S64) {
+    auto data = l.data<int64>();
+    values.assign(data.begin(), data.end());
+  } else if (l.shape().element_type() == xla::S32) {
+    auto data = l.data<int32>();
+    values.assign(data.begin(), data.end());
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Maps a possibly negative axis into [0, rank)
+static int64 normalizeAxis(int64 axis, int64 rank) {
+  return axis < 0 ? axis + rank : axis;
+}
+
+// Reshapes l to dims (data order unchanged)
+static std::unique_ptr<Literal> reshapeLiteral(const Literal& l,
+                                               const std::vector<int64>& dims) {
+  if (numElementsOf(dims) != ShapeUtil::ElementsIn(l.shape())) {
+    return nullptr;
+  }
+  return l.Reshape(dims).ConsumeValueOrDie();
+}
+
+/************************************************************************/
+/********************     TYPED EVALUATORS     **************************/
+
+template <typename T>
+static std::unique_ptr<Literal> concatImpl(
+    const std::vector<const Literal*>& inputs,
+    int64 axis) {
+  auto outDims = dimensionsOf(*inputs.at(0));
+  outDims.at(axis) = 0;
+  for (const Literal* l : inputs) {
+    outDims[axis] += ShapeUtil::GetDimension(l->shape(), axis);
+  }
+  auto outer = numElementsOf(
+      std::vector<int64>(outDims.begin(), outDims.begin() + axis));
+  auto out = Literal::CreateFromShape(
+      ShapeUtil::MakeShape(inputs.at(0)->shape().element_type(), outDims));
+  auto outData = out->data<T>();
+  int64 outOffset = 0;
+  for (int64 o = 0; o < outer; ++o) {
+    for (const Literal* l : inputs) {
+      auto inData = l->data<T>();
+      auto block = inData.size() / outer;
+      std::copy(inData.begin() + o * block, inData.begin() + (o + 1) * block,
+                outData.begin() + outOffset);
+      outOffset += block;
+    }
+  }
+  return out;
+}
+
+template <typename T>
+static std::unique_ptr<Literal> gatherImpl(const Literal& data,
+                                           const Literal& indices,
+                                           int64 axis) {
+  auto dataDims = dimensionsOf(data);
+  auto indexDims = dimensionsOf(indices);
+  std::vector<int64> indexValues;
+  if (!toInt64Vector(indices, indexValues)) {
+    return nullptr;
+  }
+  std::vector<int64> outDims(dataDims.begin(), dataDims.begin() + axis);
+  outDims.insert(outDims.end(), indexDims.begin(), indexDims.end());
+  outDims.insert(outDims.end(), dataDims.begin() + axis + 1, dataDims.end());
+  auto outer = numElementsOf(
+      std::vector<int64>(dataDims.begin(), dataDims.begin() + axis));
+  auto inner = numElementsOf(
+      std::vector<int64>(dataDims.begin() + axis + 1, dataDims.end()));
+  auto out = Literal::CreateFromShape(
+      ShapeUtil::MakeShape(data.shape().element_type(), outDims));
+  auto inData = data.data<T>();
+  auto outData = out->data<T>();
+  int64 outOffset = 0;
+  for (int64 o = 0; o < outer; ++o) {
+    for (auto index : indexValues) {
+      index = normalizeAxis(index, dataDims[axis]);
+      if (index < 0 || index >= dataDims[axis]) {
+        return nullptr;
+      }
+      auto start = (o * dataDims[axis] + index) * inner;
+      std::copy(inData.begin() + start, inData.begin() + start + inner,
+                outData.begin() + outOffset);
+      outOffset += inner;
+    }
+  }
+  return out;
+}
+
+template <typename T>
+static std::unique_ptr<Literal> sliceImpl(const Literal& l,
+                                          const std::vector<int64>& starts,
+                                          const std::vector<int64>& ends,
+                                          const std::vector<int64>& axes,
+                                          const std::vector<int64>& steps) {
+  auto inDims = dimensionsOf(l);
+  auto inStrides = stridesOf(inDims);
+  std::vector<int64> begin(inDims.size(), 0);
+  std::vector<int64> step(inDims.size(), 1);
+  std::vector<int64> outDims(inDims);
+  for (auto i = 0; i < axes.size(); ++i) {
+    auto axis = normalizeAxis(axes[i], inDims.size());
+    auto dim = inDims.at(axis);
+    auto s = steps.empty() ? 1 : steps.at(i);
+    if (s == 0) {
+      return nullptr;
+    }
+    auto clampIndex = [&](int64 index) {
+      index = index < 0 ? index + dim : index;
+      return s > 0 ? std::min(std::max(index, (int64)0), dim)
+                   : std::min(std::max(index, (int64)-1), dim - 1);
+    };
+    auto first = clampIndex(starts.at(i));
+    auto last = clampIndex(ends.at(i));
+    begin[axis] = first;
+    step[axis] = s;
+    outDims[axis] = s > 0 ? std::max((last - first + s - 1) / s, (int64)0)
+                          : std::max((first - last - s - 1) / -s, (int64)0);
+  }
+  auto out = Literal::CreateFromShape(
+      ShapeUtil::MakeShape(l.shape().element_type(), outDims));
+  auto inData = l.data<T>();
+  auto outData = out->data<T>();
+  std::vector<int64> index(outDims.size(), 0);
+  for (int64 i = 0; i < (int64)outData.size(); ++i) {
+    int64 offset = 0;
+    for (auto d = 0; d < index.size(); ++d) {
+      offset += (begin[d] + index[d] * step[d]) * inStrides[d];
+    }
+    outData[i] = inData[offset];
+    for (int64 d = (int64)index.size() - 1; d >= 0; --d) {
+      if (++index[d] < outDims[d]) {
+        break;
+      }
+      index[d] = 0;
+    }
+  }
+  return out;
+}
+
+// Applies a binary function with multidirectional (numpy) broadcasting
+template <typename T>
+static std::unique_ptr<Literal> broadcastBinaryImpl(
+    const Literal& a,
+    const Literal& b,
+    const std::function<T(T, T)>& f) {
+  auto aDims = dimensionsOf(a);
+  auto bDims = dimensionsOf(b);
+  auto rank = std::max(aDims.size(), bDims.size());
+  aDims.insert(aDims.begin(), rank - aDims.size(), 1);
+  bDims.insert(bDims.begin(), rank - bDims.size(), 1);
+  std::vector<int64> outDims;
+  for (auto d = 0; d < rank; ++d) {
+    if (aDims[d] != bDims[d] && aDims[d] != 1 && bDims[d] != 1) {
+      return nullptr;
+    }
+    outDims.push_back(std::max(aDims[d], bDims[d]));
+  }
+  auto numOutElements = numElementsOf(outDims);
+  if (numOutElements > kMaxBroadcastFoldElements &&
+      numOutElements > std::max(numElementsOf(aDims), numElementsOf(bDims))) {
+    return nullptr;
+  }
+  auto aStrides = stridesOf(aDims);
+  auto bStrides = stridesOf(bDims);
+  for (auto d = 0; d < rank; ++d) {
+    aStrides[d] = aDims[d] == 1 ? 0 : aStrides[d];
+    bStrides[d] = bDims[d] == 1 ? 0 : bStrides[d];
+  }
+  auto out = Literal::CreateFromShape(
+      ShapeUtil::MakeShape(a.shape().element_type(), outDims));
+  auto aData = a.data<T>();
+  auto bData = b.data<T>();
+  auto outData = out->data<T>();
+  std::vector<int64> index(rank, 0);
+  for (int64 i = 0; i < numOutElements; ++i) {
+    int64 aOffset = 0, bOffset = 0;
+    for (auto d = 0; d < rank; ++d) {
+      aOffset += index[d] * aStrides[d];
+      bOffset += index[d] * bStrides[d];
+    }
+    outData[i] = f(aData[aOffset], bData[bOffset]);
+    for (int64 d = (int64)rank - 1; d >= 0; --d) {
+      if (++index[d] < outDims[d]) {
+        break;
+      }
+      index[d] = 0;
+    }
+  }
+  return out;
+}
+
+template <typename T>
+static std::unique_ptr<Literal> arithmeticImpl(const Node& n,
+                                               const Literal& a,
+                                               const Literal& b) {
+  std::function<T(T, T)> f;
+  if (n.kind() == kAdd) {
+    f = [](T x, T y) { return x + y; };
+  } else if (n.kind() == Symbol("Sub")) {
+    f = [](T x, T y) { return x - y; };
+  } else if (n.kind() == kMul) {
+    f = [](T x, T y) { return x * y; };
+  } else {
+    for (auto y : b.data<T>()) {
+      if (y == T(0) && std::is_integral<T>::value) {
+        return nullptr;
+      }
+    }
+    f = [](T x, T y) { return x / y; };
+  }
+  return broadcastBinaryImpl<T>(a, b, f);
+}
+
+template <typename T>
+static std::unique_ptr<Literal> fillImpl(const Literal& value,
+                                         const std::vector<int64>& dims) {
+  auto out = Literal::CreateFromShape(
+      ShapeUtil::MakeShape(value.shape().element_type(), dims));
+  auto fillValue = value.data<T>().at(0);
+  for (auto& element : out->data<T>()) {
+    element = fillValue;
+  }
+  return out;
+}
+
+/************************************************************************/
+/********************     NODE EVALUATORS     ***************************/
+
+static std::unique_ptr<Literal> evaluateConstant(
+    const Node& n,
+    const std::vector<const Literal*>& inputs) {
+  if (!n.hasAttribute(kvalue)) {
+    return nullptr;
+  }
+  return tensorToLiteral(n.t(kvalue));
+}
+
+static std::unique_ptr<Literal> evaluateShape(
+    const Node& n,
+    const std::vector<const Literal*>& inputs) {
+  auto sizes = parseOnnxInputSizes(n, 0);
+  return Literal::CreateR1<int64>(
+      std::vector<int64>(sizes.begin(), sizes.end()));
+}
+
+static std::unique_ptr<Literal> evaluateIdentity(
+    const Node& n,
+    const std::vector<const Literal*>& inputs) {
+  return inputs.at(0)->CloneToUnique();
+}
+
+static std::unique_ptr<Literal> evaluateCast(
+    const Node& n,
+    const std::vector<const Literal*>& inputs) {
+  auto to = onnxToPrimitive(
+      static_cast<ONNX_NAMESPACE::TensorProto_DataType>(n.i(Symbol("to"))));
+  auto converted = inputs.at(0)->Convert(to);
+  return converted.ok() ? converted.ConsumeValueOrDie() : nullptr;
+}
+
+// Sets dims to the dimensions a Reshape of originalDims to target gives,
+// resolving the 0 (copied) and -1 (inferred) entries of target
+// Returns false if target is invalid for originalDims
+static bool reshapeDims(const std::vector<int64>& originalDims,
+                        const std::vector<int64>& target,
+                        std::vector<int64>& dims) {
+  dims = target;
+  int64 product = 1;
+  int64 negativeOneIndex = -1;
+  for (auto i = 0; i < dims.size(); ++i) {
+    if (dims[i] == 0) {
+      if (i >= originalDims.size()) {
+        return false;
+      }
+      dims[i] = originalDims[i];
+    } else if (dims[i] == -1 && negativeOneIndex < 0) {
+      negativeOneIndex = i;
+      continue;
+    } else if (dims[i] < 0) {
+      return false;
+    }
+    product *= dims[i];
+  }
+  if (negativeOneIndex >= 0) {
+    if (product == 0) {
+      return false;
+    }
+    dims[negativeOneIndex] = numElementsOf(originalDims) / product;
+  }
+  return numElementsOf(dims) == numElementsOf(originalDims);
+}
+
+static std::unique_ptr<Literal> evaluateReshape(
+    const Node& n,
+    const std::vector<const Literal*>& inputs) {
+  std::vector<int64> target, dims;
+  if (!toInt64Vector(*inputs.at(1), target) ||
+      !reshapeDims(dimensionsOf(*inputs.at(0)), target, dims)) {
+    return nullptr;
+  }
+  return reshapeLiteral(*inputs.at(0), dims);
+}
+
+// Reads the axes of Squeeze or Unsqueeze, an attribute before opset 13 and
+// an input since (empty if absent). Returns false if they are not integers.
+static bool readAxes(const Node& n,
+                     const std::vector<const Literal*>& inputs,
+                     std::vector<int64>& axes) {
+  if (n.hasAttribute(kaxes)) {
+    axes.assign(n.is(kaxes).begin(), n.is(kaxes).end());
+    return true;
+  }
+  return inputs.size() < 2 || !inputs[1] || toInt64Vector(*inputs[1], axes);
+}
+
+// Maps axes into [0, rank) and sorts them
+// Returns false if an axis is out of range or repeated
+static bool normalizeAxes(std::vector<int64>& axes, int64 rank) {
+  for (auto& axis : axes) {
+    axis = normalizeAxis(axis, rank);
+    if (axis < 0 || axis >= rank) {
+      return false;
+    }
+  }
+  std::sort(axes.begin(), axes.end());
+  return std::adjacent_find(axes.begin(), axes.end()) == axes.end();
+}
+
+static std::unique_ptr<Literal> evaluateUnsqueeze(
+    const Node& n,
+    const std::vector<const Literal*>& inputs) {
+  auto dims = dimensionsOf(*inputs.at(0));
+  std::vector<int64> axes;
+  if (!readAxes(n, inputs, axes) || axes.empty() ||
+      !normalizeAxes(axes, dims.size() + axes.size())) {
+    return nullptr;
+  }
+  for (auto axis : axes) {
+    dims.insert(dims.begin() + axis, 1);
+  }
+  return reshapeLiteral(*inputs.at(0), dims);
+}
+
+static std::unique_ptr<Literal> evaluateSqueeze(
+    const Node& n,
+    const std::vector<const Literal*>& inputs) {
+  auto dims = dimensionsOf(*inputs.at(0));
+  std::vector<int64> axes;
+  if (!readAxes(n, inputs, axes) || !normalizeAxes(axes, dims.size())) {
+    return nullptr;
+  }
+  std::vector<int64> squeezedDims;
+  for (int64 i = 0; i < dims.size(); ++i) {
+    bool squeeze = dims[i] == 1;
+    if (!axes.empty()) {
+      squeeze = std::binary_search(axes.begin(), axes.end(), i);
+      if (squeeze && dims[i] != 1) {
+        return nullptr;
+      }
+    }
+    if (!squeeze) {
+      squeezedDims.push_back(dims[i]);
+    }
+  }
+  return reshapeLiteral(*inputs.at(0), squeezedDims);
+}
+
+static std::unique_ptr<Literal> evaluateFlatten(
+    const Node& n,
+    const std::vector<const Literal*>& inputs) {
+  auto dims = dimensionsOf(*inputs.at(0));
+  auto axis = n.hasAttribute(kaxis) ? normalizeAxis(n.i(kaxis), dims.size())
+                                    : 1;
+  if (axis < 0 || axis > dims.size()) {
+    return nullptr;
+  }
+  std::vector<int64> outer(dims.begin(), dims.begin() + axis);
+  std::vector<int64> inner(dims.begin() + axis, dims.end());
+  return reshapeLiteral(*inputs.at(0),
+                        {numElementsOf(outer), numElementsOf(inner)});
+}
+
+static std::unique_ptr<Literal> evaluateTranspose(
+    const Node& n,
+    const std::vector<const Literal*>& inputs) {
+  std::vector<int64> perm;
+  if (n.hasAttribute(kperm)) {
+    perm.assign(n.is(kperm).begin(), n.is(kperm).end());
+  } else {
+    for (int64 i = ShapeUtil::Rank(inputs.at(0)->shape()) - 1; i >= 0; --i) {
+      perm.push_back(i);
+    }
+  }
+  auto sortedPerm = perm;
+  if (!normalizeAxes(sortedPerm, ShapeUtil::Rank(inputs.at(0)->shape())) ||
+      sortedPerm.size() != ShapeUtil::Rank(inputs.at(0)->shape())) {
+    return nullptr;
+  }
+  return transposeLiteral(*inputs.at(0), perm);
+}
+
+static std::unique_ptr<Literal> evaluateConcat(
+    const Node& n,
+    const std::vector<const Literal*>& inputs) {
+  if (!n.hasAttribute(kaxis)) {
+    return nullptr;
+  }
+  const auto& shape = inputs.at(0)->shape();
+  auto axis = normalizeAxis(n.i(kaxis), ShapeUtil::Rank(shape));
+  if (axis < 0 || axis >= ShapeUtil::Rank(shape)) {
+    return nullptr;
+  }
+  for (const Literal* l : inputs) {
+    if (l->shape().element_type() != shape.element_type() ||
+        ShapeUtil::Rank(l->shape()) != ShapeUtil::Rank(shape)) {
+      return nullptr;
+    }
+    for (int64 d = 0; d < ShapeUtil::Rank(shape); ++d) {
+      if (d != axis && ShapeUtil::GetDimension(l->shape(), d) !=
+                           ShapeUtil::GetDimension(shape, d)) {
+        return nullptr;
+      }
+    }
+  }
+  auto type = shape.element_type();
+  DISPATCH_FOLDABLE_TYPE(type, concatImpl, inputs, axis)
+}
+
+static std::unique_ptr<Literal> evaluateGather(
+    const Node& n,
+    const std::vector<const Literal*>& inputs) {
+  auto axis = n.hasAttribute(kaxis)
+                  ? normalizeAxis(n.i(kaxis),
+                                  ShapeUtil::Rank(inputs.at(0)->shape()))
+                  : 0;
+  if (axis < 0 || axis >= ShapeUtil::Rank(inputs.at(0)->shape())) {
+    return nullptr;
+  }
+  DISPATCH_FOLDABLE_TYPE(inputs.at(0)->shape().element_type(), gatherImpl,
+                         *inputs.at(0), *inputs.at(1), axis)
+}
+
+static std::unique_ptr<Literal> evaluateSlice(
+    const Node& n,
+    const std::vector<const Literal*>& inputs) {
+  std::vector<int64> starts, ends, axes, steps;
+  if (inputs.size() > 1) {
+    // Opset 10 and later take slice parameters as inputs
+    if (!toInt64Vector(*inputs.at(1), starts) ||
+        !toInt64Vector(*inputs.at(2), ends) ||
+        (inputs.size() > 3 && inputs[3] &&
+         !toInt64Vector(*inputs[3], axes)) ||
+        (inputs.size() > 4 && inputs[4] &&
+         !toInt64Vector(*inputs[4], steps))) {
+      return nullptr;
+    }
+  } else {
+    starts.assign(n.is(Symbol("starts")).begin(), n.is(Symbol("starts")).end());
+    ends.assign(n.is(Symbol("ends")).begin(), n.is(Symbol("ends")).end());
+    if (n.hasAttribute(kaxes)) {
+      axes.assign(n.is(kaxes).begin(), n.is(kaxes).end());
+    }
+  }
+  if (axes.empty()) {
+    for (auto i = 0; i < starts.size(); ++i) {
+      axes.push_back(i);
+    }
+  }
+  auto rank = ShapeUtil::Rank(inputs.at(0)->shape());
+  if (ends.size() != starts.size() || axes.size() != starts.size() ||
+      (!steps.empty() && steps.size() != starts.size())) {
+    return nullptr;
+  }
+  for (auto axis : axes) {
+    axis = normalizeAxis(axis, rank);
+    if (axis < 0 || axis >= rank) {
+      return nullptr;
+    }
+  }
+  DISPATCH_FOLDABLE_TYPE(inputs.at(0)->shape().element_type(), sliceImpl,
+                         *inputs.at(0), starts, ends, axes, steps)
+}
+
+static std::unique_ptr<Literal> evaluateArithmetic(
+    const Node& n,
+    const std::vector<const Literal*>& inputs) {
+  if (inputs.at(0)->shape().element_type() !=
+      inputs.at(1)->shape().element_type()) {
+    return nullptr;
+  }
+  DISPATCH_FOLDABLE_TYPE(inputs.at(0)->shape().element_type(), arithmeticImpl,
+                         n, *inputs.at(0), *inputs.at(1))
+}
+
+static std::unique_ptr<Literal> evaluateConstantOfShape(
+    const Node& n,
+    const std::vector<const Literal*>& inputs) {
+  std::vector<int64> dims;
+  if (!toInt64Vector(*inputs.at(0), dims)) {
+    return nullptr;
+  }
+  for (auto dim : dims) {
+    if (dim < 0) {
+      return nullptr;
+    }
+  }
+  auto value = n.hasAttribute(kvalue)
+                   ? tensorToLiteral(n.t(kvalue))
+                   : Literal::CreateR1<float>({0.0f});
+  DISPATCH_FOLDABLE_TYPE(value->shape().element_type(), fillImpl, *value,
+                         dims)
+}
+
+#undef DISPATCH_FOLDABLE_TYPE
+
+static const std::unordered_map<Symbol, ConstantEvaluator>& evaluators() {
+  static const std::unordered_map<Symbol, ConstantEvaluator> evaluators = {
+      {kConstant, evaluateConstant},
+      {Symbol("Shape"), evaluateShape},
+      {Symbol("Identity"), evaluateIdentity},
+      {Symbol("Cast"), evaluateCast},
+      {kReshape, evaluateReshape},
+      {kUnsqueeze, evaluateUnsqueeze},
+      {Symbol("Squeeze"), evaluateSqueeze},
+      {Symbol("Flatten"), evaluateFlatten},
+      {kTranspose, evaluateTranspose},
+      {kConcat, evaluateConcat},
+      {Symbol("Gather"), evaluateGather},
+      {Symbol("Slice"), evaluateSlice},
+      {kAdd, evaluateArithmetic},
+      {Symbol("Sub"), evaluateArithmetic},
+      {kMul, evaluateArithmetic},
+      {Symbol("Div"), evaluateArithmetic},
+      {Symbol("ConstantOfShape"), evaluateConstantOfShape}};
+  return evaluators;
+}
+
+// Returns true if every dimension of v is statically known
+static bool hasStaticSizes(const Value* v) {
+  if (!v->has_sizes()) {
+    return false;
+  }
+  for (const auto& d : v->sizes()) {
+    if (!d.is_int) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Nodes are visited in topological order, so chains (such as
+// Shape->Gather->Unsqueeze->Concat) fold completely in one sweep
+size_t foldConstants(Graph& g, ValueLiteralMap& valueToLiteral) {
+  std::vector<Node*> nodes;
+  for (auto it = g.begin(); it != g.end(); ++it) {
+    nodes.push_back(*it);
+  }
+
+  size_t numFolded = 0;
+  for (Node* n : nodes) {
+    auto evaluatorIt = evaluators().find(n->kind());
+    if (evaluatorIt == evaluators().end() || n->outputs().size() != 1) {
+      continue;
+    }
+
+    // Shape only needs the static sizes of its input, every other node needs
+    // the value of each input that is present
+    std::vector<const Literal*> inputs;
+    bool foldable = true;
+    if (n->kind() == Symbol("Shape")) {
+      foldable = hasStaticSizes(n->inputs().at(0));
+    } else {
+      for (const Value* v : n->inputs()) {
+        if (isMissingOptional(v)) {
+          inputs.push_back(nullptr);
+        } else if (isConstant(v, valueToLiteral)) {
+          inputs.push_back(&constantLiteral(v, valueToLiteral));
+        } else {
+          foldable = false;
+        }
+      }
+    }
+    // Constants produced by earlier passes are already folded
+    if (!foldable || isConstant(n->output(), valueToLiteral)) {
+      continue;
+    }
+
+    auto literal = evaluatorIt->second(*n, inputs);
+    if (!literal) {
+      continue;
+    }
+    Value* folded = insertConstant(g, n, std::move(literal),
+                                   n->output()->uniqueName(), valueToLiteral);
+    replaceValue(n->output(), folded);
+    destroyNode(n, valueToLiteral);
+    ++numFolded;
+  }
+
+  // Reshape targets that were only known after folding give the Reshape
+  // output static sizes that shape inference could not compute
+  for (auto it = g.begin(); it != g.end(); ++it) {
+    Node* n = *it;
+    if (n->kind() != kReshape || hasStaticSizes(n->output()) ||
+        !hasStaticSizes(n->inputs().at(0)) ||
+        !isConstant(n->inputs().at(1), valueToLiteral)) {
+      continue;
+    }
+    std::vector<int64> originalDims;
+    for (const auto& d : n->inputs().at(0)->sizes()) {
+      originalDims.push_back(d.dim);
+    }
+    std::vector<int64> target, dims;
+    if (!toInt64Vector(constantLiteral(n->inputs().at(1), valueToLiteral),
+                       target) ||
+        !reshapeDims(originalDims, target, dims)) {
+      continue;
+    }
+    n->output()->setSizes(std::vector<Dimension>(dims.begin(), dims.end()));
+  }
+  return numFolded;
+}
+}
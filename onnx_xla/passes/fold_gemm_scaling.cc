@@ -0,0 +1,60 @@
+#include "onnx_xla/passes/graph_passes.h"
+
+namespace onnx_xla {
+// Returns a copy of literal with every element multiplied by factor
+template <typename T>
+static std::unique_ptr<Literal> scaleLiteral(const Literal& literal,
+                                             float factor) {
+  auto scaled = literal.CloneToUnique();
+  for (auto& element : scaled->data<T>()) {
+    element *= (T)factor;
+  }
+  return scaled;
+}
+
+// Gemm computes alpha * A * B + beta * C. When B (resp. C) is constant, alpha
+// (resp. beta) is applied to a copy of it at build time and the attribute is
+// dropped, removing the runtime multiplication
+size_t foldGemmScaling(Graph& g, ValueLiteralMap& valueToLiteral) {
+  size_t numRewritten = 0;
+  for (auto it = g.begin(); it != g.end(); ++it) {
+    Node* gemm = *it;
+    if (gemm->kind() != kGemm || gemm->inputs().size() != 3) {
+      continue;
+    }
+    bool rewritten = false;
+    auto fold = [&](const Symbol& attr, size_t inputIndex,
+                    const std::string& suffix) {
+      Value* input = gemm->inputs()[inputIndex];
+      if (!gemm->hasAttribute(attr) || !isConstant(input, valueToLiteral)) {
+        return;
+      }
+      const Literal& literal = constantLiteral(input, valueToLiteral);
+      std::unique_ptr<Literal> scaled;
+      switch (literal.shape().element_type()) {
+        case xla::F32: {
+          scaled = scaleLiteral<float>(literal, gemm->f(attr));
+          break;
+        }
+        case xla::F64: {
+          scaled = scaleLiteral<double>(literal, gemm->f(attr));
+          break;
+        }
+        default: { return; }
+      }
+      Value* scaledValue =
+          insertConstant(g, gemm, std::move(scaled),
+                         gemm->output()->uniqueName() + suffix, valueToLiteral);
+      gemm->replaceInput(inputIndex, scaledValue);
+      gemm->removeAttribute(attr);
+      rewritten = true;
+    };
+    fold(kalpha, 1, "_alpha_B");
+    fold(kbeta, 2, "_beta_C");
+    if (rewritten) {
+      ++numRewritten;
+    }
+  }
+  return numRewritten;
+}
+}
@@ -0,0 +1,46 @@
+#include "onnx_xla/passes/graph_passes.h"
+
+namespace onnx_xla {
+// When A (resp. B) is a constant matrix and transA (resp. transB) is set, the
+// input is replaced by its transpose computed at build time and the attribute
+// is dropped, so that the product contracts the operands in their natural
+// layout (e.g. weights exported as [N, K] for transB = 1)
+size_t foldGemmTranspose(Graph& g, ValueLiteralMap& valueToLiteral) {
+  size_t numRewritten = 0;
+  for (auto it = g.begin(); it != g.end(); ++it) {
+    Node* gemm = *it;
+    if (gemm->kind() != kGemm) {
+      continue;
+    }
+    bool rewritten = false;
+    auto fold = [&](const Symbol& attr, size_t inputIndex,
+                    const std::string& suffix) {
+      Value* input = gemm->inputs()[inputIndex];
+      if (!gemm->hasAttribute(attr) || gemm->i(attr) == 0 ||
+          !isConstant(input, valueToLiteral)) {
+        return;
+      }
+      const Literal& literal = constantLiteral(input, valueToLiteral);
+      if (ShapeUtil::Rank(literal.shape()) != 2) {
+        return;
+      }
+      auto transposed = transposeLiteral(literal, {1, 0});
+      if (!transposed) {
+        return;
+      }
+      Value* transposedValue = insertConstant(
+          g, gemm, std::move(transposed),
+          gemm->output()->uniqueName() + suffix, valueToLiteral);
+      gemm->replaceInput(inputIndex, transposedValue);
+      gemm->removeAttribute(attr);
+      rewritten = true;
+    };
+    fold(ktransA, 0, "_transposed_A");
+    fold(ktransB, 1, "_transposed_B");
+    if (rewritten) {
+      ++numRewritten;
+    }
+  }
+  return numRewritten;
+}
+}
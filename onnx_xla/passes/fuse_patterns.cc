@@ -0,0 +1,433 @@
+#include "onnx_xla/passes/graph_passes.h"
+
+namespace onnx_xla {
+// Returns the only user of v, or nullptr
+static Node* soleUser(const Value* v) {
+  return v->uses().size() == 1 ? v->uses()[0].user : nullptr;
+}
+
+// Returns true if every use of v is by user (so v is not a graph output and
+// is removed with the pattern)
+static bool usedOnlyBy(const Value* v, const Node* user) {
+  for (const auto& use : v->uses()) {
+    if (use.user != user) {
+      return false;
+    }
+  }
+  return v->uses().size() > 0;
+}
+
+// Returns the input of the binary node n other than v, or nullptr if v is
+// not an input of n
+static Value* otherInput(Node* n, const Value* v) {
+  if (n->inputs().size() != 2) {
+    return nullptr;
+  }
+  if (n->inputs()[0] == v) {
+    return n->inputs()[1];
+  }
+  return n->inputs()[1] == v ? n->inputs()[0] : nullptr;
+}
+
+// Sets value to the element of v if it is a floating point constant with one
+// element
+static bool scalarConstant(const Value* v,
+                           const ValueLiteralMap& valueToLiteral,
+                           double& value) {
+  if (!v || !isConstant(v, valueToLiteral)) {
+    return false;
+  }
+  const Literal& literal = constantLiteral(v, valueToLiteral);
+  if (ShapeUtil::ElementsIn(literal.shape()) != 1) {
+    return false;
+  }
+  switch (literal.shape().element_type()) {
+    case xla::F32: {
+      value = literal.data<float>()[0];
+      return true;
+    }
+    case xla::F64: {
+      value = literal.data<double>()[0];
+      return true;
+    }
+    default: { return false; }
+  }
+}
+
+// Returns true if v is a floating point constant with one element close to
+// expected (exporters round constants such as sqrt(2))
+static bool isScalarConstant(const Value* v,
+                             double expected,
+                             const ValueLiteralMap& valueToLiteral) {
+  double value;
+  return scalarConstant(v, valueToLiteral, value) &&
+         std::abs(value - expected) <=
+             1e-4 * std::max(1.0, std::abs(expected));
+}
+
+static bool staticSizes(const Value* v, std::vector<int64>& sizes) {
+  if (!v->has_sizes()) {
+    return false;
+  }
+  sizes.clear();
+  for (const auto& d : v->sizes()) {
+    if (!d.is_int) {
+      return false;
+    }
+    sizes.push_back(d.dim);
+  }
+  return true;
+}
+
+// Returns true if v has static sizes equal to the last dimensions of sizes
+static bool matchesTrailingSizes(const Value* v,
+                                 const std::vector<int64>& sizes,
+                                 size_t maxRank) {
+  std::vector<int64> vSizes;
+  return staticSizes(v, vSizes) && vSizes.size() <= maxRank &&
+         std::equal(vSizes.begin(), vSizes.end(),
+                    sizes.end() - vSizes.size());
+}
+
+// Sets axes to the sorted, non negative axes of a ReduceMean keeping the
+// reduced dimensions
+static bool reduceMeanAxes(const Node* n,
+                           int64 rank,
+                           std::vector<int64>& axes) {
+  if (n->kind() != Symbol("ReduceMean") || !n->hasAttribute(kaxes) ||
+      (n->hasAttribute(Symbol("keepdims")) &&
+       n->i(Symbol("keepdims")) == 0)) {
+    return false;
+  }
+  axes.clear();
+  for (auto axis : n->is(kaxes)) {
+    axes.push_back(axis < 0 ? axis + rank : axis);
+  }
+  std::sort(axes.begin(), axes.end());
+  return true;
+}
+
+// Replaces output by the output of a new node of kind (in kOnnxXlaDomain)
+// computing it from inputs, inserted before the node producing output. The
+// nodes of the pattern are left to dead code elimination.
+static Node* fuse(Graph& g,
+                  Value* output,
+                  const char* kind,
+                  const std::vector<Value*>& inputs) {
+  Node* fused = g.create(Symbol(kind), inputs, 1);
+  fused->setDomain(kOnnxXlaDomain);
+  fused->insertBefore(output->node());
+  fused->output()->setElemType(output->elemType());
+  fused->output()->setSizes(output->sizes());
+  replaceValue(output, fused->output());
+  return fused;
+}
+
+// LayerNormalization over the last dimensions, from axis:
+//   D = Sub(X, ReduceMean(X)), V = ReduceMean(Pow(D, 2) or Mul(D, D))
+//   Y = Div(D, Sqrt(Add(V, epsilon))) [* scale] [+ bias]
+// where both ReduceMean have the same trailing axes, and scale and bias have
+// the sizes of (the last of) the normalized dimensions
+static bool fuseLayerNormalization(Graph& g,
+                                   Node* div,
+                                   const ValueLiteralMap& valueToLiteral) {
+  if (div->kind() != kDiv) {
+    return false;
+  }
+  Value* centered = div->inputs()[0];
+  Node* sub = centered->node();
+  Node* sqrt = div->inputs()[1]->node();
+  if (sub->kind() != kSub || sqrt->kind() != Symbol("Sqrt") ||
+      !usedOnlyBy(sqrt->output(), div)) {
+    return false;
+  }
+  Node* addEpsilon = sqrt->inputs()[0]->node();
+  if (addEpsilon->kind() != kAdd ||
+      !usedOnlyBy(addEpsilon->output(), sqrt)) {
+    return false;
+  }
+  Value* variance = nullptr;
+  double epsilon = 0.0;
+  for (Value* v : addEpsilon->inputs()) {
+    if (v->node()->kind() == Symbol("ReduceMean") &&
+        scalarConstant(otherInput(addEpsilon, v), valueToLiteral, epsilon)) {
+      variance = v;
+    }
+  }
+  if (!variance || !usedOnlyBy(variance, addEpsilon)) {
+    return false;
+  }
+  Node* varianceMean = variance->node();
+  Value* squared = varianceMean->inputs()[0];
+  Node* square = squared->node();
+  // The kind is checked first: the producer may have no inputs (e.g. a graph
+  // input)
+  bool isSquare =
+      (square->kind() == Symbol("Pow") && square->inputs()[0] == centered &&
+       isScalarConstant(square->inputs()[1], 2.0, valueToLiteral)) ||
+      (square->kind() == kMul && square->inputs()[0] == centered &&
+       square->inputs()[1] == centered);
+  if (!isSquare || !usedOnlyBy(squared, varianceMean)) {
+    return false;
+  }
+  for (const auto& use : centered->uses()) {
+    if (use.user != square && use.user != div) {
+      return false;
+    }
+  }
+  Value* input = sub->inputs()[0];
+  Node* inputMean = sub->inputs()[1]->node();
+  if (inputMean->inputs().size() != 1 || inputMean->inputs()[0] != input ||
+      !usedOnlyBy(inputMean->output(), sub)) {
+    return false;
+  }
+
+  std::vector<int64> sizes;
+  std::vector<int64> axes;
+  std::vector<int64> varianceAxes;
+  if (!staticSizes(input, sizes) ||
+      !reduceMeanAxes(inputMean, sizes.size(), axes) ||
+      !reduceMeanAxes(varianceMean, sizes.size(), varianceAxes) ||
+      axes != varianceAxes || axes.empty()) {
+    return false;
+  }
+  for (auto i = 0; i < axes.size(); ++i) {
+    if (axes[i] != (int64)(sizes.size() - axes.size()) + i) {
+      return false;
+    }
+  }
+
+  // Optional scale, then optional bias
+  std::vector<Value*> inputs = {input};
+  Value* output = div->output();
+  auto extend = [&](const Symbol& kind) {
+    Node* user = soleUser(output);
+    if (!user || user->kind() != kind) {
+      return false;
+    }
+    Value* other = otherInput(user, output);
+    if (!other || !matchesTrailingSizes(other, sizes, axes.size())) {
+      return false;
+    }
+    inputs.push_back(other);
+    output = user->output();
+    return true;
+  };
+  if (extend(kMul)) {
+    extend(kAdd);
+  }
+
+  Node* fused = fuse(g, output, "LayerNormalization", inputs);
+  fused->i_(kaxis, axes[0]);
+  fused->f_(kepsilon, epsilon);
+  return true;
+}
+
+// Gelu (exact, with erf):
+//   Y = Mul(Mul(X, 0.5), Add(Erf(Div(X, sqrt(2))), 1)), or
+//   Y = Mul(Mul(X, Add(Erf(Div(X, sqrt(2))), 1)), 0.5)
+// with Div(X, sqrt(2)) possibly Mul(X, 1 / sqrt(2)), and operands of
+// commutative operators in either order
+static bool fuseGelu(Graph& g,
+                     Node* erf,
+                     const ValueLiteralMap& valueToLiteral) {
+  if (erf->kind() != Symbol("Erf") ||
+      !usedOnlyBy(erf->inputs()[0], erf)) {
+    return false;
+  }
+  Node* scale = erf->inputs()[0]->node();
+  Value* input = nullptr;
+  if (scale->kind() == kDiv &&
+      isScalarConstant(scale->inputs()[1], std::sqrt(2.0), valueToLiteral)) {
+    input = scale->inputs()[0];
+  } else if (scale->kind() == kMul) {
+    for (Value* v : scale->inputs()) {
+      if (isScalarConstant(otherInput(scale, v), std::sqrt(0.5),
+                           valueToLiteral)) {
+        input = v;
+      }
+    }
+  }
+  Node* addOne = soleUser(erf->output());
+  if (!input || !addOne || addOne->kind() != kAdd ||
+      !isScalarConstant(otherInput(addOne, erf->output()), 1.0,
+                        valueToLiteral)) {
+    return false;
+  }
+  Node* mul = soleUser(addOne->output());
+  if (!mul || mul->kind() != kMul) {
+    return false;
+  }
+  Value* other = otherInput(mul, addOne->output());
+  Value* output = nullptr;
+  if (other == input) {
+    Node* half = soleUser(mul->output());
+    if (half && half->kind() == kMul &&
+        isScalarConstant(otherInput(half, mul->output()), 0.5,
+                         valueToLiteral)) {
+      output = half->output();
+    }
+  } else {
+    Node* half = other->node();
+    if (half->kind() == kMul && usedOnlyBy(other, mul) &&
+        isScalarConstant(otherInput(half, input), 0.5, valueToLiteral)) {
+      output = mul->output();
+    }
+  }
+  if (!output) {
+    return false;
+  }
+  fuse(g, output, "Gelu", {input});
+  return true;
+}
+
+// Matches the attention scores before the mask, Scale(MatMul(Q, K^T)) with
+// optional Scale (Div or Mul by a scalar constant). Sets product to the
+// MatMul output and scale to the factor applied to it.
+static bool matchScaledProduct(Value* scaled,
+                               const ValueLiteralMap& valueToLiteral,
+                               Value*& product,
+                               double& scale) {
+  scale = 1.0;
+  product = scaled;
+  Node* scaleNode = scaled->node();
+  double constant;
+  if (scaleNode->kind() == kDiv &&
+      scalarConstant(scaleNode->inputs()[1], valueToLiteral, constant) &&
+      constant != 0.0) {
+    scale = 1.0 / constant;
+    product = scaleNode->inputs()[0];
+  } else if (scaleNode->kind() == kMul) {
+    for (Value* v : scaleNode->inputs()) {
+      if (v->node()->kind() == kMatMul &&
+          scalarConstant(otherInput(scaleNode, v), valueToLiteral, constant)) {
+        scale = constant;
+        product = v;
+      }
+    }
+  }
+  return product->node()->kind() == kMatMul &&
+         (product == scaled || usedOnlyBy(product, scaleNode));
+}
+
+// Scaled dot-product attention:
+//   Y = MatMul(Softmax(Add(Scale(MatMul(Q, K^T)), Mask)), V)
+// with Softmax over the last axis, optional Scale (Div or Mul by a constant)
+// and Mask (either operand of the Add), and Q, K^T and V with the same batch
+// dimensions. K^T may be a Transpose of the last two dimensions of K, which
+// is then folded. defaultAxis is the Softmax axis without the attribute,
+// which depends on the opset.
+static bool fuseAttention(Graph& g,
+                          Node* softmax,
+                          const ValueLiteralMap& valueToLiteral,
+                          int64 defaultAxis) {
+  if (softmax->kind() != kSoftmax) {
+    return false;
+  }
+  Value* scores = softmax->inputs()[0];
+  std::vector<int64> scoreSizes;
+  if (!staticSizes(scores, scoreSizes) || scoreSizes.size() < 2) {
+    return false;
+  }
+  int64 rank = scoreSizes.size();
+  int64 axis = softmax->hasAttribute(kaxis) ? softmax->i(kaxis) : defaultAxis;
+  Node* output = soleUser(softmax->output());
+  if ((axis < 0 ? axis + rank : axis) != rank - 1 || !output ||
+      output->kind() != kMatMul || output->inputs()[0] != softmax->output()) {
+    return false;
+  }
+
+  // Optional mask: the scores are the operand of the Add traced back to the
+  // MatMul, whichever operator produces the mask
+  Value* mask = nullptr;
+  Value* scaled = scores;
+  Value* product = nullptr;
+  double scale = 1.0;
+  Node* consumer = softmax;
+  Node* addMask = scores->node();
+  if (addMask->kind() == kAdd && usedOnlyBy(scores, softmax)) {
+    for (Value* v : addMask->inputs()) {
+      if (!mask && matchScaledProduct(v, valueToLiteral, product, scale)) {
+        scaled = v;
+        mask = otherInput(addMask, v);
+      }
+    }
+    // A mask of higher rank would broadcast the scores
+    std::vector<int64> maskSizes;
+    if (!mask || !staticSizes(mask, maskSizes) || maskSizes.size() > rank) {
+      return false;
+    }
+    consumer = addMask;
+  } else if (!matchScaledProduct(scores, valueToLiteral, product, scale)) {
+    return false;
+  }
+  if (!usedOnlyBy(scaled, consumer)) {
+    return false;
+  }
+  Node* matMul = product->node();
+
+  Value* query = matMul->inputs()[0];
+  Value* key = matMul->inputs()[1];
+  Value* value = output->inputs()[1];
+  std::vector<int64> querySizes;
+  std::vector<int64> keySizes;
+  std::vector<int64> valueSizes;
+  if (!staticSizes(query, querySizes) || !staticSizes(key, keySizes) ||
+      !staticSizes(value, valueSizes) || querySizes.size() != rank ||
+      keySizes.size() != rank || valueSizes.size() != rank ||
+      !std::equal(querySizes.begin(), querySizes.end() - 2,
+                  keySizes.begin()) ||
+      !std::equal(querySizes.begin(), querySizes.end() - 2,
+                  valueSizes.begin())) {
+    return false;
+  }
+  int64 keyTransposed = 1;
+  Node* transpose = key->node();
+  if (transpose->kind() == kTranspose && transpose->hasAttribute(kperm) &&
+      usedOnlyBy(key, matMul)) {
+    std::vector<int64_t> lastTwoSwapped(rank);
+    std::iota(lastTwoSwapped.begin(), lastTwoSwapped.end(), 0);
+    std::swap(lastTwoSwapped[rank - 2], lastTwoSwapped[rank - 1]);
+    if (transpose->is(kperm) == lastTwoSwapped) {
+      key = transpose->inputs()[0];
+      keyTransposed = 0;
+    }
+  }
+
+  std::vector<Value*> inputs = {query, key, value};
+  if (mask) {
+    inputs.push_back(mask);
+  }
+  Node* fused = fuse(g, output->output(), "Attention", inputs);
+  fused->f_(Symbol("scale"), scale);
+  fused->i_(Symbol("key_transposed"), keyTransposed);
+  return true;
+}
+
+size_t fusePatterns(Graph& g,
+                    ValueLiteralMap& valueToLiteral,
+                    const OpsetVersionMap& opsetVersions) {
+  // Softmax defaults to the last axis since opset 13, and to axis 1 before
+  // (or when the opset is not known)
+  auto opsetIt = opsetVersions.find("");
+  int64 defaultSoftmaxAxis =
+      opsetIt != opsetVersions.end() && opsetIt->second >= 13 ? -1 : 1;
+  std::vector<Node*> nodes;
+  for (auto it = g.begin(); it != g.end(); ++it) {
+    nodes.push_back(*it);
+  }
+  size_t numFused = 0;
+  for (Node* n : nodes) {
+    // Skip nodes of patterns fused already
+    if (n->outputs().size() != 1 || n->output()->uses().empty()) {
+      continue;
+    }
+    if (fuseLayerNormalization(g, n, valueToLiteral) ||
+        fuseGelu(g, n, valueToLiteral) ||
+        fuseAttention(g, n, valueToLiteral, defaultSoftmaxAxis)) {
+      ++numFused;
+    }
+  }
+  return numFused;
+}
+}
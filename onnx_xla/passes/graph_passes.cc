@@ -0,0 +1,61 @@
+#include "onnx_xla/passes/graph_passes.h"
+
+#include <cstdlib>
+#include <set>
+#include <sstream>
+
+namespace onnx_xla {
+using GraphPass = std::function<size_t(Graph&, ValueLiteralMap&)>;
+
+// Passes in the order they run
+static std::vector<std::pair<std::string, GraphPass>> passes(
+    const GraphOptions& options,
+    const OpsetVersionMap& opsetVersions) {
+  return {
+      {"bind_captured_values", bindCapturedValues},
+      {"fold_constants", foldConstants},
+      {"eliminate_dequantize_quantize", eliminateDequantizeQuantize},
+      {"eliminate_common_subexpressions", eliminateCommonSubexpressions},
+      {"fold_batch_normalization", foldBatchNormalization},
+      {"fold_gemm_scaling", foldGemmScaling},
+      {"fold_gemm_transpose", foldGemmTranspose},
+      {"simplify_layout", simplifyLayout},
+      {"fuse_patterns",
+       [&opsetVersions](Graph& g, ValueLiteralMap& valueToLiteral) {
+         return fusePatterns(g, valueToLiteral, opsetVersions);
+       }},
+      {"convert_precision",
+       [&options](Graph& g, ValueLiteralMap& valueToLiteral) {
+         return convertPrecision(g, valueToLiteral, options);
+       }},
+      {"eliminate_dead_code", eliminateDeadCode}};
+}
+
+static std::set<std::string> disabledPasses() {
+  std::set<std::string> disabled;
+  const char* names = std::getenv("ONNX_XLA_DISABLED_PASSES");
+  std::stringstream stream(names ? names : "");
+  std::string name;
+  while (std::getline(stream, name, ',')) {
+    if (name != "bind_captured_values") {
+      disabled.insert(name);
+    }
+  }
+  return disabled;
+}
+
+PassStats optimizeGraph(Graph& g,
+                        ValueLiteralMap& valueToLiteral,
+                        const GraphOptions& options,
+                        const OpsetVersionMap& opsetVersions) {
+  PassStats stats;
+  auto disabled = disabledPasses();
+  for (const auto& pass : passes(options, opsetVersions)) {
+    if (disabled.count(pass.first)) {
+      continue;
+    }
+    stats[pass.first] += pass.second(g, valueToLiteral);
+  }
+  return stats;
+}
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "onnx_xla/graph_options.h"
+#include "onnx_xla/passes/pass_helper.h"
+
+#include <map>
+
+namespace onnx_xla {
+// Number of nodes removed or rewritten by each pass, keyed on pass name
+using PassStats = std::map<std::string, size_t>;
+
+// Rewrite passes run on the IR graph before translation
+// In: valueToLiteral holds the literal of every build time constant value
+// (initializers, weight descriptors)
+// Out: The graph computes the same outputs (under the same names);
+// valueToLiteral is updated for constants that were created or removed
+// Each pass returns the number of nodes it removed or rewrote
+
+// Appends the values of g captured by the subgraphs of each node (If, Loop,
+// Scan bodies) to the inputs of the node, in subgraphAttributes order, so that
+// later passes keep them alive and translators can bind them by position
+size_t bindCapturedValues(Graph& g, ValueLiteralMap& valueToLiteral);
+
+// Evaluates on the host every node whose inputs are all constant (including
+// Shape of a statically shaped value) and replaces it with a Constant node
+size_t foldConstants(Graph& g, ValueLiteralMap& valueToLiteral);
+
+// Replaces QuantizeLinear(DequantizeLinear(x)) with the same scale and zero
+// point by x, when the round trip yields the type of x
+size_t eliminateDequantizeQuantize(Graph& g, ValueLiteralMap& valueToLiteral);
+
+// Folds a test mode BatchNormalization with constant parameters into the
+// weights and bias of the constant-weight Conv producing its input
+size_t foldBatchNormalization(Graph& g, ValueLiteralMap& valueToLiteral);
+
+// Folds the alpha and beta attributes of Gemm into constant B and C inputs
+size_t foldGemmScaling(Graph& g, ValueLiteralMap& valueToLiteral);
+
+// Merges nodes of the same kind with identical inputs and attributes
+// (including Constant nodes with equal values). Random operators are kept.
+size_t eliminateCommonSubexpressions(Graph& g,
+                                     ValueLiteralMap& valueToLiteral);
+
+// Transposes constant A and B inputs of Gemm with transA or transB set at
+// build time, dropping the attribute
+size_t foldGemmTranspose(Graph& g, ValueLiteralMap& valueToLiteral);
+
+// Merges consecutive Transposes, collapses chains of Reshape, Unsqueeze,
+// Squeeze and Flatten into one Reshape, drops identity ones, and moves
+// Transposes below elementwise operators so that they cancel or merge
+size_t simplifyLayout(Graph& g, ValueLiteralMap& valueToLiteral);
+
+// Replaces the decompositions of LayerNormalization (over the last
+// dimensions), Gelu (with erf) and scaled dot-product attention (with Softmax
+// over the last axis) by single operators of kOnnxXlaDomain, lowered compactly
+// opsetVersions (of the model) gives the attribute defaults of the operators
+size_t fusePatterns(Graph& g,
+                    ValueLiteralMap& valueToLiteral,
+                    const OpsetVersionMap& opsetVersions);
+
+// Mixed precision (if options.computeType is not F32): float operators
+// compute in the reduced type, except numerically sensitive ones (kept in
+// float32) and products (which convert their operands to float32 so that
+// they accumulate in float32). Float weights are stored in the reduced type
+// unless only used in float32. Cast nodes convert values between regions, and
+// graph inputs and outputs keep their types.
+size_t convertPrecision(Graph& g,
+                        ValueLiteralMap& valueToLiteral,
+                        const GraphOptions& options);
+
+// Removes nodes none of whose outputs are used, and unused trailing outputs
+// of the remaining nodes
+size_t eliminateDeadCode(Graph& g, ValueLiteralMap& valueToLiteral);
+
+// Runs every pass in order, returning what each pass did. Passes named in the
+// comma separated ONNX_XLA_DISABLED_PASSES environment variable are skipped,
+// except bind_captured_values, which translation relies on.
+PassStats optimizeGraph(Graph& g,
+                        ValueLiteralMap& valueToLiteral,
+                        const GraphOptions& options = GraphOptions(),
+                        const OpsetVersionMap& opsetVersions = {});
+}
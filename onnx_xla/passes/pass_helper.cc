@@ -0,0 +1,113 @@
+#include "onnx_xla/passes/pass_helper.h"
+
+namespace onnx_xla {
+bool isConstant(const Value* v, const ValueLiteralMap& valueToLiteral) {
+  return valueToLiteral.find(v) != valueToLiteral.end();
+}
+
+const Literal& constantLiteral(const Value* v,
+                               const ValueLiteralMap& valueToLiteral) {
+  return *valueToLiteral.at(v);
+}
+
+bool isMissingOptional(const Value* v) {
+  return v->node()->kind() == Symbol("Undefined") || v->uniqueName() == "";
+}
+
+Value* insertConstant(Graph& g,
+                      Node* before,
+                      std::unique_ptr<Literal> literal,
+                      const std::string& name,
+                      ValueLiteralMap& valueToLiteral) {
+  Node* constant = g.create(kConstant, 1);
+  constant->insertBefore(before);
+  Value* output = constant->output();
+  output->setUniqueName(name);
+  output->setElemType(primitiveToOnnx(literal->shape().element_type()));
+  std::vector<Dimension> sizes;
+  for (auto dim : literal->shape().dimensions()) {
+    sizes.emplace_back(dim);
+  }
+  output->setSizes(sizes);
+  valueToLiteral[output] = std::move(literal);
+  return output;
+}
+
+void replaceValue(Value* from, Value* to) {
+  std::string name = from->uniqueName();
+  from->replaceAllUsesWith(to);
+  to->setUniqueName(name);
+}
+
+void destroyNode(Node* n, ValueLiteralMap& valueToLiteral) {
+  for (const Value* v : n->outputs()) {
+    valueToLiteral.erase(v);
+  }
+  n->destroy();
+}
+
+bool isProducedBy(const Value* v, const Symbol& kind) {
+  return v->node()->kind() == kind;
+}
+
+bool isGraphOutput(const Value* v) {
+  for (const auto& use : v->uses()) {
+    if (use.user->kind() == kReturn) {
+      return true;
+    }
+  }
+  return false;
+}
+
+template <typename T>
+static std::unique_ptr<Literal> transposeImpl(const Literal& l,
+                                              const std::vector<int64>& perm) {
+  const auto& inDims = l.shape().dimensions();
+  std::vector<int64> inStrides(inDims.size(), 1);
+  for (int64 d = (int64)inDims.size() - 2; d >= 0; --d) {
+    inStrides[d] = inStrides[d + 1] * inDims[d + 1];
+  }
+  std::vector<int64> outDims;
+  for (auto p : perm) {
+    outDims.push_back(inDims.at(p));
+  }
+  auto out = Literal::CreateFromShape(
+      ShapeUtil::MakeShape(l.shape().element_type(), outDims));
+  auto inData = l.data<T>();
+  auto outData = out->data<T>();
+  std::vector<int64> index(outDims.size(), 0);
+  for (int64 i = 0; i < (int64)outData.size(); ++i) {
+    int64 offset = 0;
+    for (auto d = 0; d < index.size(); ++d) {
+      offset += index[d] * inStrides[perm[d]];
+    }
+    outData[i] = inData[offset];
+    for (int64 d = (int64)index.size() - 1; d >= 0; --d) {
+      if (++index[d] < outDims[d]) {
+        break;
+      }
+      index[d] = 0;
+    }
+  }
+  return out;
+}
+
+std::unique_ptr<Literal> transposeLiteral(const Literal& literal,
+                                          const std::vector<int64>& perm) {
+  switch (literal.shape().element_type()) {
+    case xla::F32: {
+      return transposeImpl<float>(literal, perm);
+    }
+    case xla::F64: {
+      return transposeImpl<double>(literal, perm);
+    }
+    case xla::S32: {
+      return transposeImpl<int32>(literal, perm);
+    }
+    case xla::S64: {
+      return transposeImpl<int64>(literal, perm);
+    }
+    default: { return nullptr; }
+  }
+}
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "onnx_xla/operator_registry.h"
+
+#include <string>
+
+namespace onnx_xla {
+using ::ONNX_NAMESPACE::Graph;
+
+// Utilities shared by the IR graph passes. Build time constant values are
+// represented by an entry in valueToLiteral; passes create new constants as
+// Constant nodes whose output literal is stored there.
+
+// Returns true if the value of v is known at build time
+bool isConstant(const Value* v, const ValueLiteralMap& valueToLiteral);
+
+// Returns the build time literal of v (v must be constant)
+const Literal& constantLiteral(const Value* v,
+                               const ValueLiteralMap& valueToLiteral);
+
+// Returns true if v is a placeholder for an omitted optional input
+bool isMissingOptional(const Value* v);
+
+// Creates a Constant node, inserted before the node before, whose output
+// holds literal. Output type and shape are set from literal. Returns output.
+Value* insertConstant(Graph& g,
+                      Node* before,
+                      std::unique_ptr<Literal> literal,
+                      const std::string& name,
+                      ValueLiteralMap& valueToLiteral);
+
+// Replaces all uses of from by to. to takes over the unique name of from, so
+// graph outputs keep the names expected by the executor.
+void replaceValue(Value* from, Value* to);
+
+// Destroys n (its outputs must have no uses), dropping any literals of its
+// outputs
+void destroyNode(Node* n, ValueLiteralMap& valueToLiteral);
+
+// Returns true if v is the output of a node of the given kind
+bool isProducedBy(const Value* v, const Symbol& kind);
+
+// Returns true if v is an output of the graph
+bool isGraphOutput(const Value* v);
+
+// Returns the transpose of literal by perm (output dimension i is input
+// dimension perm[i]), or nullptr for unsupported element types
+std::unique_ptr<Literal> transposeLiteral(const Literal& literal,
+                                          const std::vector<int64>& perm);
+}
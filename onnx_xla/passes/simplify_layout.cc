@@ -0,0 +1,320 @@
+#include "onnx_xla/passes/graph_passes.h"
+
+#include <unordered_set>
+
+namespace onnx_xla {
+// Sweeps stop once the graph no longer changes, or after this many sweeps
+static const int kMaxLayoutSweeps = 16;
+
+// Elementwise operators a Transpose can be moved across unchanged
+static bool isElementwiseUnary(const Node* n) {
+  static const std::unordered_set<std::string> kinds = {
+      "Relu", "LeakyRelu", "Elu", "Selu", "Sigmoid", "Tanh",
+      "Exp", "Log", "Neg", "Abs", "Sqrt", "Reciprocal",
+      "Floor", "Ceil", "Softsign", "Softplus", "Identity", "Cast"};
+  return n->inputs().size() == 1 && n->outputs().size() == 1 &&
+         kinds.count(n->kind().toString());
+}
+
+static bool isElementwiseNary(const Node* n) {
+  static const std::unordered_set<std::string> kinds = {
+      "Add", "Sub", "Mul", "Div", "Pow", "Sum", "Max", "Min", "Mean"};
+  return n->outputs().size() == 1 && kinds.count(n->kind().toString());
+}
+
+// Returns the permutation of Transpose node n, or an empty vector if it
+// cannot be determined (no perm attribute and unknown input rank)
+static std::vector<int64> transposePermutation(const Node* n) {
+  std::vector<int64> perm;
+  if (n->hasAttribute(kperm)) {
+    perm.assign(n->is(kperm).begin(), n->is(kperm).end());
+  } else if (n->inputs().at(0)->has_sizes()) {
+    for (int64 i = n->inputs().at(0)->sizes().size() - 1; i >= 0; --i) {
+      perm.push_back(i);
+    }
+  }
+  return perm;
+}
+
+static bool isIdentityPermutation(const std::vector<int64>& perm) {
+  for (auto i = 0; i < perm.size(); ++i) {
+    if (perm[i] != i) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Returns the sizes of v if they are all static and positive, otherwise an
+// empty vector
+static std::vector<int64> staticSizes(const Value* v) {
+  std::vector<int64> dims;
+  if (!v->has_sizes()) {
+    return dims;
+  }
+  for (const auto& d : v->sizes()) {
+    if (!d.is_int || d.dim <= 0) {
+      return {};
+    }
+    dims.push_back(d.dim);
+  }
+  return dims;
+}
+
+// Reshape (with constant target), Unsqueeze, Squeeze and Flatten only change
+// the shape of their input
+static bool isReshapeLike(const Node* n,
+                          const ValueLiteralMap& valueToLiteral) {
+  if (n->kind() == kReshape) {
+    return isConstant(n->inputs().at(1), valueToLiteral);
+  }
+  return n->kind() == kUnsqueeze || n->kind() == Symbol("Squeeze") ||
+         n->kind() == Symbol("Flatten");
+}
+
+// Returns true if every use of v is by n
+static bool onlyUsedBy(const Value* v, const Node* n) {
+  for (const auto& use : v->uses()) {
+    if (use.user != n) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Moves the computation of the single output y of n before a new Transpose
+// by perm: y is renamed, its sizes are permuted back, and former consumers of
+// y (and the graph output name) move to the Transpose output
+static void insertTransposeAfter(Graph& g,
+                                 Node* n,
+                                 const std::vector<int64>& perm) {
+  Value* y = n->output();
+  Node* transpose = g.create(kTranspose, 1);
+  transpose->insertAfter(n);
+  transpose->is_(kperm, std::vector<int64_t>(perm.begin(), perm.end()));
+  Value* transposed = transpose->output();
+  transposed->setElemType(y->elemType());
+  if (y->has_sizes()) {
+    const auto sizes = y->sizes();
+    std::vector<Dimension> untransposedSizes(sizes);
+    for (auto i = 0; i < perm.size(); ++i) {
+      untransposedSizes[perm[i]] = sizes[i];
+    }
+    transposed->setSizes(sizes);
+    y->setSizes(untransposedSizes);
+  }
+  const std::string name = y->uniqueName();
+  y->replaceAllUsesWith(transposed);
+  transpose->addInput(y);
+  y->setUniqueName(name + "_untransposed");
+  transposed->setUniqueName(name);
+}
+
+// Rewriting state of one sweep. Nodes are destroyed only once they are
+// unused; destroyed nodes are skipped for the rest of the sweep
+struct LayoutRewriter {
+  Graph& g;
+  ValueLiteralMap& valueToLiteral;
+  std::unordered_set<Node*> removed;
+
+  void removeIfUnused(Node* n) {
+    for (const Value* v : n->outputs()) {
+      if (v->uses().size() > 0) {
+        return;
+      }
+    }
+    removed.insert(n);
+    destroyNode(n, valueToLiteral);
+  }
+
+  // Forwards the input of n to its consumers when n computes the identity
+  bool bypass(Node* n) {
+    if (isGraphOutput(n->output())) {
+      return false;
+    }
+    n->output()->replaceAllUsesWith(n->inputs().at(0));
+    removeIfUnused(n);
+    return true;
+  }
+
+  // Transpose(Transpose(x, p1), p2) = Transpose(x, p1[p2]); identity
+  // permutations are dropped
+  bool simplifyTranspose(Node* n) {
+    auto perm = transposePermutation(n);
+    if (perm.empty()) {
+      return false;
+    }
+    if (isIdentityPermutation(perm)) {
+      return bypass(n);
+    }
+    Node* producer = n->inputs().at(0)->node();
+    if (producer->kind() != kTranspose) {
+      return false;
+    }
+    auto innerPerm = transposePermutation(producer);
+    if (innerPerm.size() != perm.size()) {
+      return false;
+    }
+    std::vector<int64_t> composed;
+    for (auto p : perm) {
+      composed.push_back(innerPerm[p]);
+    }
+    n->replaceInput(0, producer->inputs().at(0));
+    n->is_(kperm, std::move(composed));
+    removeIfUnused(producer);
+    return true;
+  }
+
+  // A chain of reshape-like nodes becomes a single Reshape of the chain input
+  // to the (static) output sizes; shape-preserving ones are dropped
+  bool simplifyReshape(Node* n) {
+    auto outputSizes = staticSizes(n->output());
+    if (outputSizes.empty()) {
+      return false;
+    }
+    Value* input = n->inputs().at(0);
+    if (staticSizes(input) == outputSizes) {
+      return bypass(n);
+    }
+    Node* producer = input->node();
+    if (!isReshapeLike(producer, valueToLiteral)) {
+      return false;
+    }
+    Value* shape = insertConstant(g, n, Literal::CreateR1<int64>(outputSizes),
+                                  n->output()->uniqueName() + "_shape",
+                                  valueToLiteral);
+    if (n->kind() == kReshape) {
+      n->replaceInput(0, producer->inputs().at(0));
+      n->replaceInput(1, shape);
+    } else {
+      Node* reshape = g.create(kReshape, {producer->inputs().at(0), shape}, 1);
+      reshape->insertBefore(n);
+      reshape->output()->setElemType(n->output()->elemType());
+      reshape->output()->setSizes(n->output()->sizes());
+      replaceValue(n->output(), reshape->output());
+      removeIfUnused(n);
+    }
+    removeIfUnused(producer);
+    return true;
+  }
+
+  // unary(Transpose(x, p)) = Transpose(unary(x), p)
+  bool sinkThroughUnary(Node* n) {
+    Node* producer = n->inputs().at(0)->node();
+    if (producer->kind() != kTranspose ||
+        !onlyUsedBy(producer->output(), n)) {
+      return false;
+    }
+    auto perm = transposePermutation(producer);
+    if (perm.empty()) {
+      return false;
+    }
+    n->replaceInput(0, producer->inputs().at(0));
+    removeIfUnused(producer);
+    insertTransposeAfter(g, n, perm);
+    return true;
+  }
+
+  // op(Transpose(a, p), Transpose(b, p), c) = Transpose(op(a, b, c'), p)
+  // where c is a constant that is either a single element or of the same
+  // rank, transposed at build time (c' = Transpose(c, inverse(p)))
+  bool sinkThroughNary(Node* n) {
+    std::vector<int64> perm;
+    for (const Value* v : n->inputs()) {
+      if (v->node()->kind() == kTranspose) {
+        perm = transposePermutation(v->node());
+        break;
+      }
+    }
+    if (perm.empty()) {
+      return false;
+    }
+    for (const Value* v : n->inputs()) {
+      if (v->node()->kind() == kTranspose) {
+        if (!onlyUsedBy(v, n) || transposePermutation(v->node()) != perm) {
+          return false;
+        }
+      } else if (isConstant(v, valueToLiteral)) {
+        const auto& shape = constantLiteral(v, valueToLiteral).shape();
+        if (ShapeUtil::Rank(shape) > perm.size() ||
+            (ShapeUtil::ElementsIn(shape) != 1 &&
+             ShapeUtil::Rank(shape) != perm.size())) {
+          return false;
+        }
+      } else {
+        return false;
+      }
+    }
+
+    std::vector<int64> inversePerm(perm.size());
+    for (auto i = 0; i < perm.size(); ++i) {
+      inversePerm[perm[i]] = i;
+    }
+    std::vector<Node*> transposes;
+    for (auto i = 0; i < n->inputs().size(); ++i) {
+      Value* v = n->inputs()[i];
+      if (v->node()->kind() == kTranspose) {
+        transposes.push_back(v->node());
+        n->replaceInput(i, v->node()->inputs().at(0));
+      } else if (ShapeUtil::ElementsIn(
+                     constantLiteral(v, valueToLiteral).shape()) != 1) {
+        auto literal =
+            transposeLiteral(constantLiteral(v, valueToLiteral), inversePerm);
+        if (!literal) {  // TODO: ENFORCE
+          throw std::runtime_error("Unsupported constant type");
+        }
+        n->replaceInput(i, insertConstant(g, n, std::move(literal),
+                                          v->uniqueName() + "_transposed",
+                                          valueToLiteral));
+      }
+    }
+    for (Node* transpose : transposes) {
+      if (!removed.count(transpose)) {
+        removeIfUnused(transpose);
+      }
+    }
+    insertTransposeAfter(g, n, perm);
+    return true;
+  }
+
+  // Returns the number of rewrites
+  size_t sweep() {
+    removed.clear();
+    std::vector<Node*> nodes;
+    for (auto it = g.begin(); it != g.end(); ++it) {
+      nodes.push_back(*it);
+    }
+    size_t numRewritten = 0;
+    for (Node* n : nodes) {
+      if (removed.count(n)) {
+        continue;
+      }
+      bool rewritten = false;
+      if (n->kind() == kTranspose) {
+        rewritten = simplifyTranspose(n);
+      } else if (isReshapeLike(n, valueToLiteral)) {
+        rewritten = simplifyReshape(n);
+      } else if (isElementwiseUnary(n)) {
+        rewritten = sinkThroughUnary(n);
+      } else if (isElementwiseNary(n)) {
+        rewritten = sinkThroughNary(n);
+      }
+      numRewritten += rewritten;
+    }
+    return numRewritten;
+  }
+};
+
+size_t simplifyLayout(Graph& g, ValueLiteralMap& valueToLiteral) {
+  LayoutRewriter rewriter{g, valueToLiteral, {}};
+  size_t numRewritten = 0;
+  for (auto i = 0; i < kMaxLayoutSweeps; ++i) {
+    auto numSweepRewrites = rewriter.sweep();
+    if (numSweepRewrites == 0) {
+      break;
+    }
+    numRewritten += numSweepRewrites;
+  }
+  return numRewritten;
+}
+}
@@ -0,0 +1,93 @@
+#include "onnx_xla/plugin_loader.h"
+
+#include <dlfcn.h>
+#include <cstdlib>
+#include <sstream>
+#include <unordered_set>
+
+namespace onnx_xla {
+// Registration function passed to plugins
+static onnxStatus registerPluginTranslator(
+    const OnnxXlaTranslatorDescriptor* descriptor) {
+  if (!descriptor || !descriptor->opType || !descriptor->translate) {
+    return ONNXIFI_STATUS_INVALID_POINTER;
+  }
+  if (descriptor->sinceVersion > descriptor->untilVersion) {
+    return ONNXIFI_STATUS_INVALID_MODEL;
+  }
+  auto translate = descriptor->translate;
+  auto predicate = descriptor->predicate;
+  TranslatorEntry entry{
+      descriptor->domain ? descriptor->domain : "",
+      Symbol(descriptor->opType),
+      descriptor->sinceVersion,
+      descriptor->untilVersion,
+      descriptor->priority,
+      descriptor->variant ? descriptor->variant : "default",
+      nullptr,
+      [translate](const Node& n, XlaBuilder& builder, ValueOpMap& valueToOp,
+                  const ValueLiteralMap& valueToLiteral) {
+        return translate(&n, &builder, &valueToOp, &valueToLiteral);
+      }};
+  if (predicate) {
+    entry.predicate = [predicate](const Node& n,
+                                  const ValueLiteralMap& valueToLiteral) {
+      return predicate(&n, &valueToLiteral) != 0;
+    };
+  }
+  try {
+    OperatorRegistry::registerTranslator(std::move(entry));
+  } catch (const std::runtime_error& e) {
+    std::cerr << e.what() << std::endl;
+    return ONNXIFI_STATUS_INVALID_STATE;
+  }
+  return ONNXIFI_STATUS_SUCCESS;
+}
+
+static onnxStatus loadPlugin(const std::string& path) {
+  static std::unordered_set<std::string> loaded;
+  static std::mutex mutex;
+  std::lock_guard<std::mutex> lock(mutex);
+  if (loaded.count(path)) {
+    return ONNXIFI_STATUS_SUCCESS;
+  }
+  void* handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+  if (!handle) {  // TODO: ENFORCE
+    std::cerr << "Unable to load plugin " << path << ": " << dlerror()
+              << std::endl;
+    return ONNXIFI_STATUS_BACKEND_UNAVAILABLE;
+  }
+  auto init = reinterpret_cast<OnnxXlaPluginInit>(
+      dlsym(handle, ONNX_XLA_PLUGIN_INIT_SYMBOL));
+  if (!init) {  // TODO: ENFORCE
+    std::cerr << "Plugin " << path << " does not export "
+              << ONNX_XLA_PLUGIN_INIT_SYMBOL << std::endl;
+    dlclose(handle);
+    return ONNXIFI_STATUS_BACKEND_UNAVAILABLE;
+  }
+  // Registered translators point into the library, so it stays loaded even if
+  // initialization fails part way
+  loaded.insert(path);
+  return init(ONNX_XLA_PLUGIN_API_VERSION, registerPluginTranslator);
+}
+
+onnxStatus loadPlugins(const std::string& paths) {
+  std::istringstream pathStream(paths);
+  std::string path;
+  while (std::getline(pathStream, path, ':')) {
+    if (path.empty()) {
+      continue;
+    }
+    auto status = loadPlugin(path);
+    if (status != ONNXIFI_STATUS_SUCCESS) {
+      return status;
+    }
+  }
+  return ONNXIFI_STATUS_SUCCESS;
+}
+
+onnxStatus loadPluginsFromEnvironment() {
+  const char* paths = std::getenv(ONNX_XLA_PLUGINS_ENV);
+  return paths ? loadPlugins(paths) : ONNXIFI_STATUS_SUCCESS;
+}
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "onnx_xla/onnx_xla_plugin.h"
+#include "onnx_xla/operator_registry.h"
+
+#include <string>
+
+namespace onnx_xla {
+// Loads the translator plugins (see onnx_xla_plugin.h) listed in paths
+// (separated by ':'), registering their translators in OperatorRegistry.
+// Plugins already loaded are skipped; loaded plugins are never unloaded.
+onnxStatus loadPlugins(const std::string& paths);
+
+// Loads the plugins listed in the environment variable ONNX_XLA_PLUGINS
+onnxStatus loadPluginsFromEnvironment();
+}
@@ -0,0 +1,81 @@
+#include "onnx_xla/quantization_helper.h"
+#include "onnx_xla/passes/pass_helper.h"
+
+namespace onnx_xla {
+QuantizationParameter quantizationParameter(const Node& n,
+                                            size_t i,
+                                            const ValueOpMap& valueToOp,
+                                            XlaBuilder& builder,
+                                            int64 axis,
+                                            PrimitiveType defaultType) {
+  if (i >= n.inputs().size() || isMissingOptional(n.inputs().at(i))) {
+    return {builder.ConstantLiteral(Literal::Zero(defaultType)), {}};
+  }
+  auto sizes = parseOnnxInputSizes(n, i);
+  auto numElements = std::accumulate(sizes.begin(), sizes.end(), (int64)1,
+                                     std::multiplies<int64>());
+  auto op = valueToOp.at(n.inputs().at(i));
+  if (numElements == 1) {
+    return {builder.Reshape(op, {}), {}};
+  }
+  if (sizes.size() != 1) {  // TODO: ENFORCE
+    throw std::runtime_error("Quantization parameters must be scalars or 1-D");
+  }
+  return {op, {axis}};
+}
+
+XlaOp roundHalfToEven(XlaBuilder& builder, const XlaOp& x) {
+  auto halfOp = builder.ConstantR0<float>(0.5f);
+  auto floorOp = builder.Floor(x);
+  auto fractionOp = builder.Sub(x, floorOp);
+  // Ties go to floor if it is even, else to floor + 1
+  auto tieOp = builder.Add(
+      floorOp, builder.Abs(builder.Rem(floorOp, builder.ConstantR0<float>(2))));
+  return builder.Select(
+      builder.Gt(fractionOp, halfOp),
+      builder.Add(floorOp, builder.ConstantR0<float>(1)),
+      builder.Select(builder.Lt(fractionOp, halfOp), floorOp, tieOp));
+}
+
+XlaOp quantizedOffsets(XlaBuilder& builder,
+                       const XlaOp& quantized,
+                       const QuantizationParameter& zeroPoint) {
+  return builder.Sub(builder.ConvertElementType(quantized, xla::S32),
+                     builder.ConvertElementType(zeroPoint.op, xla::S32),
+                     zeroPoint.broadcastDims);
+}
+
+XlaOp quantize(XlaBuilder& builder,
+               const XlaOp& real,
+               const QuantizationParameter& scale,
+               const QuantizationParameter& zeroPoint) {
+  auto quantizedType =
+      builder.GetShape(zeroPoint.op).ValueOrDie().element_type();
+  float lowest;
+  float highest;
+  switch (quantizedType) {
+    case xla::U8: {
+      lowest = std::numeric_limits<uint8>::lowest();
+      highest = std::numeric_limits<uint8>::max();
+      break;
+    }
+    case xla::S8: {
+      lowest = std::numeric_limits<int8>::lowest();
+      highest = std::numeric_limits<int8>::max();
+      break;
+    }
+    default: {  // TODO: ENFORCE
+      throw std::runtime_error("Quantized type must be int8 or uint8");
+    }
+  }
+  auto roundedOp = roundHalfToEven(
+      builder, builder.Div(real, scale.op, scale.broadcastDims));
+  auto shiftedOp =
+      builder.Add(roundedOp, builder.ConvertElementType(zeroPoint.op, xla::F32),
+                  zeroPoint.broadcastDims);
+  return builder.ConvertElementType(
+      builder.Clamp(builder.ConstantR0<float>(lowest), shiftedOp,
+                    builder.ConstantR0<float>(highest)),
+      quantizedType);
+}
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "onnx_xla/operator_registry.h"
+
+namespace onnx_xla {
+// Utilities to translate the ONNX linear quantization operators
+// (QuantizeLinear, DequantizeLinear, QLinearConv, QLinearMatMul).
+// Real values are float, quantized values are int8 or uint8 with a scale and
+// zero point per tensor or per slice along one axis:
+//   real = (quantized - zeroPoint) * scale
+
+// Scale or zero point, as an op broadcastable against the tensor it applies to
+struct QuantizationParameter {
+  XlaOp op;
+  // Empty for a scalar, else the axis of the tensor the parameter runs along
+  std::vector<int64> broadcastDims;
+};
+
+// Returns input i of n as a quantization parameter of a tensor, applying along
+// axis if it has more than one element. If the input is missing (zero
+// points), returns a zero of type defaultType.
+QuantizationParameter quantizationParameter(const Node& n,
+                                            size_t i,
+                                            const ValueOpMap& valueToOp,
+                                            XlaBuilder& builder,
+                                            int64 axis,
+                                            PrimitiveType defaultType);
+
+// Returns x rounded to the nearest integer, with ties to even (as ONNX
+// quantization rounds)
+XlaOp roundHalfToEven(XlaBuilder& builder, const XlaOp& x);
+
+// Returns the int32 offsets quantized - zeroPoint
+XlaOp quantizedOffsets(XlaBuilder& builder,
+                       const XlaOp& quantized,
+                       const QuantizationParameter& zeroPoint);
+
+// Returns real / scale rounded, offset by zeroPoint and saturated to the type
+// of zeroPoint. real and scale are float.
+XlaOp quantize(XlaBuilder& builder,
+               const XlaOp& real,
+               const QuantizationParameter& scale,
+               const QuantizationParameter& zeroPoint);
+}
@@ -0,0 +1,313 @@
+#include "onnx_xla/recurrent_helper.h"
+#include "onnx_xla/control_flow_helper.h"
+#include "onnx_xla/passes/pass_helper.h"
+
+namespace onnx_xla {
+static const size_t kInputX = 0;
+static const size_t kInputW = 1;
+static const size_t kInputR = 2;
+static const size_t kInputSequenceLens = 4;
+
+RecurrentHelper::RecurrentHelper(
+    const Node& n,
+    const ValueOpMap& valueToOp,
+    int64 numGates,
+    const std::vector<std::string>& defaultActivations)
+    : n_(n), value_to_op_(valueToOp), num_gates_(numGates) {
+  std::string direction = "forward";
+  if (n.hasAttribute(Symbol("direction"))) {
+    direction = n.s(Symbol("direction"));
+  }
+  if (direction != "forward" && direction != "reverse" &&
+      direction != "bidirectional") {  // TODO: ENFORCE
+    throw std::runtime_error("Invalid direction " + direction);
+  }
+  num_directions_ = direction == "bidirectional" ? 2 : 1;
+  reverse_ = direction == "reverse";
+
+  auto dimsX = parseOnnxInputSizes(n, kInputX);
+  auto dimsR = parseOnnxInputSizes(n, kInputR);
+  if (dimsX.size() != 3 || dimsR.size() != 3) {  // TODO: ENFORCE
+    throw std::runtime_error("Invalid shapes of recurrent inputs");
+  }
+  sequence_length_ = dimsX[0];
+  batch_size_ = dimsX[1];
+  hidden_size_ = dimsR[2];
+  if (n.hasAttribute(Symbol("hidden_size")) &&
+      n.i(Symbol("hidden_size")) != hidden_size_) {  // TODO: ENFORCE
+    throw std::runtime_error("hidden_size does not match R");
+  }
+  data_type_ = onnxToPrimitive(n.inputs().at(kInputX)->elemType());
+  has_clip_ = n.hasAttribute(Symbol("clip"));
+  clip_ = has_clip_ ? n.f(Symbol("clip")) : 0.0f;
+
+  // Functions taking alpha and beta consume activation_alpha and
+  // activation_beta in order, falling back to the ONNX defaults
+  std::vector<std::string> names;
+  if (n.hasAttribute(Symbol("activations"))) {
+    names = n.ss(Symbol("activations"));
+  } else {
+    for (auto d = 0; d < num_directions_; ++d) {
+      names.insert(names.end(), defaultActivations.begin(),
+                   defaultActivations.end());
+    }
+  }
+  if (names.size() != defaultActivations.size() * num_directions_) {
+    throw std::runtime_error("Invalid number of activations");
+  }
+  std::vector<double> alphas;
+  std::vector<double> betas;
+  if (n.hasAttribute(Symbol("activation_alpha"))) {
+    alphas = n.fs(Symbol("activation_alpha"));
+  }
+  if (n.hasAttribute(Symbol("activation_beta"))) {
+    betas = n.fs(Symbol("activation_beta"));
+  }
+  size_t nextAlpha = 0;
+  size_t nextBeta = 0;
+  for (const auto& name : names) {
+    Activation activation{name, 0.0f, 0.0f};
+    bool hasAlpha = true;
+    bool hasBeta = true;
+    if (name == "HardSigmoid") {
+      activation.alpha = 0.2f;
+      activation.beta = 0.5f;
+    } else if (name == "LeakyRelu") {
+      activation.alpha = 0.01f;
+      hasBeta = false;
+    } else if (name == "Affine" || name == "ScaledTanh") {
+      activation.alpha = 1.0f;
+      activation.beta = name == "Affine" ? 0.0f : 1.0f;
+    } else if (name == "Sigmoid" || name == "Tanh" || name == "Relu") {
+      hasAlpha = false;
+      hasBeta = false;
+    } else {  // TODO: ENFORCE
+      throw std::runtime_error("Unsupported activation " + name);
+    }
+    if (hasAlpha && nextAlpha < alphas.size()) {
+      activation.alpha = alphas[nextAlpha++];
+    }
+    if (hasBeta && nextBeta < betas.size()) {
+      activation.beta = betas[nextBeta++];
+    }
+    activations_.push_back(activation);
+  }
+}
+
+int64 RecurrentHelper::numDirections() const {
+  return num_directions_;
+}
+
+int64 RecurrentHelper::hiddenSize() const {
+  return hidden_size_;
+}
+
+PrimitiveType RecurrentHelper::dataType() const {
+  return data_type_;
+}
+
+bool RecurrentHelper::hasInput(size_t i) const {
+  return i < n_.inputs().size() && !isMissingOptional(n_.inputs().at(i));
+}
+
+XlaOp RecurrentHelper::directionSlice(XlaBuilder& builder,
+                                      size_t i,
+                                      int64 direction) const {
+  auto dims = parseOnnxInputSizes(n_, i);
+  std::vector<int64> sliceDims(dims.begin() + 1, dims.end());
+  return builder.Reshape(
+      builder.SliceInDim(value_to_op_.at(n_.inputs().at(i)), direction,
+                         direction + 1, 1, 0),
+      sliceDims);
+}
+
+XlaOp RecurrentHelper::initialState(XlaBuilder& builder,
+                                    size_t i,
+                                    int64 direction) const {
+  if (hasInput(i)) {
+    return directionSlice(builder, i, direction);
+  }
+  return builder.Broadcast(builder.ConstantLiteral(Literal::Zero(data_type_)),
+                           {batch_size_, hidden_size_});
+}
+
+XlaOp RecurrentHelper::inputProjections(
+    XlaBuilder& builder,
+    int64 direction,
+    const std::vector<XlaOp>& biases) const {
+  ::xla::DotDimensionNumbers dnums;
+  dnums.add_lhs_contracting_dimensions(2);
+  dnums.add_rhs_contracting_dimensions(1);
+  auto projectionsOp =
+      builder.DotGeneral(value_to_op_.at(n_.inputs().at(kInputX)),
+                         directionSlice(builder, kInputW, direction), dnums);
+  for (const auto& bias : biases) {
+    projectionsOp = builder.Add(projectionsOp, bias, {2});
+  }
+  return projectionsOp;
+}
+
+XlaOp RecurrentHelper::recurrentProjections(XlaBuilder& b,
+                                            const XlaOp& state,
+                                            const XlaOp& R) {
+  ::xla::DotDimensionNumbers dnums;
+  dnums.add_lhs_contracting_dimensions(1);
+  dnums.add_rhs_contracting_dimensions(1);
+  return b.DotGeneral(state, R, dnums);
+}
+
+XlaOp RecurrentHelper::gate(XlaBuilder& b, const XlaOp& op, int64 i) const {
+  return b.SliceInDim(op, i * hidden_size_, (i + 1) * hidden_size_, 1, 1);
+}
+
+XlaOp RecurrentHelper::activate(XlaBuilder& b,
+                                const XlaOp& op,
+                                int64 direction,
+                                int64 i) const {
+  auto literal = [&](float value) {
+    return ::tensorflow::FloatLiteral(&b, data_type_, value);
+  };
+  auto inputOp = has_clip_ ? b.Clamp(literal(-clip_), op, literal(clip_)) : op;
+  const auto& activation =
+      activations_.at(direction * activations_.size() / num_directions_ + i);
+  const auto& name = activation.name;
+  if (name == "Sigmoid") {
+    // sigmoid(x) = (1 + tanh(x / 2)) / 2, which avoids overflow of exp
+    return b.Add(b.Mul(b.Tanh(b.Mul(inputOp, literal(0.5f))), literal(0.5f)),
+                 literal(0.5f));
+  } else if (name == "Tanh") {
+    return b.Tanh(inputOp);
+  } else if (name == "Relu") {
+    return b.Max(inputOp, literal(0.0f));
+  } else if (name == "HardSigmoid") {
+    return b.Clamp(literal(0.0f),
+                   b.Add(b.Mul(inputOp, literal(activation.alpha)),
+                         literal(activation.beta)),
+                   literal(1.0f));
+  } else if (name == "LeakyRelu") {
+    return b.Select(b.Ge(inputOp, literal(0.0f)), inputOp,
+                    b.Mul(inputOp, literal(activation.alpha)));
+  } else if (name == "Affine") {
+    return b.Add(b.Mul(inputOp, literal(activation.alpha)),
+                 literal(activation.beta));
+  } else {
+    return b.Mul(b.Tanh(b.Mul(inputOp, literal(activation.beta))),
+                 literal(activation.alpha));
+  }
+}
+
+std::vector<XlaOp> RecurrentHelper::run(XlaBuilder& builder,
+                                        int64 direction,
+                                        const XlaOp& projections,
+                                        const std::vector<XlaOp>& initialStates,
+                                        const std::vector<XlaOp>& weights,
+                                        const Cell& cell) const {
+  bool reverse = reverse_ || direction == 1;
+  bool masked = hasInput(kInputSequenceLens);
+
+  // Loop state: (t, projections, [sequence_lens], weights..., states..., Y)
+  std::vector<XlaOp> initial = {builder.ConstantR0<int64>(0), projections};
+  if (masked) {
+    // Sequence lengths broadcast to [B, H]
+    auto sequenceLensOp = builder.ConvertElementType(
+        value_to_op_.at(n_.inputs().at(kInputSequenceLens)), xla::S64);
+    initial.push_back(builder.Transpose(
+        builder.Broadcast(sequenceLensOp, {hidden_size_}), {1, 0}));
+  }
+  auto weightsOffset = initial.size();
+  initial.insert(initial.end(), weights.begin(), weights.end());
+  auto statesOffset = initial.size();
+  initial.insert(initial.end(), initialStates.begin(), initialStates.end());
+  auto outputIndex = initial.size();
+  initial.push_back(
+      builder.Broadcast(builder.ConstantLiteral(Literal::Zero(data_type_)),
+                        {sequence_length_, batch_size_, hidden_size_}));
+  std::vector<Shape> shapes;
+  for (const auto& op : initial) {
+    shapes.push_back(builder.GetShape(op).ValueOrDie());
+  }
+  auto stateShape = ShapeUtil::MakeTupleShape(shapes);
+
+  auto bodyBuilder = builder.CreateSubBuilder("recurrence_body");
+  {
+    auto& b = *bodyBuilder;
+    auto parameterOp = b.Parameter(0, stateShape, "recurrence_state");
+    std::vector<XlaOp> elements;
+    for (auto i = 0; i < shapes.size(); ++i) {
+      elements.push_back(b.GetTupleElement(parameterOp, i));
+    }
+    auto timestepOp =
+        reverse ? b.Sub(b.ConstantR0<int64>(sequence_length_ - 1), elements[0])
+                : elements[0];
+    auto startIndices = leadingStartIndices(b, timestepOp, 3);
+    auto projectionOp = b.Reshape(
+        b.DynamicSlice(elements[1], startIndices,
+                       {1, batch_size_, num_gates_ * hidden_size_}),
+        {batch_size_, num_gates_ * hidden_size_});
+    std::vector<XlaOp> cellWeights(elements.begin() + weightsOffset,
+                                   elements.begin() + statesOffset);
+    std::vector<XlaOp> states(elements.begin() + statesOffset,
+                              elements.begin() + outputIndex);
+    auto newStates = cell(b, projectionOp, states, cellWeights);
+    auto outputOp = newStates.at(0);
+    if (masked) {
+      auto validOp = b.Lt(b.Broadcast(timestepOp, {batch_size_, hidden_size_}),
+                          elements[2]);
+      for (auto i = 0; i < newStates.size(); ++i) {
+        newStates[i] = b.Select(validOp, newStates[i], states[i]);
+      }
+      outputOp = b.Select(
+          validOp, outputOp,
+          b.Broadcast(b.ConstantLiteral(Literal::Zero(data_type_)),
+                      {batch_size_, hidden_size_}));
+    }
+
+    std::vector<XlaOp> root(elements.begin(), elements.begin() + statesOffset);
+    root[0] = b.Add(elements[0], b.ConstantR0<int64>(1));
+    root.insert(root.end(), newStates.begin(), newStates.end());
+    root.push_back(b.DynamicUpdateSlice(
+        elements[outputIndex],
+        b.Reshape(outputOp, {1, batch_size_, hidden_size_}), startIndices));
+    b.Tuple(root);
+  }
+  auto bodyComputation = bodyBuilder->Build().ConsumeValueOrDie();
+
+  auto condBuilder = builder.CreateSubBuilder("recurrence_cond");
+  condBuilder->Lt(condBuilder->GetTupleElement(
+                      condBuilder->Parameter(0, stateShape, "recurrence_state"),
+                      0),
+                  condBuilder->ConstantR0<int64>(sequence_length_));
+  auto condComputation = condBuilder->Build().ConsumeValueOrDie();
+
+  auto loopOp =
+      builder.While(condComputation, bodyComputation, builder.Tuple(initial));
+  std::vector<XlaOp> results = {builder.GetTupleElement(loopOp, outputIndex)};
+  for (auto i = statesOffset; i < outputIndex; ++i) {
+    results.push_back(builder.GetTupleElement(loopOp, i));
+  }
+  return results;
+}
+
+void RecurrentHelper::setOutputs(
+    XlaBuilder& builder,
+    const std::vector<std::vector<XlaOp>>& results,
+    ValueOpMap& valueToOp) const {
+  for (auto i = 0; i < n_.outputs().size(); ++i) {
+    std::vector<XlaOp> perDirection;
+    for (const auto& result : results) {
+      if (i == 0) {
+        perDirection.push_back(builder.Reshape(
+            result.at(0),
+            {sequence_length_, 1, batch_size_, hidden_size_}));
+      } else {
+        perDirection.push_back(builder.Reshape(
+            result.at(i), {1, batch_size_, hidden_size_}));
+      }
+    }
+    valueToOp[n_.outputs().at(i)] =
+        perDirection.size() == 1 ? perDirection[0]
+                                 : builder.ConcatInDim(perDirection,
+                                                       i == 0 ? 1 : 0);
+  }
+}
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "onnx_xla/operator_registry.h"
+
+#include <string>
+
+namespace onnx_xla {
+// Utility class to help translate RNN/GRU/LSTM operators
+// Inputs shared by the three operators are X [T, B, I], W [D, G * H, I],
+// R [D, G * H, H], B [D, 2 * G * H], sequence_lens [B] and initial_h [D, B, H]
+// (T timesteps, batch size B, D directions, G gates and H hidden units).
+//
+// Each direction is run as:
+// 1) The input projections X * W^T (+ biases) of all timesteps, as one
+//    DotGeneral [T, B, G * H] computed before the recurrence
+// 2) A While loop over the timesteps, whose body slices the projections of
+//    timestep t and calls the cell of the operator, which computes the new
+//    states (hidden state first) with one product by R for all gates
+// Timesteps at or past the sequence length of a batch entry keep its states
+// and output zeros, so reverse directions start at the last valid timestep.
+class RecurrentHelper final {
+ public:
+  // Computes the new states from the input projections [B, G * H] of one
+  // timestep, the states and the weights passed to run
+  using Cell = std::function<std::vector<XlaOp>(
+      XlaBuilder& b,
+      const XlaOp& projection,
+      const std::vector<XlaOp>& states,
+      const std::vector<XlaOp>& weights)>;
+
+  // Reads the attributes of n, a node with numGates gates whose activation
+  // functions (per direction) default to defaultActivations. Throws if an
+  // attribute is unsupported.
+  RecurrentHelper(const Node& n,
+                  const ValueOpMap& valueToOp,
+                  int64 numGates,
+                  const std::vector<std::string>& defaultActivations);
+
+  int64 numDirections() const;
+  int64 hiddenSize() const;
+  PrimitiveType dataType() const;
+
+  // Returns true if optional input i is given
+  bool hasInput(size_t i) const;
+
+  // Returns the slice of input i for direction, without the direction
+  // dimension
+  XlaOp directionSlice(XlaBuilder& builder, size_t i, int64 direction) const;
+
+  // Returns the initial state of direction from input i, or zeros if it is
+  // missing [B, H]
+  XlaOp initialState(XlaBuilder& builder, size_t i, int64 direction) const;
+
+  // Returns X * W^T + sum of biases [T, B, G * H] for direction, where each
+  // bias has G * H elements
+  XlaOp inputProjections(XlaBuilder& builder,
+                         int64 direction,
+                         const std::vector<XlaOp>& biases) const;
+
+  // Returns state * R^T [B, G * H], for R [G * H, H]
+  static XlaOp recurrentProjections(XlaBuilder& b,
+                                    const XlaOp& state,
+                                    const XlaOp& R);
+
+  // Returns gate i [B, H] of op [B, G * H]
+  XlaOp gate(XlaBuilder& b, const XlaOp& op, int64 i) const;
+
+  // Applies activation function i of direction, clipping its input if the
+  // clip attribute is set
+  XlaOp activate(XlaBuilder& b,
+                 const XlaOp& op,
+                 int64 direction,
+                 int64 i) const;
+
+  // Runs direction from initialStates, returning Y [T, B, H] followed by the
+  // final states
+  std::vector<XlaOp> run(XlaBuilder& builder,
+                         int64 direction,
+                         const XlaOp& projections,
+                         const std::vector<XlaOp>& initialStates,
+                         const std::vector<XlaOp>& weights,
+                         const Cell& cell) const;
+
+  // Sets the outputs of n from the results of run for each direction:
+  // Y [T, D, B, H] and the final states [D, B, H] (outputs 1, 2, ...)
+  void setOutputs(XlaBuilder& builder,
+                  const std::vector<std::vector<XlaOp>>& results,
+                  ValueOpMap& valueToOp) const;
+
+ private:
+  struct Activation {
+    std::string name;
+    float alpha;
+    float beta;
+  };
+
+  const Node& n_;
+  const ValueOpMap& value_to_op_;
+  int64 num_gates_;
+  int64 num_directions_;
+  bool reverse_;
+  int64 hidden_size_;
+  int64 sequence_length_;
+  int64 batch_size_;
+  PrimitiveType data_type_;
+  bool has_clip_;
+  float clip_;
+  // Activation functions of each direction, in order
+  std::vector<Activation> activations_;
+};
+}
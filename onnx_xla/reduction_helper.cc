@@ -0,0 +1,144 @@
+#include "onnx_xla/reduction_helper.h"
+
+namespace onnx_xla {
+// Reduces input with reducer over the dimensions from first on, to a result
+// broadcastable against input with the returned broadcast dimensions
+static XlaOp reduceTrailing(XlaBuilder& builder,
+                            const XlaOp& input,
+                            const Literal& init,
+                            const XlaComputation& reducer,
+                            int64 first,
+                            ReductionForm form,
+                            std::vector<int64>& broadcastDims) {
+  auto shape = builder.GetShape(input).ValueOrDie();
+  auto rank = ShapeUtil::Rank(shape);
+  broadcastDims.clear();
+  if (form == ReductionForm::kReduceWindow) {
+    std::vector<int64> windowDimensions(first, 1);
+    for (auto i = first; i < rank; ++i) {
+      windowDimensions.push_back(shape.dimensions(i));
+    }
+    return builder.ReduceWindow(input, builder.ConstantLiteral(init), reducer,
+                                windowDimensions,
+                                std::vector<int64>(rank, 1), Padding::kValid);
+  }
+  std::vector<int64> reduceDims;
+  for (auto i = first; i < rank; ++i) {
+    reduceDims.push_back(i);
+  }
+  if (!reduceDims.empty()) {
+    for (auto i = 0; i < first; ++i) {
+      broadcastDims.push_back(i);
+    }
+  }
+  return builder.Reduce(input, builder.ConstantLiteral(init), reducer,
+                        reduceDims);
+}
+
+// Compute Softmax
+// 1) Reduce to the max of each batch (dimensions axis and after)
+// 2) Subtract from current numbers (broadcasting over the batch dimensions)
+// 3) Exponentiate
+// 4) Reduce to the sum of each batch and divide with broadcasting
+XlaOp lowerSoftmax(XlaBuilder& builder,
+                   const XlaOp& input,
+                   int64 axis,
+                   ReductionForm form) {
+  auto dataType = builder.GetShape(input).ValueOrDie().element_type();
+  std::vector<int64> batchDims;
+  auto maxOp = reduceTrailing(builder, input, Literal::MinValue(dataType),
+                              max(dataType), axis, form, batchDims);
+  auto expOp = builder.Exp(builder.Sub(input, maxOp, batchDims));
+  auto sumOp = reduceTrailing(builder, expOp, Literal::Zero(dataType),
+                              add(dataType), axis, form, batchDims);
+  return builder.Div(expOp, sumOp, batchDims);
+}
+
+// Compute GlobalAveragePool
+// 1. Reduce the spatial dimensions with add computation
+// 2. Divide by number of spatial elements
+// 3. Reshape back to rank of input with spatial dimensions of size 1
+XlaOp lowerGlobalAveragePool(XlaBuilder& builder,
+                             const XlaOp& input,
+                             ReductionForm form) {
+  auto shape = builder.GetShape(input).ValueOrDie();
+  auto dataType = shape.element_type();
+  auto rank = ShapeUtil::Rank(shape);
+  int64 numSpatialElements = 1;
+  for (auto i = 2; i < rank; ++i) {
+    numSpatialElements *= shape.dimensions(i);
+  }
+  std::vector<int64> broadcastDims;
+  auto poolOp = builder.Div(
+      reduceTrailing(builder, input, Literal::Zero(dataType), add(dataType),
+                     2, form, broadcastDims),
+      ::tensorflow::FloatLiteral(&builder, dataType, numSpatialElements));
+  if (form == ReductionForm::kReduceWindow) {
+    return poolOp;
+  }
+  std::vector<int64> outputSizes = {shape.dimensions(0), shape.dimensions(1)};
+  outputSizes.insert(outputSizes.end(), rank - 2, 1);
+  return builder.Reshape(poolOp, outputSizes);
+}
+
+// Translate LRN
+// 1. Sum the squares of each window of channels
+// 2. Scale by alpha / size (folded on the host), add bias
+// 3. Normalize the input by the result raised to beta
+// Note: windows are padded as kSame pads, 1 more in the higher values of a
+// dimension when the padding is odd (which corresponds to ONNX LRN operator
+// definition)
+// The ReduceWindow forms square the input before the windowed sum:
+// ReduceWindow takes one operand and a reducer that also combines partial
+// sums, so the square cannot be moved into the reducer
+XlaOp lowerLRN(XlaBuilder& builder,
+               const XlaOp& input,
+               float alpha,
+               float beta,
+               float bias,
+               int64 size,
+               LRNForm form) {
+  auto shape = builder.GetShape(input).ValueOrDie();
+  auto dataType = shape.element_type();
+  auto rank = ShapeUtil::Rank(shape);
+  auto zeroOp = builder.ConstantLiteral(Literal::Zero(dataType));
+
+  XlaOp sumSquaresOp;
+  if (form == LRNForm::kSlicedSum) {
+    xla::PaddingConfig paddingConfig;
+    for (auto i = 0; i < rank; ++i) {
+      auto dimension = paddingConfig.add_dimensions();
+      dimension->set_edge_padding_low(i == 1 ? (size - 1) / 2 : 0);
+      dimension->set_edge_padding_high(i == 1 ? size / 2 : 0);
+      dimension->set_interior_padding(0);
+    }
+    auto paddedOp = builder.Pad(input, zeroOp, paddingConfig);
+    auto channels = shape.dimensions(1);
+    for (int64 k = 0; k < size; ++k) {
+      auto sliceOp = builder.SliceInDim(paddedOp, k, k + channels, 1, 1);
+      auto squareOp = builder.Mul(sliceOp, sliceOp);
+      sumSquaresOp = k == 0 ? squareOp : builder.Add(sumSquaresOp, squareOp);
+    }
+  } else {
+    // ReduceWindow takes one operand and a reducer that also combines partial
+    // sums, so the square cannot be moved into the reducer
+    std::vector<int64> windowDimensions(rank, 1);
+    windowDimensions.at(1) = size;
+    sumSquaresOp = builder.ReduceWindow(
+        builder.Mul(input, input), zeroOp, add(dataType), windowDimensions,
+        std::vector<int64>(rank, 1), Padding::kSame);
+  }
+
+  auto scaleOp =
+      ::tensorflow::FloatLiteral(&builder, dataType, alpha / (float)size);
+  auto biasOp = ::tensorflow::FloatLiteral(&builder, dataType, bias);
+  auto baseOp = builder.Add(biasOp, builder.Mul(scaleOp, sumSquaresOp));
+  if (form == LRNForm::kDividePower) {
+    auto betaOp = ::tensorflow::FloatLiteral(&builder, dataType, beta);
+    return builder.Div(input, builder.Pow(baseOp, betaOp));
+  }
+  // Multiply by the negative power instead of dividing by the positive one
+  auto negativeBetaOp = ::tensorflow::FloatLiteral(&builder, dataType, -beta);
+  return builder.Mul(input, builder.Pow(baseOp, negativeBetaOp));
+}
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "onnx_xla/operator_registry.h"
+
+namespace onnx_xla {
+// Lowerings of the operators reducing whole dimensions or windows of channels
+// (Softmax, GlobalAveragePool, LRN). Each registered translator variant of
+// these operators calls one of them, and bin/lowering_benchmark times them
+// against each other.
+
+// How a reduction over whole dimensions is expressed
+enum class ReductionForm {
+  // Reduce over the dimensions, broadcasting the result back
+  kReduce,
+  // ReduceWindow with a window covering the dimensions, which keeps the rank
+  kReduceWindow
+};
+
+// How LRN sums the squares of each window of channels and normalizes
+enum class LRNForm {
+  // ReduceWindow over the squared input, then multiply the input by
+  // (bias + alpha / size * sum) ^ -beta
+  kNegativePower,
+  // ReduceWindow over the squared input, then divide the input by
+  // (bias + alpha / size * sum) ^ beta
+  kDividePower,
+  // Sum the squares of size shifted slices of the channel padded input, which
+  // fuse into one loop without materializing the squared input, then as
+  // kNegativePower
+  kSlicedSum
+};
+
+// Returns Softmax of input over dimensions axis and after
+XlaOp lowerSoftmax(XlaBuilder& builder,
+                   const XlaOp& input,
+                   int64 axis,
+                   ReductionForm form);
+
+// Returns GlobalAveragePool of the NC... input, of sizes [N, C, 1, ...]
+XlaOp lowerGlobalAveragePool(XlaBuilder& builder,
+                             const XlaOp& input,
+                             ReductionForm form);
+
+// Returns LRN of the NC... input over windows of size channels
+XlaOp lowerLRN(XlaBuilder& builder,
+               const XlaOp& input,
+               float alpha,
+               float beta,
+               float bias,
+               int64 size,
+               LRNForm form);
+}
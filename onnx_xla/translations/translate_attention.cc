@@ -0,0 +1,98 @@
+#include "onnx_xla/operator_registry.h"
+
+namespace onnx_xla {
+// Translate Attention (created by the fuse_patterns pass) with inputs
+// Q [..., Sq, d], K [..., Sk, d] (or K^T [..., d, Sk] if key_transposed),
+// V [..., Sk, dv] and an optional mask broadcastable to [..., Sq, Sk]
+// 1) Scale Q (Sq * d multiplications instead of Sq * Sk)
+// 2) Scores Q * K^T as a DotGeneral contracting d, with the leading dimensions
+//    as batch dimensions (K is never transposed)
+// 3) Add the mask, broadcasting only the dimensions where it has size 1
+// 4) Softmax over the last axis, as reductions over that axis
+// 5) Product by V as a DotGeneral with the same batch dimensions
+onnxStatus translateAttention(const Node& n,
+                              XlaBuilder& builder,
+                              ValueOpMap& valueToOp,
+                              const ValueLiteralMap& valueToLiteral) {
+  auto queryOp = valueToOp.at(n.inputs().at(0));
+  auto keyOp = valueToOp.at(n.inputs().at(1));
+  auto valueOp = valueToOp.at(n.inputs().at(2));
+  auto dataType = onnxToPrimitive(n.inputs().at(0)->elemType());
+  auto querySizes = parseOnnxInputSizes(n, 0);
+  auto keySizes = parseOnnxInputSizes(n, 1);
+  int64 rank = querySizes.size();
+  bool keyTransposed = n.i(Symbol("key_transposed")) != 0;
+  auto scoreSizes = querySizes;
+  scoreSizes.back() = keyTransposed ? keySizes.back() : keySizes[rank - 2];
+
+  auto scale = n.f(Symbol("scale"));
+  if (scale != 1.0) {
+    queryOp = builder.Mul(
+        queryOp, ::tensorflow::FloatLiteral(&builder, dataType, scale));
+  }
+  ::xla::DotDimensionNumbers scoreDnums;
+  ::xla::DotDimensionNumbers outputDnums;
+  std::vector<int64> batchDims;
+  for (auto i = 0; i < rank - 2; ++i) {
+    scoreDnums.add_lhs_batch_dimensions(i);
+    scoreDnums.add_rhs_batch_dimensions(i);
+    outputDnums.add_lhs_batch_dimensions(i);
+    outputDnums.add_rhs_batch_dimensions(i);
+  }
+  for (auto i = 0; i < rank - 1; ++i) {
+    batchDims.push_back(i);
+  }
+  scoreDnums.add_lhs_contracting_dimensions(rank - 1);
+  scoreDnums.add_rhs_contracting_dimensions(keyTransposed ? rank - 2
+                                                          : rank - 1);
+  auto scoresOp = builder.DotGeneral(queryOp, keyOp, scoreDnums);
+
+  if (n.inputs().size() > 3) {
+    // Drop the size 1 dimensions of the mask that are broadcast, and map the
+    // others to the dimensions of the scores
+    auto maskSizes = parseOnnxInputSizes(n, 3);
+    if (maskSizes.size() > rank) {  // TODO: ENFORCE
+      std::cerr << "Mask has a higher rank than the scores" << std::endl;
+      return ONNXIFI_STATUS_INVALID_MODEL;
+    }
+    auto offset = rank - (int64)maskSizes.size();
+    std::vector<int64> keptSizes;
+    std::vector<int64> keptDims;
+    for (auto i = 0; i < maskSizes.size(); ++i) {
+      if (maskSizes[i] == scoreSizes[offset + i]) {
+        keptSizes.push_back(maskSizes[i]);
+        keptDims.push_back(offset + i);
+      } else if (maskSizes[i] != 1) {  // TODO: ENFORCE
+        std::cerr << "Mask is not broadcastable to the scores" << std::endl;
+        return ONNXIFI_STATUS_INVALID_MODEL;
+      }
+    }
+    scoresOp = builder.Add(
+        scoresOp, builder.Reshape(valueToOp.at(n.inputs().at(3)), keptSizes),
+        keptDims);
+  }
+
+  auto maxOp = builder.Reduce(
+      scoresOp, builder.ConstantLiteral(Literal::MinValue(dataType)),
+      max(dataType), {rank - 1});
+  auto expOp = builder.Exp(builder.Sub(scoresOp, maxOp, batchDims));
+  auto sumOp =
+      builder.Reduce(expOp, builder.ConstantLiteral(Literal::Zero(dataType)),
+                     add(dataType), {rank - 1});
+  auto probabilitiesOp = builder.Div(expOp, sumOp, batchDims);
+
+  outputDnums.add_lhs_contracting_dimensions(rank - 1);
+  outputDnums.add_rhs_contracting_dimensions(rank - 2);
+  valueToOp[n.outputs().at(0)] =
+      builder.DotGeneral(probabilitiesOp, valueOp, outputDnums);
+  return ONNXIFI_STATUS_SUCCESS;
+}
+REGISTER_OPERATOR_TRANSLATOR_VARIANT(kOnnxXlaDomain,
+                                     Attention,
+                                     1,
+                                     kMaxOpsetVersion,
+                                     0,
+                                     default,
+                                     nullptr,
+                                     translateAttention)
+}
@@ -1,8 +1,60 @@
 #include "onnx_xla/operator_registry.h"
 #include "onnx_xla/conv_pool_helper.h"
 
+#include <map>
+#include <mutex>
+#include <tuple>
+
 namespace onnx_xla {
 
+namespace {
+// (input size, window, stride, low padding, high padding) of a single axis
+using AxisWindowKey = std::tuple<int64, int64, int64, int64, int64>;
+
+// Axis geometries cached at most: the cache is cleared when full, so a long
+// lived backend building many distinct shapes does not grow it without bound
+constexpr size_t kMaxCachedAxes = 256;
+
+// Returns the reciprocal of the number of non-padding elements covered by each
+// output window along one axis. A pooling window is a box, so the count for a
+// full window position is the product of the per-axis counts. Results are
+// cached per axis geometry, which also covers every (input shape, window,
+// stride, pads) combination built from the same axes. They are double, to be
+// converted once to the element type of the pooled tensor.
+std::vector<double> reciprocalWindowCounts(int64 inputSize,
+                                           int64 window,
+                                           int64 stride,
+                                           int64 padLow,
+                                           int64 padHigh) {
+  static std::map<AxisWindowKey, std::vector<double>> cache;
+  static std::mutex cacheMutex;
+  std::lock_guard<std::mutex> lock(cacheMutex);
+
+  auto key = std::make_tuple(inputSize, window, stride, padLow, padHigh);
+  auto it = cache.find(key);
+  if (it != cache.end()) {
+    return it->second;
+  }
+
+  std::vector<double> reciprocals;
+  auto outputSize = (inputSize + padLow + padHigh - window) / stride + 1;
+  for (int64 i = 0; i < outputSize; ++i) {
+    auto start = i * stride - padLow;
+    auto end = start + window;
+    auto count = std::min(end, inputSize) - std::max(start, (int64)0);
+    if (count <= 0) {  // TODO: ENFORCE
+      throw std::runtime_error("AveragePool window only covers padding");
+    }
+    reciprocals.push_back(1.0 / count);
+  }
+  if (cache.size() >= kMaxCachedAxes) {
+    cache.clear();
+  }
+  cache.emplace(key, reciprocals);
+  return reciprocals;
+}
+}
+
 onnxStatus translateAveragePool(const Node& n,
                                 XlaBuilder& builder,
                                 ValueOpMap& valueToOp,
@@ -13,45 +65,58 @@ onnxStatus translateAveragePool(const Node& n,
   // Create ConvPoolHelper object (constructs attributes formatted for
   // XlaBuilder)
   ConvPoolHelper helper(n);
+  const auto& windowDimensions = helper.getWindowDimensions();
+  const auto& windowStrides = helper.getWindowStrides();
+  const auto& inputPadding = helper.getInputPadding();
 
   // Enque a sum Xla operation
-  XlaOp sumOp = builder.ReduceWindowWithGeneralPadding(
+  XlaOp averageOp = builder.ReduceWindowWithGeneralPadding(
       valueToOp.at(n.inputs().at(0)),
       builder.ConstantLiteral(Literal::Zero(dataType)), add(dataType),
-      helper.getWindowDimensions(), helper.getWindowStrides(),
-      helper.getInputPadding());
+      windowDimensions, windowStrides, inputPadding);
 
-  // Build up divisor
-  XlaOp divisorOp;
   auto kcount_include_pad = Symbol("count_include_pad");
-  if (!n.hasAttribute(kcount_include_pad) || n.i(kcount_include_pad) == 0) {
-    // To not include pads, send computation to XLA to calculate a literal
-    // of the windowSizes
-    XlaBuilder windowBuilder("windowBuilder");
+  bool includePad =
+      n.hasAttribute(kcount_include_pad) && n.i(kcount_include_pad) != 0;
+  if (!includePad) {
+    // To not include pads, scale by the per-axis reciprocal window counts,
+    // computed on the host. Each factor is a small R1 constant broadcast along
+    // its axis, so no full-size divisor is embedded in the computation.
     std::vector<int64_t> inputSizes = parseOnnxInputSizes(n, 0);
-    std::vector<int64> onesSizes(inputSizes.begin(), inputSizes.end());
-    auto ones = windowBuilder.Broadcast(
-        ::tensorflow::FloatLiteral(&windowBuilder, dataType, 1.), onesSizes);
-    auto windowSizes = windowBuilder.ReduceWindowWithGeneralPadding(
-        ones, windowBuilder.ConstantLiteral(Literal::Zero(dataType)),
-        add(dataType), helper.getWindowDimensions(), helper.getWindowStrides(),
-        helper.getInputPadding());
-    auto windowComputationStatus = windowBuilder.Build();
-    if (!windowComputationStatus.ok()) {
-      throw std::runtime_error("The computation to find window sizes failed.");
+    for (auto axis = 0; axis < windowDimensions.size(); ++axis) {
+      if (inputPadding.at(axis).first == 0 &&
+          inputPadding.at(axis).second == 0) {
+        // Without padding every window along this axis is full; the count
+        // is folded into the scalar below
+        continue;
+      }
+      const auto& reciprocals = reciprocalWindowCounts(
+          inputSizes.at(axis), windowDimensions.at(axis),
+          windowStrides.at(axis), inputPadding.at(axis).first,
+          inputPadding.at(axis).second);
+      // Converted on the host, so that F64 pooling keeps double reciprocals
+      auto reciprocalsLiteral = Literal::CreateR1<double>(reciprocals)
+                                    ->Convert(dataType)
+                                    .ConsumeValueOrDie();
+      averageOp = builder.Mul(
+          averageOp, builder.ConstantLiteral(*reciprocalsLiteral), {axis});
     }
-    auto windowComputation = windowComputationStatus.ConsumeValueOrDie();
-    auto result = xla::ExecuteComputation(windowComputation, {});
-    divisorOp = builder.ConstantLiteral(*result);
-  } else {
-    // Including pads, we just have one scalar XlaOp with the windowSize
-    auto windowSize = std::accumulate(helper.getWindowDimensions().cbegin(),
-                                      helper.getWindowDimensions().cend(), 1L,
-                                      std::multiplies<int64>());
+  }
+
+  // Divide by the window elements of the axes not handled above (all of them
+  // when including pads), with implicit broadcasting
+  int64 windowSize = 1;
+  for (auto axis = 0; axis < windowDimensions.size(); ++axis) {
+    if (includePad || (inputPadding.at(axis).first == 0 &&
+                       inputPadding.at(axis).second == 0)) {
+      windowSize *= windowDimensions.at(axis);
+    }
+  }
+  if (windowSize != 1) {
     auto divisorOp = ::tensorflow::FloatLiteral(&builder, dataType, windowSize);
+    averageOp = builder.Div(averageOp, divisorOp);
   }
-  // Do division, with implicit broadcasting
-  valueToOp[n.outputs().at(0)] = builder.Div(sumOp, divisorOp);
+  valueToOp[n.outputs().at(0)] = averageOp;
   return ONNXIFI_STATUS_SUCCESS;
 }
 REGISTER_OPERATOR_TRANSLATOR(AveragePool, translateAveragePool)
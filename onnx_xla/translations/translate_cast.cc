@@ -0,0 +1,29 @@
+#include "onnx_xla/operator_registry.h"
+
+namespace onnx_xla {
+// Translate Cast (integer to attribute, since opset 6) by converting elements
+// to the target type
+onnxStatus translateCast(const Node& n,
+                         XlaBuilder& builder,
+                         ValueOpMap& valueToOp,
+                         const ValueLiteralMap& valueToLiteral) {
+  try {
+    auto to = onnxToPrimitive(
+        static_cast<ONNX_NAMESPACE::TensorProto_DataType>(n.i(Symbol("to"))));
+    valueToOp[n.outputs().at(0)] =
+        builder.ConvertElementType(valueToOp.at(n.inputs().at(0)), to);
+  } catch (const std::runtime_error& e) {
+    std::cerr << e.what() << std::endl;
+    return ONNXIFI_STATUS_UNSUPPORTED_DATATYPE;
+  }
+  return ONNXIFI_STATUS_SUCCESS;
+}
+REGISTER_OPERATOR_TRANSLATOR_VARIANT("",
+                                     Cast,
+                                     6,
+                                     kMaxOpsetVersion,
+                                     0,
+                                     default,
+                                     nullptr,
+                                     translateCast)
+}
@@ -0,0 +1,20 @@
+#include "onnx_xla/operator_registry.h"
+
+namespace onnx_xla {
+// Translate Constant whose value was computed at build time
+// The literal of the output is in valueToLiteral (constants are created by
+// the graph passes)
+onnxStatus translateConstant(const Node& n,
+                             XlaBuilder& builder,
+                             ValueOpMap& valueToOp,
+                             const ValueLiteralMap& valueToLiteral) {
+  auto literalIt = valueToLiteral.find(n.outputs().at(0));
+  if (literalIt == valueToLiteral.end()) {  // TODO: ENFORCE
+    std::cerr << "Constant value was not computed at build time" << std::endl;
+    return ONNXIFI_STATUS_UNSUPPORTED_OPERATOR;
+  }
+  valueToOp[n.outputs().at(0)] = builder.ConstantLiteral(*literalIt->second);
+  return ONNXIFI_STATUS_SUCCESS;
+}
+REGISTER_OPERATOR_TRANSLATOR(Constant, translateConstant)
+}
@@ -17,55 +17,115 @@ onnxStatus translateConv(const Node& n,
   // Build result of convolution
   XlaOp convOp;
   if (!n.hasAttribute(kgroup) || n.i(kgroup) == 1) {
-    // Enque corresponding Xla operation
-    convOp = builder.ConvGeneralDilated(
-        inputOp, windowOp, helper.getWindowStrides(), helper.getInputPadding(),
-        {}, helper.getWindowDilations(),
-        XlaBuilder::CreateDefaultConvDimensionNumbers(
-            helper.getWindowStrides().size()));
+    convOp = helper.groupedConvolution(builder, inputOp, windowOp, 1, 1, 1);
   } else {
-    const int numGroups = n.i(kgroup);
     std::vector<int64_t> inputDims = parseOnnxInputSizes(n, 0);
     std::vector<int64_t> windowDims = parseOnnxInputSizes(n, 1);
-    if (inputDims.at(1) % numGroups != 0 || windowDims.at(0) % numGroups != 0) {
-      throw std::runtime_error(
-          "Input and kernel channel numbers should be divisible by group "
-          "number");
+    convOp = helper.groupedConvolution(builder, inputOp, windowOp, n.i(kgroup),
+                                       inputDims.at(1), windowDims.at(0));
+  }
+
+  // Add optional bias and finish
+  if (n.inputs().size() == 3 && n.inputs().at(2)->uniqueName() != "") {
+    XlaOp biasOp = valueToOp.at(n.inputs().at(2));
+    convOp = builder.Add(convOp, biasOp, {1});
+  }
+  valueToOp[n.outputs().at(0)] = convOp;
+
+  return ONNXIFI_STATUS_SUCCESS;
+}
+REGISTER_OPERATOR_TRANSLATOR(Conv, translateConv)
+
+// Depthwise Conv (one input and one output channel per group) as a sum over
+// kernel taps of strided input slices scaled per channel, instead of one
+// convolution per channel
+static bool isDepthwiseConv(const Node& n,
+                            const ValueLiteralMap& valueToLiteral) {
+  if (!n.hasAttribute(kgroup) || n.i(kgroup) == 1 ||
+      !n.inputs().at(0)->has_sizes() || !n.inputs().at(1)->has_sizes()) {
+    return false;
+  }
+  for (auto i = 0; i < 2; ++i) {
+    for (const auto& d : n.inputs().at(i)->sizes()) {
+      if (!d.is_int) {
+        return false;
+      }
     }
-    auto inputChannelsPerGroup = inputDims[1] / numGroups;
-    auto outputChannelsPerGroup = windowDims[0] / numGroups;
-    auto inputStartIndex = 0;
-    auto windowStartIndex = 0;
+  }
+  const auto& inputSizes = n.inputs().at(0)->sizes();
+  const auto& windowSizes = n.inputs().at(1)->sizes();
+  return inputSizes.size() == 4 && inputSizes[1].dim == n.i(kgroup) &&
+         windowSizes[0].dim == n.i(kgroup) && windowSizes[1].dim == 1;
+}
 
-    std::vector<XlaOp> convOps;
-    for (auto i = 0; i < numGroups; ++i) {
-      auto inputSliceOp =
-          builder.SliceInDim(inputOp, inputStartIndex,
-                             inputStartIndex + inputChannelsPerGroup, 1, 1);
-      auto windowSliceOp =
-          builder.SliceInDim(windowOp, windowStartIndex,
-                             windowStartIndex + outputChannelsPerGroup, 1, 0);
+onnxStatus translateDepthwiseConv(const Node& n,
+                                  XlaBuilder& builder,
+                                  ValueOpMap& valueToOp,
+                                  const ValueLiteralMap& valueToLiteral) {
+  ConvPoolHelper helper(n);
+  auto inputOp = valueToOp.at(n.inputs().at(0));
+  auto windowOp = valueToOp.at(n.inputs().at(1));
+  std::vector<int64_t> inputDims = parseOnnxInputSizes(n, 0);
+  std::vector<int64_t> windowDims = parseOnnxInputSizes(n, 1);
+  const auto& strides = helper.getWindowStrides();
+  const auto& dilations = helper.getWindowDilations();
+  const auto& padding = helper.getInputPadding();
+  auto dataType = onnxToPrimitive(n.inputs().at(0)->elemType());
 
-      convOps.push_back(builder.ConvGeneralDilated(
-          inputSliceOp, windowSliceOp, helper.getWindowStrides(),
-          helper.getInputPadding(), {}, helper.getWindowDilations(),
-          XlaBuilder::CreateDefaultConvDimensionNumbers(
-              helper.getWindowStrides().size())));
+  // Pad spatial axes
+  xla::PaddingConfig paddingConfig;
+  for (auto i = 0; i < 4; ++i) {
+    auto dimension = paddingConfig.add_dimensions();
+    dimension->set_edge_padding_low(i < 2 ? 0 : padding[i - 2].first);
+    dimension->set_edge_padding_high(i < 2 ? 0 : padding[i - 2].second);
+    dimension->set_interior_padding(0);
+  }
+  auto paddedOp = builder.Pad(
+      inputOp, builder.ConstantLiteral(Literal::Zero(dataType)), paddingConfig);
+  std::vector<int64> outputDims(2);
+  for (auto i = 0; i < 2; ++i) {
+    auto paddedSize = inputDims[i + 2] + padding[i].first + padding[i].second;
+    outputDims[i] =
+        (paddedSize - (windowDims[i + 2] - 1) * dilations[i] - 1) / strides[i] +
+        1;
+  }
 
-      inputStartIndex += inputChannelsPerGroup;
-      windowStartIndex += outputChannelsPerGroup;
+  // Accumulate input slices for each kernel tap
+  XlaOp convOp;
+  bool first = true;
+  for (int64 y = 0; y < windowDims[2]; ++y) {
+    for (int64 x = 0; x < windowDims[3]; ++x) {
+      std::vector<int64> start = {0, 0, y * dilations[0], x * dilations[1]};
+      std::vector<int64> limit = {
+          inputDims[0], inputDims[1],
+          start[2] + (outputDims[0] - 1) * strides[0] + 1,
+          start[3] + (outputDims[1] - 1) * strides[1] + 1};
+      auto sliceOp =
+          builder.Slice(paddedOp, start, limit, {1, 1, strides[0], strides[1]});
+      auto tapOp =
+          builder.Reshape(builder.Slice(windowOp, {0, 0, y, x},
+                                        {windowDims[0], 1, y + 1, x + 1},
+                                        {1, 1, 1, 1}),
+                          {windowDims[0]});
+      auto productOp = builder.Mul(sliceOp, tapOp, {1});
+      convOp = first ? productOp : builder.Add(convOp, productOp);
+      first = false;
     }
-    convOp = builder.ConcatInDim(convOps, 1);
   }
 
-  // Add optional bias and finish
   if (n.inputs().size() == 3 && n.inputs().at(2)->uniqueName() != "") {
     XlaOp biasOp = valueToOp.at(n.inputs().at(2));
     convOp = builder.Add(convOp, biasOp, {1});
   }
   valueToOp[n.outputs().at(0)] = convOp;
-
   return ONNXIFI_STATUS_SUCCESS;
 }
-REGISTER_OPERATOR_TRANSLATOR(Conv, translateConv)
+REGISTER_OPERATOR_TRANSLATOR_VARIANT("",
+                                     Conv,
+                                     1,
+                                     kMaxOpsetVersion,
+                                     1,
+                                     depthwise,
+                                     isDepthwiseConv,
+                                     translateDepthwiseConv)
 }
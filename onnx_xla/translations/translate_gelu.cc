@@ -0,0 +1,29 @@
+#include "onnx_xla/operator_registry.h"
+
+namespace onnx_xla {
+// Translate Gelu (created by the fuse_patterns pass)
+// Y = X * (1 + erf(X / sqrt(2))) / 2, as one elementwise expression
+onnxStatus translateGelu(const Node& n,
+                         XlaBuilder& builder,
+                         ValueOpMap& valueToOp,
+                         const ValueLiteralMap& valueToLiteral) {
+  auto inputOp = valueToOp.at(n.inputs().at(0));
+  auto dataType = onnxToPrimitive(n.inputs().at(0)->elemType());
+  auto literal = [&](float value) {
+    return ::tensorflow::FloatLiteral(&builder, dataType, value);
+  };
+  auto erfOp =
+      erf(builder, builder.Mul(inputOp, literal(std::sqrt(0.5f))), dataType);
+  valueToOp[n.outputs().at(0)] = builder.Mul(
+      builder.Mul(inputOp, literal(0.5f)), builder.Add(erfOp, literal(1.0f)));
+  return ONNXIFI_STATUS_SUCCESS;
+}
+REGISTER_OPERATOR_TRANSLATOR_VARIANT(kOnnxXlaDomain,
+                                     Gelu,
+                                     1,
+                                     kMaxOpsetVersion,
+                                     0,
+                                     default,
+                                     nullptr,
+                                     translateGelu)
+}
@@ -0,0 +1,95 @@
+#include "onnx_xla/recurrent_helper.h"
+
+namespace onnx_xla {
+// Translate GRU (see RecurrentHelper), with gates in the ONNX order z, r, h
+// zt = f(Xt * Wz^T + Ht-1 * Rz^T + Wbz + Rbz)
+// rt = f(Xt * Wr^T + Ht-1 * Rr^T + Wbr + Rbr)
+// ht = g(Xt * Wh^T + (rt . Ht-1) * Rh^T + Rbh + Wbh), or
+//      g(Xt * Wh^T + rt . (Ht-1 * Rh^T + Rbh) + Wbh) if linear_before_reset
+// Ht = (1 - zt) . ht + zt . Ht-1 = ht + zt . (Ht-1 - ht)
+// Biases are folded into the input projections, except Rbh with
+// linear_before_reset. With linear_before_reset the three gates share one
+// product by R; otherwise z and r do, and h needs a second one.
+onnxStatus translateGRU(const Node& n,
+                        XlaBuilder& builder,
+                        ValueOpMap& valueToOp,
+                        const ValueLiteralMap& valueToLiteral) {
+  try {
+    RecurrentHelper helper(n, valueToOp, 3, {"Sigmoid", "Tanh"});
+    auto H = helper.hiddenSize();
+    bool linearBeforeReset = n.hasAttribute(Symbol("linear_before_reset")) &&
+                             n.i(Symbol("linear_before_reset")) != 0;
+    std::vector<std::vector<XlaOp>> results;
+    for (auto d = 0; d < helper.numDirections(); ++d) {
+      auto recurrenceOp = helper.directionSlice(builder, 2, d);
+      std::vector<XlaOp> biases;
+      // Weights: R (or R of z and r, then R of h) and Rbh (with
+      // linear_before_reset)
+      std::vector<XlaOp> weights;
+      if (linearBeforeReset) {
+        weights.push_back(recurrenceOp);
+      } else {
+        weights.push_back(builder.SliceInDim(recurrenceOp, 0, 2 * H, 1, 0));
+        weights.push_back(
+            builder.SliceInDim(recurrenceOp, 2 * H, 3 * H, 1, 0));
+      }
+      if (helper.hasInput(3)) {
+        auto biasOp = helper.directionSlice(builder, 3, d);
+        auto recurrenceBiasOp = builder.SliceInDim(biasOp, 3 * H, 6 * H, 1, 0);
+        if (linearBeforeReset) {
+          weights.push_back(
+              builder.SliceInDim(recurrenceBiasOp, 2 * H, 3 * H, 1, 0));
+          recurrenceBiasOp = builder.ConcatInDim(
+              {builder.SliceInDim(recurrenceBiasOp, 0, 2 * H, 1, 0),
+               builder.Broadcast(builder.ConstantLiteral(
+                                     Literal::Zero(helper.dataType())),
+                                 {H})},
+              0);
+        }
+        biases.push_back(builder.Add(
+            builder.SliceInDim(biasOp, 0, 3 * H, 1, 0), recurrenceBiasOp));
+      }
+      bool hasRecurrenceBias = weights.size() == 2 && linearBeforeReset;
+      auto cell = [&](XlaBuilder& b, const XlaOp& projection,
+                      const std::vector<XlaOp>& states,
+                      const std::vector<XlaOp>& cellWeights) {
+        const auto& hiddenOp = states[0];
+        auto recurrentOp =
+            RecurrentHelper::recurrentProjections(b, hiddenOp, cellWeights[0]);
+        auto zt = helper.activate(
+            b, b.Add(helper.gate(b, projection, 0),
+                     helper.gate(b, recurrentOp, 0)),
+            d, 0);
+        auto rt = helper.activate(
+            b, b.Add(helper.gate(b, projection, 1),
+                     helper.gate(b, recurrentOp, 1)),
+            d, 0);
+        XlaOp resetOp;
+        if (linearBeforeReset) {
+          auto linearOp = helper.gate(b, recurrentOp, 2);
+          if (hasRecurrenceBias) {
+            linearOp = b.Add(linearOp, cellWeights[1], {1});
+          }
+          resetOp = b.Mul(rt, linearOp);
+        } else {
+          resetOp = RecurrentHelper::recurrentProjections(
+              b, b.Mul(rt, hiddenOp), cellWeights[1]);
+        }
+        auto ht = helper.activate(
+            b, b.Add(helper.gate(b, projection, 2), resetOp), d, 1);
+        return std::vector<XlaOp>{
+            b.Add(ht, b.Mul(zt, b.Sub(hiddenOp, ht)))};
+      };
+      results.push_back(helper.run(
+          builder, d, helper.inputProjections(builder, d, biases),
+          {helper.initialState(builder, 5, d)}, weights, cell));
+    }
+    helper.setOutputs(builder, results, valueToOp);
+  } catch (const std::runtime_error& e) {
+    std::cerr << e.what() << std::endl;
+    return ONNXIFI_STATUS_UNSUPPORTED_OPERATOR;
+  }
+  return ONNXIFI_STATUS_SUCCESS;
+}
+REGISTER_OPERATOR_TRANSLATOR(GRU, translateGRU)
+}
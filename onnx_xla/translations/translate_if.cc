@@ -0,0 +1,48 @@
+#include "onnx_xla/control_flow_helper.h"
+
+namespace onnx_xla {
+// Translate If into Conditional
+// 1) Build each branch as a computation taking its captured values as a tuple
+//    and returning the tuple of its outputs
+// 2) Select the branch with the (scalar) condition
+// 3) Extract the outputs from the tuple
+onnxStatus translateIf(const Node& n,
+                       XlaBuilder& builder,
+                       ValueOpMap& valueToOp,
+                       const ValueLiteralMap& valueToLiteral) {
+  auto condOp = builder.Reshape(valueToOp.at(n.inputs().at(0)), {});
+  auto buildBranch = [&](const Symbol& attr, SubgraphTranslator& branch) {
+    // Unused trailing outputs of n may have been removed
+    if (n.g(attr)->outputs().size() < n.outputs().size()) {  // TODO: ENFORCE
+      throw std::runtime_error("If branches must produce every output");
+    }
+    return branch.build(
+        std::string("If_") + attr.toString(), {}, nullptr,
+        [](XlaBuilder& b, const std::vector<XlaOp>& state,
+           const std::vector<XlaOp>& outputs,
+           const std::vector<XlaOp>& captured) { return b.Tuple(outputs); });
+  };
+
+  try {
+    SubgraphTranslator thenBranch(*n.g(kthen_branch),
+                                  capturedInputs(n, kthen_branch), builder,
+                                  valueToOp, valueToLiteral);
+    SubgraphTranslator elseBranch(*n.g(kelse_branch),
+                                  capturedInputs(n, kelse_branch), builder,
+                                  valueToOp, valueToLiteral);
+    auto thenComputation = buildBranch(kthen_branch, thenBranch);
+    auto elseComputation = buildBranch(kelse_branch, elseBranch);
+    auto resultOp = builder.Conditional(
+        condOp, builder.Tuple(thenBranch.capturedOps()), thenComputation,
+        builder.Tuple(elseBranch.capturedOps()), elseComputation);
+    for (auto i = 0; i < n.outputs().size(); ++i) {
+      valueToOp[n.outputs().at(i)] = builder.GetTupleElement(resultOp, i);
+    }
+  } catch (const std::runtime_error& e) {
+    std::cerr << e.what() << std::endl;
+    return ONNXIFI_STATUS_UNSUPPORTED_OPERATOR;
+  }
+  return ONNXIFI_STATUS_SUCCESS;
+}
+REGISTER_OPERATOR_TRANSLATOR(If, translateIf)
+}
@@ -0,0 +1,76 @@
+#include "onnx_xla/operator_registry.h"
+
+namespace onnx_xla {
+// Translate LayerNormalization (created by the fuse_patterns pass) over the
+// dimensions from axis, with optional scale and bias of their sizes
+// 1) Reduce to the mean of each batch (dimensions before axis)
+// 2) Center the input, broadcasting the means over the normalized dimensions
+// 3) Reduce to the variance of each batch and multiply the centered input by
+//    its reciprocal square root (with epsilon added)
+// 4) Scale and add bias, broadcasting over the batch dimensions
+onnxStatus translateLayerNormalization(const Node& n,
+                                       XlaBuilder& builder,
+                                       ValueOpMap& valueToOp,
+                                       const ValueLiteralMap& valueToLiteral) {
+  auto inputOp = valueToOp.at(n.inputs().at(0));
+  auto dataType = onnxToPrimitive(n.inputs().at(0)->elemType());
+  auto sizes = parseOnnxInputSizes(n, 0);
+  int64 rank = sizes.size();
+  auto axis = n.i(kaxis);
+  if (axis < 0 || axis >= rank) {  // TODO: ENFORCE
+    std::cerr << "Invalid axis attribute" << std::endl;
+    return ONNXIFI_STATUS_INVALID_MODEL;
+  }
+
+  std::vector<int64> batchDims;
+  for (auto i = 0; i < axis; ++i) {
+    batchDims.push_back(i);
+  }
+  std::vector<int64> reduceDims;
+  for (auto i = axis; i < rank; ++i) {
+    reduceDims.push_back(i);
+  }
+  auto numElements = std::accumulate(sizes.begin() + axis, sizes.end(),
+                                     (int64)1, std::multiplies<int64>());
+  auto numElementsOp =
+      ::tensorflow::FloatLiteral(&builder, dataType, numElements);
+  auto zeroOp = builder.ConstantLiteral(Literal::Zero(dataType));
+
+  auto meanOp = builder.Div(
+      builder.Reduce(inputOp, zeroOp, add(dataType), reduceDims),
+      numElementsOp);
+  auto centeredOp = builder.Sub(inputOp, meanOp, batchDims);
+  auto varianceOp = builder.Div(
+      builder.Reduce(builder.Mul(centeredOp, centeredOp), zeroOp,
+                     add(dataType), reduceDims),
+      numElementsOp);
+  auto scaleOp = builder.Pow(
+      builder.Add(varianceOp,
+                  ::tensorflow::FloatLiteral(&builder, dataType,
+                                             n.f(kepsilon))),
+      ::tensorflow::FloatLiteral(&builder, dataType, -0.5f));
+  auto outputOp = builder.Mul(centeredOp, scaleOp, batchDims);
+
+  // Scale and bias have the sizes of the last normalized dimensions
+  for (auto i = 1; i < n.inputs().size(); ++i) {
+    auto parameterOp = valueToOp.at(n.inputs().at(i));
+    std::vector<int64> parameterDims;
+    int64 parameterRank = n.inputs().at(i)->sizes().size();
+    for (auto d = rank - parameterRank; d < rank; ++d) {
+      parameterDims.push_back(d);
+    }
+    outputOp = i == 1 ? builder.Mul(outputOp, parameterOp, parameterDims)
+                      : builder.Add(outputOp, parameterOp, parameterDims);
+  }
+  valueToOp[n.outputs().at(0)] = outputOp;
+  return ONNXIFI_STATUS_SUCCESS;
+}
+REGISTER_OPERATOR_TRANSLATOR_VARIANT(kOnnxXlaDomain,
+                                     LayerNormalization,
+                                     1,
+                                     kMaxOpsetVersion,
+                                     0,
+                                     default,
+                                     nullptr,
+                                     translateLayerNormalization)
+}
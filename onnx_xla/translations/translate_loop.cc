@@ -0,0 +1,168 @@
+#include "onnx_xla/control_flow_helper.h"
+#include "onnx_xla/passes/pass_helper.h"
+
+namespace onnx_xla {
+// Reshapes op to the static sizes of v, if they are known (e.g. iteration
+// numbers given as scalars to bodies expecting [1])
+static XlaOp reshapeToValue(XlaBuilder& builder,
+                            const XlaOp& op,
+                            const Value* v) {
+  if (!v->has_sizes()) {
+    return op;
+  }
+  for (const auto& d : v->sizes()) {
+    if (!d.is_int) {
+      return op;
+    }
+  }
+  return builder.Reshape(op, staticSizesOf(v));
+}
+
+// Translate Loop into While
+// The loop state is the tuple
+//   (i, cond, M, carried values..., scan accumulators..., captured values...)
+// 1) The condition computation checks cond and i < M (for those given)
+// 2) The body computation binds i, cond and the carried values to the inputs
+//    of the body, and returns (i + 1, new cond, M, new carried values, scan
+//    accumulators updated at row i, captured values)
+// 3) Outputs are the final carried values and the scan accumulators
+// Scan outputs need a build time constant trip count and no condition, so that
+// accumulators have a static number of rows
+onnxStatus translateLoop(const Node& n,
+                         XlaBuilder& builder,
+                         ValueOpMap& valueToOp,
+                         const ValueLiteralMap& valueToLiteral) {
+  const auto& body = *n.g(kbody);
+  try {
+    auto captured = capturedInputs(n, kbody);
+    const Value* tripCount = n.inputs().at(0);
+    const Value* initialCond = n.inputs().at(1);
+    bool hasTripCount = !isMissingOptional(tripCount);
+    bool hasCond = !isMissingOptional(initialCond);
+    if (!hasTripCount && !hasCond) {  // TODO: ENFORCE
+      std::cerr << "Loop without trip count and condition" << std::endl;
+      return ONNXIFI_STATUS_INVALID_MODEL;
+    }
+    auto numCarried = n.inputs().size() - 2 - captured.size();
+    auto numScan =
+        n.outputs().size() > numCarried ? n.outputs().size() - numCarried : 0;
+    if (body.inputs().size() != numCarried + 2 ||
+        body.outputs().size() < numCarried + 1 + numScan) {  // TODO: ENFORCE
+      std::cerr << "Loop body does not match its carried values" << std::endl;
+      return ONNXIFI_STATUS_INVALID_MODEL;
+    }
+    int64 numIterations = -1;
+    if (numScan > 0) {
+      if (hasCond || !valueToLiteral.count(tripCount)) {
+        std::cerr << "Loop scan outputs need a constant trip count and no "
+                     "condition"
+                  << std::endl;
+        return ONNXIFI_STATUS_UNSUPPORTED_OPERATOR;
+      }
+      numIterations = valueToLiteral.at(tripCount)
+                          ->Convert(xla::S64)
+                          .ConsumeValueOrDie()
+                          ->data<int64>()[0];
+    }
+
+    // Initial state
+    std::vector<XlaOp> initialState;
+    initialState.push_back(builder.ConstantR0<int64>(0));
+    initialState.push_back(
+        hasCond ? builder.ConvertElementType(
+                      builder.Reshape(valueToOp.at(initialCond), {}), xla::PRED)
+                : builder.ConstantR0<bool>(true));
+    initialState.push_back(
+        hasTripCount ? builder.ConvertElementType(
+                           builder.Reshape(valueToOp.at(tripCount), {}),
+                           xla::S64)
+                     : builder.ConstantR0<int64>(0));
+    for (auto i = 0; i < numCarried; ++i) {
+      initialState.push_back(valueToOp.at(n.inputs().at(2 + i)));
+    }
+    for (auto k = 0; k < numScan; ++k) {
+      const Value* scanOutput = body.outputs().at(1 + numCarried + k);
+      std::vector<int64> sizes = staticSizesOf(scanOutput);
+      sizes.insert(sizes.begin(), numIterations);
+      initialState.push_back(builder.Broadcast(
+          builder.ConvertElementType(builder.ConstantR0<int32_t>(0),
+                                     onnxToPrimitive(scanOutput->elemType())),
+          sizes));
+    }
+    std::vector<Shape> stateShapes;
+    for (const auto& op : initialState) {
+      stateShapes.push_back(builder.GetShape(op).ValueOrDie());
+    }
+
+    SubgraphTranslator bodyTranslator(body, captured, builder, valueToOp,
+                                      valueToLiteral);
+    auto bodyComputation = bodyTranslator.build(
+        "Loop_body", stateShapes,
+        [&](XlaBuilder& b, const std::vector<XlaOp>& state,
+            ValueOpMap& bodyValueToOp) {
+          bodyValueToOp[body.inputs().at(0)] =
+              reshapeToValue(b, state[0], body.inputs().at(0));
+          bodyValueToOp[body.inputs().at(1)] =
+              reshapeToValue(b, state[1], body.inputs().at(1));
+          for (auto i = 0; i < numCarried; ++i) {
+            bodyValueToOp[body.inputs().at(2 + i)] = state[3 + i];
+          }
+        },
+        [&](XlaBuilder& b, const std::vector<XlaOp>& state,
+            const std::vector<XlaOp>& outputs,
+            const std::vector<XlaOp>& capturedOps) {
+          std::vector<XlaOp> root;
+          root.push_back(b.Add(state[0], b.ConstantR0<int64>(1)));
+          root.push_back(
+              hasCond ? b.ConvertElementType(b.Reshape(outputs[0], {}),
+                                             xla::PRED)
+                      : b.ConstantR0<bool>(true));
+          root.push_back(state[2]);
+          for (auto i = 0; i < numCarried; ++i) {
+            root.push_back(outputs[1 + i]);
+          }
+          for (auto k = 0; k < numScan; ++k) {
+            auto sizes = staticSizesOf(body.outputs().at(1 + numCarried + k));
+            sizes.insert(sizes.begin(), 1);
+            root.push_back(b.DynamicUpdateSlice(
+                state[3 + numCarried + k],
+                b.Reshape(outputs[1 + numCarried + k], sizes),
+                leadingStartIndices(b, state[0], sizes.size())));
+          }
+          root.insert(root.end(), capturedOps.begin(), capturedOps.end());
+          return b.Tuple(root);
+        });
+
+    // Condition: cond && i < M, for those given
+    std::vector<Shape> parameterShapes(stateShapes);
+    parameterShapes.insert(parameterShapes.end(),
+                           bodyTranslator.capturedShapes().begin(),
+                           bodyTranslator.capturedShapes().end());
+    auto condBuilder = builder.CreateSubBuilder("Loop_cond");
+    auto parameterOp = condBuilder->Parameter(
+        0, ShapeUtil::MakeTupleShape(parameterShapes), "Loop_cond_parameter");
+    auto continueOp = condBuilder->GetTupleElement(parameterOp, 1);
+    if (hasTripCount) {
+      continueOp = condBuilder->And(
+          continueOp, condBuilder->Lt(
+                          condBuilder->GetTupleElement(parameterOp, 0),
+                          condBuilder->GetTupleElement(parameterOp, 2)));
+    }
+    auto condComputation = condBuilder->Build().ConsumeValueOrDie();
+
+    initialState.insert(initialState.end(),
+                        bodyTranslator.capturedOps().begin(),
+                        bodyTranslator.capturedOps().end());
+    auto loopOp = builder.While(condComputation, bodyComputation,
+                                builder.Tuple(initialState));
+    for (auto i = 0; i < n.outputs().size(); ++i) {
+      valueToOp[n.outputs().at(i)] = builder.GetTupleElement(loopOp, 3 + i);
+    }
+  } catch (const std::runtime_error& e) {
+    std::cerr << e.what() << std::endl;
+    return ONNXIFI_STATUS_UNSUPPORTED_OPERATOR;
+  }
+  return ONNXIFI_STATUS_SUCCESS;
+}
+REGISTER_OPERATOR_TRANSLATOR(Loop, translateLoop)
+}
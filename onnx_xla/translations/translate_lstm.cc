@@ -0,0 +1,88 @@
+#include "onnx_xla/recurrent_helper.h"
+
+namespace onnx_xla {
+// Translate LSTM (see RecurrentHelper), with gates in the ONNX order i, o, f, c
+// it = f(Xt * Wi^T + Ht-1 * Ri^T + Pi . Ct-1 + Wbi + Rbi)
+// ft = f(Xt * Wf^T + Ht-1 * Rf^T + Pf . Ct-1 + Wbf + Rbf), or 1 - it if
+//      input_forget is set
+// ct = g(Xt * Wc^T + Ht-1 * Rc^T + Wbc + Rbc)
+// Ct = ft . Ct-1 + it . ct
+// ot = f(Xt * Wo^T + Ht-1 * Ro^T + Po . Ct + Wbo + Rbo)
+// Ht = ot . h(Ct)
+// Both biases are folded into the input projections, and the four gates share
+// one product by R per timestep
+onnxStatus translateLSTM(const Node& n,
+                         XlaBuilder& builder,
+                         ValueOpMap& valueToOp,
+                         const ValueLiteralMap& valueToLiteral) {
+  try {
+    RecurrentHelper helper(n, valueToOp, 4, {"Sigmoid", "Tanh", "Tanh"});
+    auto H = helper.hiddenSize();
+    bool inputForget = n.hasAttribute(Symbol("input_forget")) &&
+                       n.i(Symbol("input_forget")) != 0;
+    bool peephole = helper.hasInput(7);
+    std::vector<std::vector<XlaOp>> results;
+    for (auto d = 0; d < helper.numDirections(); ++d) {
+      std::vector<XlaOp> biases;
+      if (helper.hasInput(3)) {
+        auto biasOp = helper.directionSlice(builder, 3, d);
+        biases.push_back(
+            builder.Add(builder.SliceInDim(biasOp, 0, 4 * H, 1, 0),
+                        builder.SliceInDim(biasOp, 4 * H, 8 * H, 1, 0)));
+      }
+      // Weights: R, then the peepholes Pi, Po, Pf
+      std::vector<XlaOp> weights = {helper.directionSlice(builder, 2, d)};
+      if (peephole) {
+        auto peepholeOp = helper.directionSlice(builder, 7, d);
+        for (auto i = 0; i < 3; ++i) {
+          weights.push_back(
+              builder.SliceInDim(peepholeOp, i * H, (i + 1) * H, 1, 0));
+        }
+      }
+      auto cell = [&](XlaBuilder& b, const XlaOp& projection,
+                      const std::vector<XlaOp>& states,
+                      const std::vector<XlaOp>& cellWeights) {
+        const auto& hiddenOp = states[0];
+        const auto& cellOp = states[1];
+        auto gatesOp = b.Add(projection, RecurrentHelper::recurrentProjections(
+                                             b, hiddenOp, cellWeights[0]));
+        auto inputGateOp = helper.gate(b, gatesOp, 0);
+        auto outputGateOp = helper.gate(b, gatesOp, 1);
+        auto forgetGateOp = helper.gate(b, gatesOp, 2);
+        if (peephole) {
+          inputGateOp =
+              b.Add(inputGateOp, b.Mul(cellOp, cellWeights[1], {1}));
+          forgetGateOp =
+              b.Add(forgetGateOp, b.Mul(cellOp, cellWeights[3], {1}));
+        }
+        auto it = helper.activate(b, inputGateOp, d, 0);
+        auto ft = inputForget
+                      ? b.Sub(::tensorflow::FloatLiteral(&b, helper.dataType(),
+                                                         1.0f),
+                              it)
+                      : helper.activate(b, forgetGateOp, d, 0);
+        auto ct = helper.activate(b, helper.gate(b, gatesOp, 3), d, 1);
+        auto newCellOp = b.Add(b.Mul(ft, cellOp), b.Mul(it, ct));
+        if (peephole) {
+          outputGateOp =
+              b.Add(outputGateOp, b.Mul(newCellOp, cellWeights[2], {1}));
+        }
+        auto ot = helper.activate(b, outputGateOp, d, 0);
+        auto newHiddenOp = b.Mul(ot, helper.activate(b, newCellOp, d, 2));
+        return std::vector<XlaOp>{newHiddenOp, newCellOp};
+      };
+      results.push_back(helper.run(
+          builder, d, helper.inputProjections(builder, d, biases),
+          {helper.initialState(builder, 5, d),
+           helper.initialState(builder, 6, d)},
+          weights, cell));
+    }
+    helper.setOutputs(builder, results, valueToOp);
+  } catch (const std::runtime_error& e) {
+    std::cerr << e.what() << std::endl;
+    return ONNXIFI_STATUS_UNSUPPORTED_OPERATOR;
+  }
+  return ONNXIFI_STATUS_SUCCESS;
+}
+REGISTER_OPERATOR_TRANSLATOR(LSTM, translateLSTM)
+}
@@ -0,0 +1,142 @@
+#include "onnx_xla/operator_registry.h"
+
+namespace onnx_xla {
+// Broadcasts the batch dimensions (all but the last two) of op from opBatch to
+// batch, where opBatch is unidirectionally broadcastable to batch:
+// 1) Reshape away the batch dimensions that are missing or of size 1
+// 2) Broadcast, which prepends the broadcast dimensions
+// 3) Transpose the prepended dimensions into place
+static XlaOp broadcastBatch(XlaBuilder& builder,
+                            const XlaOp& op,
+                            const std::vector<int64>& opBatch,
+                            const std::vector<int64>& batch,
+                            const std::vector<int64>& matrixDims) {
+  if (opBatch == batch) {
+    return op;
+  }
+  auto offset = batch.size() - opBatch.size();
+  std::vector<int64> keptSizes;
+  std::vector<int64> broadcastSizes;
+  // Position of each batch dimension after Broadcast, before Transpose
+  std::vector<bool> kept(batch.size());
+  for (auto i = 0; i < batch.size(); ++i) {
+    kept[i] = i >= offset && opBatch[i - offset] == batch[i];
+    (kept[i] ? keptSizes : broadcastSizes).push_back(batch[i]);
+  }
+  std::vector<int64> reshapedSizes(keptSizes);
+  reshapedSizes.insert(reshapedSizes.end(), matrixDims.begin(),
+                       matrixDims.end());
+  auto broadcastOp =
+      builder.Broadcast(builder.Reshape(op, reshapedSizes), broadcastSizes);
+  if (keptSizes.empty()) {
+    return broadcastOp;
+  }
+  std::vector<int64> permutation;
+  int64 nextBroadcast = 0;
+  int64 nextKept = broadcastSizes.size();
+  for (auto i = 0; i < batch.size(); ++i) {
+    permutation.push_back(kept[i] ? nextKept++ : nextBroadcast++);
+  }
+  for (auto i = 0; i < matrixDims.size(); ++i) {
+    permutation.push_back(batch.size() + i);
+  }
+  return builder.Transpose(broadcastOp, permutation);
+}
+
+// Translate MatMul (numpy matmul semantics)
+// 1) Promote vector operands to matrices
+// 2) If B has no batch dimensions, fold the batch dimensions of A into its
+//    rows and use a single matrix product
+// 3) Otherwise broadcast the batch dimensions of A and B against each other
+//    (only where they differ) and use them as batch dimensions of DotGeneral
+// 4) Remove the dimensions added by promotion
+// TODO: ENFORCE macros
+onnxStatus translateMatMul(const Node& n,
+                           XlaBuilder& builder,
+                           ValueOpMap& valueToOp,
+                           const ValueLiteralMap& valueToLiteral) {
+  if (n.inputs().at(0)->elemType() != n.inputs().at(1)->elemType()) {
+    std::cerr << "Data types of inputs do not match" << std::endl;
+    return ONNXIFI_STATUS_INVALID_MODEL;
+  }
+  auto AOp = valueToOp.at(n.inputs().at(0));
+  auto BOp = valueToOp.at(n.inputs().at(1));
+  std::vector<int64_t> onnxDimsA = parseOnnxInputSizes(n, 0);
+  std::vector<int64_t> onnxDimsB = parseOnnxInputSizes(n, 1);
+  std::vector<int64> dimsA(onnxDimsA.begin(), onnxDimsA.end());
+  std::vector<int64> dimsB(onnxDimsB.begin(), onnxDimsB.end());
+  if (dimsA.empty() || dimsB.empty()) {
+    std::cerr << "Operands to multiply must have at least 1 dimension"
+              << std::endl;
+    return ONNXIFI_STATUS_INVALID_MODEL;
+  }
+
+  // Promote vectors
+  bool vectorA = dimsA.size() == 1;
+  bool vectorB = dimsB.size() == 1;
+  if (vectorA) {
+    dimsA.insert(dimsA.begin(), 1);
+    AOp = builder.Reshape(AOp, dimsA);
+  }
+  if (vectorB) {
+    dimsB.push_back(1);
+    BOp = builder.Reshape(BOp, dimsB);
+  }
+  auto M = dimsA[dimsA.size() - 2];
+  auto K = dimsA.back();
+  auto N = dimsB.back();
+  if (K != dimsB[dimsB.size() - 2]) {
+    std::cerr << "Incompatible dimensions for matrix multiplication"
+              << std::endl;
+    return ONNXIFI_STATUS_INVALID_MODEL;
+  }
+  std::vector<int64> batchA(dimsA.begin(), dimsA.end() - 2);
+  std::vector<int64> batchB(dimsB.begin(), dimsB.end() - 2);
+
+  XlaOp productOp;
+  std::vector<int64> batch;
+  if (batchB.empty()) {
+    // [batch..., M, K] x [K, N] as [batch * M, K] x [K, N]
+    batch = batchA;
+    auto rows = std::accumulate(batchA.begin(), batchA.end(), M,
+                                std::multiplies<int64>());
+    productOp = builder.Dot(builder.Reshape(AOp, {rows, K}), BOp);
+  } else {
+    // Multidirectional broadcast of the batch dimensions
+    auto rank = std::max(batchA.size(), batchB.size());
+    batch.resize(rank);
+    for (auto i = 0; i < rank; ++i) {
+      auto a = i + batchA.size() >= rank ? batchA[i + batchA.size() - rank] : 1;
+      auto b = i + batchB.size() >= rank ? batchB[i + batchB.size() - rank] : 1;
+      if (a != b && a != 1 && b != 1) {
+        std::cerr << "Batch dimensions are not broadcastable" << std::endl;
+        return ONNXIFI_STATUS_INVALID_MODEL;
+      }
+      batch[i] = std::max(a, b);
+    }
+    AOp = broadcastBatch(builder, AOp, batchA, batch, {M, K});
+    BOp = broadcastBatch(builder, BOp, batchB, batch, {K, N});
+
+    ::xla::DotDimensionNumbers dnums;
+    for (auto i = 0; i < rank; ++i) {
+      dnums.add_lhs_batch_dimensions(i);
+      dnums.add_rhs_batch_dimensions(i);
+    }
+    dnums.add_lhs_contracting_dimensions(rank + 1);
+    dnums.add_rhs_contracting_dimensions(rank);
+    productOp = builder.DotGeneral(AOp, BOp, dnums);
+  }
+
+  // Output has dimensions [batch..., M, N] without promoted dimensions
+  std::vector<int64> outputDims(batch);
+  if (!vectorA) {
+    outputDims.push_back(M);
+  }
+  if (!vectorB) {
+    outputDims.push_back(N);
+  }
+  valueToOp[n.outputs().at(0)] = builder.Reshape(productOp, outputDims);
+  return ONNXIFI_STATUS_SUCCESS;
+}
+REGISTER_OPERATOR_TRANSLATOR(MatMul, translateMatMul)
+}
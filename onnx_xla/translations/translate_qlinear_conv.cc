@@ -0,0 +1,58 @@
+#include "onnx_xla/conv_pool_helper.h"
+#include "onnx_xla/quantization_helper.h"
+
+namespace onnx_xla {
+// Translate QLinearConv
+// 1) Subtract the zero points in int32 (w per output channel or per tensor)
+// 2) Convolve with int32 accumulation and add the optional int32 bias, which
+//    is quantized with scale x_scale * w_scale and zero point 0
+// 3) Requantize: scale the accumulators by x_scale * w_scale, then quantize
+//    with y_scale and y_zero_point
+onnxStatus translateQLinearConv(const Node& n,
+                                XlaBuilder& builder,
+                                ValueOpMap& valueToOp,
+                                const ValueLiteralMap& valueToLiteral) {
+  try {
+    ConvPoolHelper helper(n);
+    auto xType = onnxToPrimitive(n.inputs().at(0)->elemType());
+    auto wType = onnxToPrimitive(n.inputs().at(3)->elemType());
+    auto xScale = quantizationParameter(n, 1, valueToOp, builder, 1, xla::F32);
+    auto xZeroPoint = quantizationParameter(n, 2, valueToOp, builder, 1, xType);
+    auto wScale = quantizationParameter(n, 4, valueToOp, builder, 1, xla::F32);
+    auto wZeroPoint = quantizationParameter(n, 5, valueToOp, builder, 0, wType);
+    auto yScale = quantizationParameter(n, 6, valueToOp, builder, 1, xla::F32);
+    auto yZeroPoint =
+        quantizationParameter(n, 7, valueToOp, builder, 1, xla::U8);
+
+    auto inputOp =
+        quantizedOffsets(builder, valueToOp.at(n.inputs().at(0)), xZeroPoint);
+    auto windowOp =
+        quantizedOffsets(builder, valueToOp.at(n.inputs().at(3)), wZeroPoint);
+    XlaOp convOp;
+    if (!n.hasAttribute(kgroup) || n.i(kgroup) == 1) {
+      convOp = helper.groupedConvolution(builder, inputOp, windowOp, 1, 1, 1);
+    } else {
+      std::vector<int64_t> inputDims = parseOnnxInputSizes(n, 0);
+      std::vector<int64_t> windowDims = parseOnnxInputSizes(n, 3);
+      convOp =
+          helper.groupedConvolution(builder, inputOp, windowOp, n.i(kgroup),
+                                    inputDims.at(1), windowDims.at(0));
+    }
+    if (n.inputs().size() == 9 && n.inputs().at(8)->uniqueName() != "") {
+      convOp = builder.Add(convOp, valueToOp.at(n.inputs().at(8)), {1});
+    }
+
+    auto realOp = builder.Mul(
+        builder.Mul(builder.ConvertElementType(convOp, xla::F32), xScale.op,
+                    xScale.broadcastDims),
+        wScale.op, wScale.broadcastDims);
+    valueToOp[n.outputs().at(0)] =
+        quantize(builder, realOp, yScale, yZeroPoint);
+  } catch (const std::runtime_error& e) {
+    std::cerr << e.what() << std::endl;
+    return ONNXIFI_STATUS_UNSUPPORTED_OPERATOR;
+  }
+  return ONNXIFI_STATUS_SUCCESS;
+}
+REGISTER_OPERATOR_TRANSLATOR(QLinearConv, translateQLinearConv)
+}
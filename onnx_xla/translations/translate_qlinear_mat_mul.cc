@@ -0,0 +1,90 @@
+#include "onnx_xla/quantization_helper.h"
+
+namespace onnx_xla {
+// Translate QLinearMatMul for matrices or batches of matrices
+// 1) Subtract the zero points in int32 (a per row or per tensor, b per column
+//    or per tensor)
+// 2) Multiply with int32 accumulation, folding the batch dimensions of a into
+//    its rows if b is a matrix
+// 3) Requantize: scale the accumulators by a_scale * b_scale, then quantize
+//    with y_scale and y_zero_point
+onnxStatus translateQLinearMatMul(const Node& n,
+                                  XlaBuilder& builder,
+                                  ValueOpMap& valueToOp,
+                                  const ValueLiteralMap& valueToLiteral) {
+  try {
+    std::vector<int64_t> onnxDimsA = parseOnnxInputSizes(n, 0);
+    std::vector<int64_t> onnxDimsB = parseOnnxInputSizes(n, 3);
+    std::vector<int64> dimsA(onnxDimsA.begin(), onnxDimsA.end());
+    std::vector<int64> dimsB(onnxDimsB.begin(), onnxDimsB.end());
+    if (dimsA.size() < 2 || dimsB.size() < 2 ||
+        (dimsB.size() != 2 && dimsB.size() != dimsA.size())) {
+      throw std::runtime_error(
+          "QLinearMatMul needs matrices, or batches of equal rank");
+    }
+    int64 rankA = dimsA.size();
+    int64 rankB = dimsB.size();
+    int64 rank = rankA;
+    auto aType = onnxToPrimitive(n.inputs().at(0)->elemType());
+    auto bType = onnxToPrimitive(n.inputs().at(3)->elemType());
+    auto aScale =
+        quantizationParameter(n, 1, valueToOp, builder, rank - 2, xla::F32);
+    auto aZeroPoint =
+        quantizationParameter(n, 2, valueToOp, builder, rankA - 2, aType);
+    auto bScale =
+        quantizationParameter(n, 4, valueToOp, builder, rank - 1, xla::F32);
+    auto bZeroPoint =
+        quantizationParameter(n, 5, valueToOp, builder, rankB - 1, bType);
+    auto yScale =
+        quantizationParameter(n, 6, valueToOp, builder, rank - 1, xla::F32);
+    auto yZeroPoint =
+        quantizationParameter(n, 7, valueToOp, builder, rank - 1, xla::U8);
+
+    auto AOp =
+        quantizedOffsets(builder, valueToOp.at(n.inputs().at(0)), aZeroPoint);
+    auto BOp =
+        quantizedOffsets(builder, valueToOp.at(n.inputs().at(3)), bZeroPoint);
+    auto M = dimsA[rankA - 2];
+    auto K = dimsA.back();
+    auto N = dimsB.back();
+    if (K != dimsB[rankB - 2]) {
+      throw std::runtime_error(
+          "Incompatible dimensions for matrix multiplication");
+    }
+    std::vector<int64> outputDims(dimsA.begin(), dimsA.end() - 1);
+    outputDims.push_back(N);
+    XlaOp productOp;
+    if (rankB == 2) {
+      // [batch..., M, K] x [K, N] as [batch * M, K] x [K, N]
+      auto rows = std::accumulate(dimsA.begin(), dimsA.end() - 1, (int64)1,
+                                  std::multiplies<int64>());
+      productOp = builder.Reshape(
+          builder.Dot(builder.Reshape(AOp, {rows, K}), BOp), outputDims);
+    } else {
+      if (!std::equal(dimsA.begin(), dimsA.end() - 2, dimsB.begin())) {
+        throw std::runtime_error("Batch dimensions must match");
+      }
+      ::xla::DotDimensionNumbers dnums;
+      for (auto i = 0; i < rank - 2; ++i) {
+        dnums.add_lhs_batch_dimensions(i);
+        dnums.add_rhs_batch_dimensions(i);
+      }
+      dnums.add_lhs_contracting_dimensions(rank - 1);
+      dnums.add_rhs_contracting_dimensions(rank - 2);
+      productOp = builder.DotGeneral(AOp, BOp, dnums);
+    }
+
+    auto realOp = builder.Mul(
+        builder.Mul(builder.ConvertElementType(productOp, xla::F32), aScale.op,
+                    aScale.broadcastDims),
+        bScale.op, bScale.broadcastDims);
+    valueToOp[n.outputs().at(0)] =
+        quantize(builder, realOp, yScale, yZeroPoint);
+  } catch (const std::runtime_error& e) {
+    std::cerr << e.what() << std::endl;
+    return ONNXIFI_STATUS_UNSUPPORTED_OPERATOR;
+  }
+  return ONNXIFI_STATUS_SUCCESS;
+}
+REGISTER_OPERATOR_TRANSLATOR(QLinearMatMul, translateQLinearMatMul)
+}
@@ -0,0 +1,58 @@
+#include "onnx_xla/quantization_helper.h"
+
+namespace onnx_xla {
+// Axis of per-axis scales and zero points (attribute axis, default 1)
+static int64 quantizationAxis(const Node& n) {
+  auto rank = (int64)parseOnnxInputSizes(n, 0).size();
+  int64 axis = n.hasAttribute(kaxis) ? n.i(kaxis) : 1;
+  return axis < 0 ? axis + rank : axis;
+}
+
+// Translate QuantizeLinear
+// y = saturate(round(x / y_scale) + y_zero_point), uint8 if no zero point
+onnxStatus translateQuantizeLinear(const Node& n,
+                                   XlaBuilder& builder,
+                                   ValueOpMap& valueToOp,
+                                   const ValueLiteralMap& valueToLiteral) {
+  try {
+    auto axis = quantizationAxis(n);
+    auto scale =
+        quantizationParameter(n, 1, valueToOp, builder, axis, xla::F32);
+    auto zeroPoint =
+        quantizationParameter(n, 2, valueToOp, builder, axis, xla::U8);
+    valueToOp[n.outputs().at(0)] = quantize(
+        builder, valueToOp.at(n.inputs().at(0)), scale, zeroPoint);
+  } catch (const std::runtime_error& e) {
+    std::cerr << e.what() << std::endl;
+    return ONNXIFI_STATUS_UNSUPPORTED_OPERATOR;
+  }
+  return ONNXIFI_STATUS_SUCCESS;
+}
+REGISTER_OPERATOR_TRANSLATOR(QuantizeLinear, translateQuantizeLinear)
+
+// Translate DequantizeLinear
+// y = (x - x_zero_point) * x_scale, with the difference taken in int32
+onnxStatus translateDequantizeLinear(const Node& n,
+                                     XlaBuilder& builder,
+                                     ValueOpMap& valueToOp,
+                                     const ValueLiteralMap& valueToLiteral) {
+  try {
+    auto axis = quantizationAxis(n);
+    auto scale =
+        quantizationParameter(n, 1, valueToOp, builder, axis, xla::F32);
+    auto zeroPoint = quantizationParameter(
+        n, 2, valueToOp, builder, axis,
+        onnxToPrimitive(n.inputs().at(0)->elemType()));
+    auto offsetsOp =
+        quantizedOffsets(builder, valueToOp.at(n.inputs().at(0)), zeroPoint);
+    valueToOp[n.outputs().at(0)] =
+        builder.Mul(builder.ConvertElementType(offsetsOp, xla::F32), scale.op,
+                    scale.broadcastDims);
+  } catch (const std::runtime_error& e) {
+    std::cerr << e.what() << std::endl;
+    return ONNXIFI_STATUS_UNSUPPORTED_OPERATOR;
+  }
+  return ONNXIFI_STATUS_SUCCESS;
+}
+REGISTER_OPERATOR_TRANSLATOR(DequantizeLinear, translateDequantizeLinear)
+}
@@ -0,0 +1,43 @@
+#include "onnx_xla/recurrent_helper.h"
+
+namespace onnx_xla {
+// Translate RNN (see RecurrentHelper)
+// Ht = f(Xt * W^T + Ht-1 * R^T + Wb + Rb), with both biases folded into the
+// input projections
+onnxStatus translateRNN(const Node& n,
+                        XlaBuilder& builder,
+                        ValueOpMap& valueToOp,
+                        const ValueLiteralMap& valueToLiteral) {
+  try {
+    RecurrentHelper helper(n, valueToOp, 1, {"Tanh"});
+    auto H = helper.hiddenSize();
+    std::vector<std::vector<XlaOp>> results;
+    for (auto d = 0; d < helper.numDirections(); ++d) {
+      std::vector<XlaOp> biases;
+      if (helper.hasInput(3)) {
+        auto biasOp = helper.directionSlice(builder, 3, d);
+        biases.push_back(
+            builder.Add(builder.SliceInDim(biasOp, 0, H, 1, 0),
+                        builder.SliceInDim(biasOp, H, 2 * H, 1, 0)));
+      }
+      auto cell = [&](XlaBuilder& b, const XlaOp& projection,
+                      const std::vector<XlaOp>& states,
+                      const std::vector<XlaOp>& cellWeights) {
+        auto gatesOp = b.Add(projection, RecurrentHelper::recurrentProjections(
+                                             b, states[0], cellWeights[0]));
+        return std::vector<XlaOp>{helper.activate(b, gatesOp, d, 0)};
+      };
+      results.push_back(helper.run(
+          builder, d, helper.inputProjections(builder, d, biases),
+          {helper.initialState(builder, 5, d)},
+          {helper.directionSlice(builder, 2, d)}, cell));
+    }
+    helper.setOutputs(builder, results, valueToOp);
+  } catch (const std::runtime_error& e) {
+    std::cerr << e.what() << std::endl;
+    return ONNXIFI_STATUS_UNSUPPORTED_OPERATOR;
+  }
+  return ONNXIFI_STATUS_SUCCESS;
+}
+REGISTER_OPERATOR_TRANSLATOR(RNN, translateRNN)
+}
@@ -0,0 +1,212 @@
+#include "onnx_xla/control_flow_helper.h"
+
+namespace onnx_xla {
+// Returns the attribute of n named name, or count zeros if it is not set
+static std::vector<int64> axesOrZeros(const Node& n,
+                                      const char* name,
+                                      size_t count) {
+  if (!n.hasAttribute(Symbol(name))) {
+    return std::vector<int64>(count, 0);
+  }
+  const auto& values = n.is(Symbol(name));
+  if (values.size() != count) {  // TODO: ENFORCE
+    throw std::runtime_error(std::string("Invalid attribute ") + name);
+  }
+  return std::vector<int64>(values.begin(), values.end());
+}
+
+// Returns the permutation moving dimension axis of a rank dimensional value to
+// the front (or back from the front, if inverse)
+static std::vector<int64> axisToFront(int64 axis, int64 rank, bool inverse) {
+  std::vector<int64> permutation;
+  if (inverse) {
+    for (auto i = 1; i <= axis; ++i) {
+      permutation.push_back(i);
+    }
+    permutation.push_back(0);
+    for (auto i = axis + 1; i < rank; ++i) {
+      permutation.push_back(i);
+    }
+  } else {
+    permutation.push_back(axis);
+    for (auto i = 0; i < rank; ++i) {
+      if (i != axis) {
+        permutation.push_back(i);
+      }
+    }
+  }
+  return permutation;
+}
+
+// Translate Scan (opset 9) into While
+// 1) Move the scan axis of every scan input to the front (reversing it for
+//    reverse directions)
+// 2) The loop state is the tuple
+//      (i, state values..., scan inputs..., scan accumulators..., captured...)
+//    and the body binds row i of every scan input to the body inputs
+// 3) Scan outputs are accumulated at row i, then moved to their axis (and
+//    reversed for reverse directions)
+onnxStatus translateScan(const Node& n,
+                         XlaBuilder& builder,
+                         ValueOpMap& valueToOp,
+                         const ValueLiteralMap& valueToLiteral) {
+  const auto& body = *n.g(kbody);
+  try {
+    auto captured = capturedInputs(n, kbody);
+    auto numScanInputs = n.i(Symbol("num_scan_inputs"));
+    auto numState = n.inputs().size() - captured.size() - numScanInputs;
+    auto numScanOutputs = body.outputs().size() - numState;
+    if (body.inputs().size() != numState + numScanInputs ||
+        body.outputs().size() < numState) {  // TODO: ENFORCE
+      std::cerr << "Scan body does not match its inputs" << std::endl;
+      return ONNXIFI_STATUS_INVALID_MODEL;
+    }
+    auto inputAxes = axesOrZeros(n, "scan_input_axes", numScanInputs);
+    auto inputDirections =
+        axesOrZeros(n, "scan_input_directions", numScanInputs);
+    auto outputAxes = axesOrZeros(n, "scan_output_axes", numScanOutputs);
+    auto outputDirections =
+        axesOrZeros(n, "scan_output_directions", numScanOutputs);
+
+    // Initial state, with scan inputs scanned along their first dimension
+    std::vector<XlaOp> initialState;
+    initialState.push_back(builder.ConstantR0<int64>(0));
+    for (auto i = 0; i < numState; ++i) {
+      initialState.push_back(valueToOp.at(n.inputs().at(i)));
+    }
+    int64 length = -1;
+    for (auto j = 0; j < numScanInputs; ++j) {
+      const Value* input = n.inputs().at(numState + j);
+      auto sizes = staticSizesOf(input);
+      int64 rank = sizes.size();
+      auto axis = inputAxes[j] < 0 ? inputAxes[j] + rank : inputAxes[j];
+      if (axis < 0 || axis >= rank ||
+          (length >= 0 && sizes[axis] != length)) {  // TODO: ENFORCE
+        std::cerr << "Invalid scan input axis" << std::endl;
+        return ONNXIFI_STATUS_INVALID_MODEL;
+      }
+      length = sizes[axis];
+      auto inputOp = valueToOp.at(input);
+      if (axis != 0) {
+        inputOp = builder.Transpose(inputOp, axisToFront(axis, rank, false));
+      }
+      if (inputDirections[j] != 0) {
+        inputOp = builder.Rev(inputOp, {0});
+      }
+      initialState.push_back(inputOp);
+    }
+    for (auto k = 0; k < numScanOutputs; ++k) {
+      const Value* scanOutput = body.outputs().at(numState + k);
+      auto sizes = staticSizesOf(scanOutput);
+      sizes.insert(sizes.begin(), length);
+      initialState.push_back(builder.Broadcast(
+          builder.ConvertElementType(builder.ConstantR0<int32_t>(0),
+                                     onnxToPrimitive(scanOutput->elemType())),
+          sizes));
+    }
+    std::vector<Shape> stateShapes;
+    for (const auto& op : initialState) {
+      stateShapes.push_back(builder.GetShape(op).ValueOrDie());
+    }
+    auto scanInputsOffset = 1 + numState;
+    auto accumulatorsOffset = scanInputsOffset + numScanInputs;
+
+    SubgraphTranslator bodyTranslator(body, captured, builder, valueToOp,
+                                      valueToLiteral);
+    auto bodyComputation = bodyTranslator.build(
+        "Scan_body", stateShapes,
+        [&](XlaBuilder& b, const std::vector<XlaOp>& state,
+            ValueOpMap& bodyValueToOp) {
+          for (auto i = 0; i < numState; ++i) {
+            bodyValueToOp[body.inputs().at(i)] = state[1 + i];
+          }
+          for (auto j = 0; j < numScanInputs; ++j) {
+            auto rowSizes = staticSizesOf(body.inputs().at(numState + j));
+            auto sliceSizes = rowSizes;
+            sliceSizes.insert(sliceSizes.begin(), 1);
+            auto rowOp = b.DynamicSlice(
+                state[scanInputsOffset + j],
+                leadingStartIndices(b, state[0], sliceSizes.size()),
+                sliceSizes);
+            bodyValueToOp[body.inputs().at(numState + j)] =
+                b.Reshape(rowOp, rowSizes);
+          }
+        },
+        [&](XlaBuilder& b, const std::vector<XlaOp>& state,
+            const std::vector<XlaOp>& outputs,
+            const std::vector<XlaOp>& capturedOps) {
+          std::vector<XlaOp> root;
+          root.push_back(b.Add(state[0], b.ConstantR0<int64>(1)));
+          for (auto i = 0; i < numState; ++i) {
+            root.push_back(outputs[i]);
+          }
+          for (auto j = 0; j < numScanInputs; ++j) {
+            root.push_back(state[scanInputsOffset + j]);
+          }
+          for (auto k = 0; k < numScanOutputs; ++k) {
+            auto sizes = staticSizesOf(body.outputs().at(numState + k));
+            sizes.insert(sizes.begin(), 1);
+            root.push_back(b.DynamicUpdateSlice(
+                state[accumulatorsOffset + k],
+                b.Reshape(outputs[numState + k], sizes),
+                leadingStartIndices(b, state[0], sizes.size())));
+          }
+          root.insert(root.end(), capturedOps.begin(), capturedOps.end());
+          return b.Tuple(root);
+        });
+
+    // Condition: i < length
+    std::vector<Shape> parameterShapes(stateShapes);
+    parameterShapes.insert(parameterShapes.end(),
+                           bodyTranslator.capturedShapes().begin(),
+                           bodyTranslator.capturedShapes().end());
+    auto condBuilder = builder.CreateSubBuilder("Scan_cond");
+    auto parameterOp = condBuilder->Parameter(
+        0, ShapeUtil::MakeTupleShape(parameterShapes), "Scan_cond_parameter");
+    condBuilder->Lt(condBuilder->GetTupleElement(parameterOp, 0),
+                    condBuilder->ConstantR0<int64>(length));
+    auto condComputation = condBuilder->Build().ConsumeValueOrDie();
+
+    initialState.insert(initialState.end(),
+                        bodyTranslator.capturedOps().begin(),
+                        bodyTranslator.capturedOps().end());
+    auto scanOp = builder.While(condComputation, bodyComputation,
+                                builder.Tuple(initialState));
+
+    // Unused trailing outputs of n may have been removed
+    for (auto i = 0; i < n.outputs().size(); ++i) {
+      if (i < numState) {
+        valueToOp[n.outputs().at(i)] = builder.GetTupleElement(scanOp, 1 + i);
+        continue;
+      }
+      auto k = i - numState;
+      auto outputOp = builder.GetTupleElement(scanOp, accumulatorsOffset + k);
+      if (outputDirections[k] != 0) {
+        outputOp = builder.Rev(outputOp, {0});
+      }
+      int64 rank = staticSizesOf(body.outputs().at(i)).size() + 1;
+      auto axis = outputAxes[k] < 0 ? outputAxes[k] + rank : outputAxes[k];
+      if (axis < 0 || axis >= rank) {  // TODO: ENFORCE
+        std::cerr << "Invalid scan output axis" << std::endl;
+        return ONNXIFI_STATUS_INVALID_MODEL;
+      }
+      if (axis != 0) {
+        outputOp = builder.Transpose(outputOp, axisToFront(axis, rank, true));
+      }
+      valueToOp[n.outputs().at(i)] = outputOp;
+    }
+  } catch (const std::runtime_error& e) {
+    std::cerr << e.what() << std::endl;
+    return ONNXIFI_STATUS_UNSUPPORTED_OPERATOR;
+  }
+  return ONNXIFI_STATUS_SUCCESS;
+}
+REGISTER_OPERATOR_TRANSLATOR_VARIANT("",
+                                     Scan,
+                                     9,
+                                     kMaxOpsetVersion,
+                                     0,
+                                     default,
+                                     nullptr,
+                                     translateScan)
+}
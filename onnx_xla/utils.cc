@@ -1,8 +1,67 @@
 #include "onnx_xla/utils.h"
+#include "tensorflow/compiler/tf2xla/lib/util.h"
+
+#include <functional>
+#include <numeric>
+
+// Dispatches on the element type of the typed fields of TensorProto, where
+// the types narrower than 32 bits are stored in int32_data and uint32 in
+// uint64_data
+#define SWITCH(data_type)                                                 \
+  switch (data_type) {                                                    \
+    case ONNX_NAMESPACE::TensorProto_DataType_FLOAT: {                    \
+      OPERATION(float, float, floats)                                     \
+    }                                                                     \
+    case ONNX_NAMESPACE::TensorProto_DataType_COMPLEX64: {                \
+      OPERATION(complex64, complex64, floats)                             \
+    }                                                                     \
+    case ONNX_NAMESPACE::TensorProto_DataType_FLOAT16: {                  \
+      OPERATION(int32_t, half, int32s)                                    \
+    }                                                                     \
+    case ONNX_NAMESPACE::TensorProto_DataType_BOOL: {                     \
+      OPERATION(int32_t, bool, int32s)                                    \
+    }                                                                     \
+    case ONNX_NAMESPACE::TensorProto_DataType_INT8: {                     \
+      OPERATION(int32_t, int8, int32s)                                    \
+    }                                                                     \
+    case ONNX_NAMESPACE::TensorProto_DataType_INT16: {                    \
+      OPERATION(int32_t, int16, int32s)                                   \
+    }                                                                     \
+    case ONNX_NAMESPACE::TensorProto_DataType_INT32: {                    \
+      OPERATION(int32_t, int32, int32s)                                   \
+    }                                                                     \
+    case ONNX_NAMESPACE::TensorProto_DataType_UINT8: {                    \
+      OPERATION(int32_t, uint8, int32s)                                   \
+    }                                                                     \
+    case ONNX_NAMESPACE::TensorProto_DataType_UINT16: {                   \
+      OPERATION(int32_t, uint16, int32s)                                  \
+    }                                                                     \
+    case ONNX_NAMESPACE::TensorProto_DataType_INT64: {                    \
+      OPERATION(int64_t, int64, int64s)                                   \
+    }                                                                     \
+    case ONNX_NAMESPACE::TensorProto_DataType_UINT32: {                   \
+      OPERATION(uint64_t, uint32, uint64s)                                \
+    }                                                                     \
+    case ONNX_NAMESPACE::TensorProto_DataType_UINT64: {                   \
+      OPERATION(uint64_t, uint64, uint64s)                                \
+    }                                                                     \
+    case ONNX_NAMESPACE::TensorProto_DataType_DOUBLE: {                   \
+      OPERATION(double, double, doubles)                                  \
+    }                                                                     \
+    case ONNX_NAMESPACE::TensorProto_DataType_COMPLEX128:                 \
+    case ONNX_NAMESPACE::TensorProto_DataType_STRING:                     \
+    case ONNX_NAMESPACE::TensorProto_DataType_UNDEFINED:                  \
+    default: {                                                            \
+      throw std::runtime_error("Tensor not of a convertible data type."); \
+    }                                                                     \
+  }
 
 namespace onnx_xla {
 xla::PrimitiveType onnxToPrimitive(
     const ONNX_NAMESPACE::TensorProto_DataType& data_type) {
+  if (data_type == kOnnxBFloat16) {
+    return xla::BF16;
+  }
   switch (data_type) {
     case ONNX_NAMESPACE::TensorProto_DataType_FLOAT: {
       return xla::F32;
@@ -51,6 +110,55 @@ xla::PrimitiveType onnxToPrimitive(
   }
 }
 
+ONNX_NAMESPACE::TensorProto_DataType primitiveToOnnx(
+    const PrimitiveType& primitive_type) {
+  switch (primitive_type) {
+    case xla::F32: {
+      return ONNX_NAMESPACE::TensorProto_DataType_FLOAT;
+    }
+    case xla::C64: {
+      return ONNX_NAMESPACE::TensorProto_DataType_COMPLEX64;
+    }
+    case xla::F16: {
+      return ONNX_NAMESPACE::TensorProto_DataType_FLOAT16;
+    }
+    case xla::PRED: {
+      return ONNX_NAMESPACE::TensorProto_DataType_BOOL;
+    }
+    case xla::S8: {
+      return ONNX_NAMESPACE::TensorProto_DataType_INT8;
+    }
+    case xla::S16: {
+      return ONNX_NAMESPACE::TensorProto_DataType_INT16;
+    }
+    case xla::S32: {
+      return ONNX_NAMESPACE::TensorProto_DataType_INT32;
+    }
+    case xla::U8: {
+      return ONNX_NAMESPACE::TensorProto_DataType_UINT8;
+    }
+    case xla::U16: {
+      return ONNX_NAMESPACE::TensorProto_DataType_UINT16;
+    }
+    case xla::S64: {
+      return ONNX_NAMESPACE::TensorProto_DataType_INT64;
+    }
+    case xla::U32: {
+      return ONNX_NAMESPACE::TensorProto_DataType_UINT32;
+    }
+    case xla::U64: {
+      return ONNX_NAMESPACE::TensorProto_DataType_UINT64;
+    }
+    case xla::F64: {
+      return ONNX_NAMESPACE::TensorProto_DataType_DOUBLE;
+    }
+    case xla::BF16: {
+      return kOnnxBFloat16;
+    }
+    default: { throw std::runtime_error("Not supported"); }
+  }
+}
+
 XlaComputation add(PrimitiveType dataType) {
   XlaBuilder builder("add");
   auto y = builder.Parameter(0, ShapeUtil::MakeShape(dataType, {}), "y");
@@ -67,6 +175,29 @@ XlaComputation max(PrimitiveType dataType) {
   return builder.Build().ConsumeValueOrDie();
 }
 
+XlaOp erf(XlaBuilder& builder, const XlaOp& x, PrimitiveType dataType) {
+  auto literal = [&](float value) {
+    return ::tensorflow::FloatLiteral(&builder, dataType, value);
+  };
+  // erf(|x|) = 1 - (a1 t + ... + a5 t^5) exp(-x^2), with t = 1 / (1 + p |x|)
+  const float p = 0.3275911f;
+  const std::vector<float> a = {0.254829592f, -0.284496736f, 1.421413741f,
+                                -1.453152027f, 1.061405429f};
+  auto absOp = builder.Abs(x);
+  auto tOp =
+      builder.Div(literal(1.0f), builder.Add(literal(1.0f),
+                                             builder.Mul(literal(p), absOp)));
+  auto polynomialOp = literal(a.back());
+  for (auto i = (int)a.size() - 2; i >= 0; --i) {
+    polynomialOp = builder.Add(builder.Mul(polynomialOp, tOp), literal(a[i]));
+  }
+  polynomialOp = builder.Mul(polynomialOp, tOp);
+  auto erfAbsOp = builder.Sub(
+      literal(1.0f),
+      builder.Mul(polynomialOp, builder.Exp(builder.Neg(builder.Mul(x, x)))));
+  return builder.Mul(builder.Sign(x), erfAbsOp);
+}
+
 std::vector<int64_t> parseOnnxInputSizes(const Node& n, size_t inputIndex) {
   if (!n.inputs().at(inputIndex)->has_sizes()) {  // TODO: Enforce
     throw std::runtime_error("Missing shape");
@@ -97,4 +228,35 @@ std::vector<int64> getMultidirectionalBroadcastArg(const XlaBuilder& builder,
   }
   return broadcastDims;
 }
+
+std::unique_ptr<Literal> tensorToLiteral(const ONNX_NAMESPACE::Tensor& t) {
+#define OPERATION(type_from, type_to, vec)                                   \
+  type_from* t_data;                                                         \
+  if (t.is_raw_data()) {                                                     \
+    t_data = (type_from*)t.raw().c_str();                                    \
+  } else {                                                                   \
+    t_data = (type_from*)t.vec().data();                                     \
+  }                                                                          \
+  std::vector<int64> sizes;                                                  \
+  for (auto n : t.sizes()) {                                                 \
+    sizes.push_back(n);                                                      \
+  }                                                                          \
+  auto l = std::unique_ptr<Literal>(new Literal(                             \
+      ShapeUtil::MakeShape(NativeToPrimitiveType<type_to>(), sizes)));       \
+  int64 num_elements = std::accumulate(sizes.begin(), sizes.end(), (int64)1, \
+                                       std::multiplies<int64>());            \
+  tensorflow::gtl::MutableArraySlice<type_to> l_data = l->data<type_to>();   \
+  for (auto i = 0; i < num_elements; ++i) {                                  \
+    l_data[i] = (type_to)t_data[i];                                          \
+  }                                                                          \
+  return l;
+
+  if (t.is_raw_data()) {
+    NATIVE_SWITCH(t.elem_type())
+  }
+  SWITCH(t.elem_type())
+#undef OPERATION
+}
 }
+
+#undef SWITCH
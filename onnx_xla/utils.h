@@ -9,9 +9,11 @@
 #include "tensorflow/core/framework/numeric_types.h"
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow/compiler/xla/client/xla_client/xla_builder.h"
+#include "tensorflow/compiler/xla/literal_util.h"
 
 #include <complex>
 #include <Eigen/Core>
+#include <memory>
 #include <unordered_map>
 #include <vector>
 
@@ -40,20 +42,88 @@ using ::xla::PrimitiveType;
 using ::xla::XlaBuilder;
 using ::xla::ShapeUtil;
 using ::xla::XlaOp;
+using ::xla::Literal;
+using ::xla::primitive_util::NativeToPrimitiveType;
 
 using ::ONNX_NAMESPACE::Node;
 
+// TensorProto_DataType of bfloat16 (TensorProto.BFLOAT16), which the ONNX
+// version built against may not define
+const auto kOnnxBFloat16 =
+    static_cast<ONNX_NAMESPACE::TensorProto_DataType>(16);
+
 // Helper functions to translate between ONNX and XLA types
 PrimitiveType onnxToPrimitive(
     const ONNX_NAMESPACE::TensorProto_DataType& data_type);
+ONNX_NAMESPACE::TensorProto_DataType primitiveToOnnx(
+    const PrimitiveType& primitive_type);
 
 // Utilities to help translation functions
 XlaComputation add(PrimitiveType dataType);
 XlaComputation max(PrimitiveType dataType);
 
+// Returns erf of x elementwise, which has no XLA operation (Abramowitz and
+// Stegun 7.1.26, absolute error below 1.5e-7)
+XlaOp erf(XlaBuilder& builder, const XlaOp& x, PrimitiveType dataType);
+
+// Converts an ONNX tensor (initializer or attribute) to a literal
+std::unique_ptr<Literal> tensorToLiteral(const ONNX_NAMESPACE::Tensor& t);
+
 std::vector<int64_t> parseOnnxInputSizes(const Node& n, size_t inputIndex);
 
 std::vector<int64> getMultidirectionalBroadcastArg(const XlaBuilder& builder,
                                                    const XlaOp& firstOp,
                                                    const XlaOp& secondOp);
 }
+
+// Dispatches on the element type of ONNXIFI buffers and raw TensorProto
+// data, whose elements are stored at their native width. Expects
+// OPERATION(type_from, type_to, vec) to be defined at the point of use
+#define NATIVE_SWITCH(data_type)                                          \
+  switch (data_type) {                                                    \
+    case ONNX_NAMESPACE::TensorProto_DataType_FLOAT: {                    \
+      OPERATION(float, float, floats)                                     \
+    }                                                                     \
+    case ONNX_NAMESPACE::TensorProto_DataType_COMPLEX64: {                \
+      OPERATION(complex64, complex64, floats)                             \
+    }                                                                     \
+    case ONNX_NAMESPACE::TensorProto_DataType_FLOAT16: {                  \
+      OPERATION(half, half, int32s)                                       \
+    }                                                                     \
+    case ONNX_NAMESPACE::TensorProto_DataType_BOOL: {                     \
+      OPERATION(bool, bool, int32s)                                       \
+    }                                                                     \
+    case ONNX_NAMESPACE::TensorProto_DataType_INT8: {                     \
+      OPERATION(int8, int8, int32s)                                       \
+    }                                                                     \
+    case ONNX_NAMESPACE::TensorProto_DataType_INT16: {                    \
+      OPERATION(int16, int16, int32s)                                     \
+    }                                                                     \
+    case ONNX_NAMESPACE::TensorProto_DataType_INT32: {                    \
+      OPERATION(int32, int32, int32s)                                     \
+    }                                                                     \
+    case ONNX_NAMESPACE::TensorProto_DataType_UINT8: {                    \
+      OPERATION(uint8, uint8, int32s)                                     \
+    }                                                                     \
+    case ONNX_NAMESPACE::TensorProto_DataType_UINT16: {                   \
+      OPERATION(uint16, uint16, int32s)                                   \
+    }                                                                     \
+    case ONNX_NAMESPACE::TensorProto_DataType_INT64: {                    \
+      OPERATION(int64, int64, int64s)                                     \
+    }                                                                     \
+    case ONNX_NAMESPACE::TensorProto_DataType_UINT32: {                   \
+      OPERATION(uint32, uint32, uint64s)                                  \
+    }                                                                     \
+    case ONNX_NAMESPACE::TensorProto_DataType_UINT64: {                   \
+      OPERATION(uint64, uint64, uint64s)                                  \
+    }                                                                     \
+    case ONNX_NAMESPACE::TensorProto_DataType_DOUBLE: {                   \
+      OPERATION(double, double, doubles)                                  \
+    }                                                                     \
+    case ONNX_NAMESPACE::TensorProto_DataType_COMPLEX128:                 \
+    case ONNX_NAMESPACE::TensorProto_DataType_STRING:                     \
+    case ONNX_NAMESPACE::TensorProto_DataType_UNDEFINED:                  \
+    default: {                                                            \
+      throw std::runtime_error("Tensor not of a convertible data type."); \
+    }                                                                     \
+  }
@@ -17,6 +17,7 @@ backend_test.include(r'(test_relu'  # Test relu.
                      '|test_softmax' # Test softmax
                      '|test_batchnorm' # Test BatchNormalization
                      '|test_gemm' # Test Gemm
+                     '|test_matmul' # Test MatMul
                      '|test_concat' # Test Concat
                      '|test_unsqueeze' # Test Unsqueeze
                      '|test_globalaveragepool' #Test GlobalAveragePool
@@ -32,6 +33,14 @@ backend_test.include(r'(test_relu'  # Test relu.
                      '|test_conv_with'
                      '|test_average_pool' #Test AveragePool
                      '|test_dropout' # Test Dropout
+                     '|test_scan9' # Test Scan
+                     '|test_simple_rnn' # Test RNN
+                     '|test_gru' # Test GRU
+                     '|test_lstm' # Test LSTM
+                     '|test_quantizelinear' # Test QuantizeLinear
+                     '|test_dequantizelinear' # Test DequantizeLinear
+                     '|test_qlinearconv' # Test QLinearConv
+                     '|test_qlinearmatmul' # Test QLinearMatMul
                      '|test_resnet50' 
                      '|test_bvlc_alexnet'
                      '|test_densenet121'
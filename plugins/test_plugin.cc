@@ -0,0 +1,29 @@
+#include "onnx_xla/onnx_xla_plugin.h"
+#include "onnx_xla/operator_registry.h"
+
+// Minimal translator plugin, loaded by plugin_test (see
+// onnx_xla/backend_test.cc): translates TestNegate of the onnx_xla.test
+// domain to Neg
+
+static onnxStatus translateTestNegate(const void* node,
+                                      void* builder,
+                                      void* valueToOp,
+                                      const void* valueToLiteral) {
+  const auto* n = static_cast<const ONNX_NAMESPACE::Node*>(node);
+  auto& ops = *static_cast<onnx_xla::ValueOpMap*>(valueToOp);
+  ops[n->outputs().at(0)] =
+      static_cast<xla::XlaBuilder*>(builder)->Neg(ops.at(n->inputs().at(0)));
+  return ONNXIFI_STATUS_SUCCESS;
+}
+
+extern "C" onnxStatus onnxXlaPluginInit(
+    uint32_t apiVersion,
+    OnnxXlaRegisterTranslatorFunction registerTranslator) {
+  if (apiVersion != ONNX_XLA_PLUGIN_API_VERSION) {
+    return ONNXIFI_STATUS_UNSUPPORTED_VERSION;
+  }
+  OnnxXlaTranslatorDescriptor descriptor = {"onnx_xla.test", "TestNegate", 1,
+                                            INT64_MAX, 0, "default", nullptr,
+                                            translateTestNegate};
+  return registerTranslator(&descriptor);
+}
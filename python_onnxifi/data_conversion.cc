@@ -5,8 +5,25 @@
 #include <algorithm>
 #include <complex>
 #include <functional>
+#include <new>
 namespace py = pybind11;
 
+// Element of float16 buffers and numpy arrays, copied as its IEEE half bits
+struct Float16 {
+  uint16_t bits;
+};
+
+// Returns the numpy dtype of arrays of T elements
+template <typename T>
+static py::dtype numpyDtype() {
+  return py::dtype::of<T>();
+}
+
+template <>
+py::dtype numpyDtype<Float16>() {
+  return py::dtype("float16");
+}
+
 #define DISPATCH_OVER_NUMERIC_DATA_TYPE(data_type, op_template, ...)        \
   switch (data_type) {                                                      \
     case ONNX_NAMESPACE::TensorProto_DataType_FLOAT: {                      \
@@ -18,19 +35,19 @@ namespace py = pybind11;
       break;                                                                \
     }                                                                       \
     case ONNX_NAMESPACE::TensorProto_DataType_FLOAT16: {                    \
-      /*TODO:op_template<int32_t, half>(__VA_ARGS__);*/                     \
+      op_template<Float16, Float16>(__VA_ARGS__);                           \
       break;                                                                \
     }                                                                       \
     case ONNX_NAMESPACE::TensorProto_DataType_BOOL: {                       \
-      op_template<int32_t, bool>(__VA_ARGS__);                              \
+      op_template<bool, bool>(__VA_ARGS__);                                 \
       break;                                                                \
     }                                                                       \
     case ONNX_NAMESPACE::TensorProto_DataType_INT8: {                       \
-      op_template<int32_t, int8_t>(__VA_ARGS__);                            \
+      op_template<int8_t, int8_t>(__VA_ARGS__);                             \
       break;                                                                \
     }                                                                       \
     case ONNX_NAMESPACE::TensorProto_DataType_INT16: {                      \
-      op_template<int32_t, int16_t>(__VA_ARGS__);                           \
+      op_template<int16_t, int16_t>(__VA_ARGS__);                           \
       break;                                                                \
     }                                                                       \
     case ONNX_NAMESPACE::TensorProto_DataType_INT32: {                      \
@@ -38,11 +55,11 @@ namespace py = pybind11;
       break;                                                                \
     }                                                                       \
     case ONNX_NAMESPACE::TensorProto_DataType_UINT8: {                      \
-      op_template<int32_t, uint8_t>(__VA_ARGS__);                           \
+      op_template<uint8_t, uint8_t>(__VA_ARGS__);                           \
       break;                                                                \
     }                                                                       \
     case ONNX_NAMESPACE::TensorProto_DataType_UINT16: {                     \
-      op_template<int32_t, uint16_t>(__VA_ARGS__);                          \
+      op_template<uint16_t, uint16_t>(__VA_ARGS__);                         \
       break;                                                                \
     }                                                                       \
     case ONNX_NAMESPACE::TensorProto_DataType_INT64: {                      \
@@ -50,7 +67,7 @@ namespace py = pybind11;
       break;                                                                \
     }                                                                       \
     case ONNX_NAMESPACE::TensorProto_DataType_UINT32: {                     \
-      op_template<uint64_t, uint32_t>(__VA_ARGS__);                         \
+      op_template<uint32_t, uint32_t>(__VA_ARGS__);                         \
       break;                                                                \
     }                                                                       \
     case ONNX_NAMESPACE::TensorProto_DataType_UINT64: {                     \
@@ -71,6 +88,49 @@ namespace py = pybind11;
     }                                                                       \
   }
 
+BackendBuffer::BackendBuffer(const BackendBuffer& b) {
+  resize(b.size_);
+  std::copy(b.data_, b.data_ + b.size_, data_);
+}
+
+BackendBuffer::BackendBuffer(BackendBuffer&& b) noexcept
+    : data_(b.data_), size_(b.size_) {
+  b.data_ = nullptr;
+  b.size_ = 0;
+}
+
+BackendBuffer& BackendBuffer::operator=(BackendBuffer b) noexcept {
+  std::swap(data_, b.data_);
+  std::swap(size_, b.size_);
+  return *this;
+}
+
+BackendBuffer::~BackendBuffer() {
+  if (data_) {
+    // Cannot fail for buffers of onnxXlaAllocateBuffer
+    auto status = onnxXlaReleaseBuffer(reinterpret_cast<onnxPointer>(data_));
+    (void)status;
+  }
+}
+
+void BackendBuffer::resize(size_t size) {
+  *this = BackendBuffer();
+  onnxPointer buffer;
+  if (onnxXlaAllocateBuffer(size, 0, &buffer) != ONNXIFI_STATUS_SUCCESS) {
+    throw std::bad_alloc();
+  }
+  data_ = reinterpret_cast<char*>(buffer);
+  size_ = size;
+}
+
+char* BackendBuffer::data() const {
+  return data_;
+}
+
+size_t BackendBuffer::size() const {
+  return size_;
+}
+
 DescriptorData::DescriptorData(DescriptorData&& d) noexcept {
   name = std::move(d.name);
   buffer = std::move(d.buffer);
@@ -198,13 +258,13 @@ void DataConversion::fillDescriptorDataVector(
     const auto numpyArray = py::reinterpret_borrow<py::array>(*npIterator);
     const auto dtype = numpyArray.dtype();
     if (dtype.is(py::dtype::of<bool>())) {
-      fillDescriptorDataImpl<int32_t, bool>(
+      fillDescriptorDataImpl<bool, bool>(
           dd, numpyArray, ONNX_NAMESPACE::TensorProto_DataType_BOOL);
     } else if (dtype.is(py::dtype::of<int8_t>())) {
-      fillDescriptorDataImpl<int32_t, int8_t>(
+      fillDescriptorDataImpl<int8_t, int8_t>(
           dd, numpyArray, ONNX_NAMESPACE::TensorProto_DataType_INT8);
     } else if (dtype.is(py::dtype::of<int16_t>())) {
-      fillDescriptorDataImpl<int32_t, int16_t>(
+      fillDescriptorDataImpl<int16_t, int16_t>(
           dd, numpyArray, ONNX_NAMESPACE::TensorProto_DataType_INT16);
     } else if (dtype.is(py::dtype::of<int32_t>())) {
       fillDescriptorDataImpl<int32_t, int32_t>(
@@ -213,22 +273,21 @@ void DataConversion::fillDescriptorDataVector(
       fillDescriptorDataImpl<int64_t, int64_t>(
           dd, numpyArray, ONNX_NAMESPACE::TensorProto_DataType_INT64);
     } else if (dtype.is(py::dtype::of<uint8_t>())) {
-      fillDescriptorDataImpl<int32_t, uint8_t>(
+      fillDescriptorDataImpl<uint8_t, uint8_t>(
           dd, numpyArray, ONNX_NAMESPACE::TensorProto_DataType_UINT8);
     } else if (dtype.is(py::dtype::of<uint16_t>())) {
-      fillDescriptorDataImpl<int32_t, uint16_t>(
+      fillDescriptorDataImpl<uint16_t, uint16_t>(
           dd, numpyArray, ONNX_NAMESPACE::TensorProto_DataType_UINT16);
     } else if (dtype.is(py::dtype::of<uint32_t>())) {
-      fillDescriptorDataImpl<uint64_t, uint32_t>(
+      fillDescriptorDataImpl<uint32_t, uint32_t>(
           dd, numpyArray, ONNX_NAMESPACE::TensorProto_DataType_UINT32);
     } else if (dtype.is(py::dtype::of<uint64_t>())) {
       fillDescriptorDataImpl<uint64_t, uint64_t>(
           dd, numpyArray, ONNX_NAMESPACE::TensorProto_DataType_UINT64);
-    } /*else if (dtype.is(py::dtype::of<half>())) {
-    TODO: fillDescriptorDataImpl<int32_t, half>(dd, numpyArray,
-    //         ONNX_NAMESPACE::TensorProto_DataType_FLOAT16);
-  }*/ else if (
-        dtype.is(py::dtype::of<float>())) {
+    } else if (dtype.is(numpyDtype<Float16>())) {
+      fillDescriptorDataImpl<Float16, Float16>(
+          dd, numpyArray, ONNX_NAMESPACE::TensorProto_DataType_FLOAT16);
+    } else if (dtype.is(py::dtype::of<float>())) {
       fillDescriptorDataImpl<float, float>(
           dd, numpyArray, ONNX_NAMESPACE::TensorProto_DataType_FLOAT);
     } else if (dtype.is(py::dtype::of<double>())) {
@@ -260,7 +319,7 @@ void DataConversion::addNumpyArray(py::list& numpyArrayList,
   std::vector<ptrdiff_t> shape(dd.descriptor.shape,
                                dd.descriptor.shape + dd.descriptor.dimensions);
   numpyArrayList.append(
-      std::move(py::array_t<py_type>(shape, intermediateBuffer)));
+      std::move(py::array(numpyDtype<py_type>(), shape, intermediateBuffer)));
 }
 
 void DataConversion::fillNumpyArrayList(
@@ -6,6 +6,7 @@
 
 #include "onnx/onnxifi.h"
 #include "onnx/onnx.pb.h"
+#include "onnx_xla/onnx_xla_extensions.h"
 #include "onnx/shape_inference/implementation.h"
 
 #include <vector>
@@ -18,6 +19,26 @@ using ::ONNX_NAMESPACE::ValueInfoProto;
 
 // Utility classes to navigate conversions of onnxTensorDescriptorV1 and numpy
 
+// IO buffer allocated by the backend (see onnxXlaAllocateBuffer), so that
+// inputs are transferred without staging copies
+class BackendBuffer {
+ public:
+  BackendBuffer() = default;
+  BackendBuffer(const BackendBuffer& b);
+  BackendBuffer(BackendBuffer&& b) noexcept;
+  BackendBuffer& operator=(BackendBuffer b) noexcept;
+  ~BackendBuffer();
+
+  // Reallocates the buffer with size bytes, dropping its contents
+  void resize(size_t size);
+  char* data() const;
+  size_t size() const;
+
+ private:
+  char* data_ = nullptr;
+  size_t size_ = 0;
+};
+
 // Struct to manage onnxTensorDescriptorV1 data for lifetime of the descriptor
 struct DescriptorData {
   // Setup metadata and allocate buffer
@@ -30,7 +51,7 @@ struct DescriptorData {
   // Containers for memory managment
   std::vector<uint64_t> shape;
   std::string name;
-  std::vector<char> buffer;
+  BackendBuffer buffer;
 
   // Returns size of buffer need to store data of onnxType with given shape
   template <typename onnx_type, typename unused>
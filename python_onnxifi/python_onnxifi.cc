@@ -10,6 +10,7 @@
 #include "onnx/onnxifi.h"
 #include "onnx/onnx.pb.h"
 #include "onnx/proto_utils.h"
+#include "onnx_xla/onnx_xla_properties.h"
 #include "python_onnxifi/data_conversion.h"
 
 namespace py = pybind11;
@@ -220,18 +221,63 @@ DeviceIDs::string_to_deviceType_() {
   return string_to_deviceType_;
 }
 
+// Auxiliary properties of onnxInitGraph from the keyword arguments of prepare:
+//  mixed_precision, transfer_precision: 'float16' or 'bfloat16'
+//  fp32_operators, reduced_precision_operators: ',' separated operator types
+//  transfer_values: ',' separated input and output names
+// names holds the strings the properties point to
+std::vector<uint64_t> graphProperties(const py::kwargs& kwargs,
+                                      std::vector<std::string>& names) {
+  std::vector<uint64_t> properties;
+  const std::vector<std::pair<std::string, uint64_t>> types = {
+      {"mixed_precision", ONNX_XLA_GRAPH_PROPERTY_MIXED_PRECISION},
+      {"transfer_precision", ONNX_XLA_GRAPH_PROPERTY_TRANSFER_PRECISION}};
+  for (const auto& type : types) {
+    if (kwargs.contains(type.first.c_str())) {
+      auto name = kwargs[type.first.c_str()].cast<std::string>();
+      if (name != "float16" && name != "bfloat16") {
+        throw std::runtime_error(type.first +
+                                 " must be 'float16' or 'bfloat16'");
+      }
+      properties.push_back(type.second);
+      properties.push_back(name == "float16" ? ONNXIFI_DATATYPE_FLOAT16
+                                             : ONNX_XLA_DATATYPE_BFLOAT16);
+    }
+  }
+  const std::vector<std::pair<std::string, uint64_t>> lists = {
+      {"fp32_operators", ONNX_XLA_GRAPH_PROPERTY_FP32_OPERATORS},
+      {"reduced_precision_operators",
+       ONNX_XLA_GRAPH_PROPERTY_REDUCED_PRECISION_OPERATORS},
+      {"transfer_values", ONNX_XLA_GRAPH_PROPERTY_TRANSFER_VALUES}};
+  names.reserve(lists.size());
+  for (const auto& list : lists) {
+    if (kwargs.contains(list.first.c_str())) {
+      names.push_back(kwargs[list.first.c_str()].cast<std::string>());
+      properties.push_back(list.second);
+      properties.push_back(reinterpret_cast<uint64_t>(names.back().c_str()));
+    }
+  }
+  properties.push_back(ONNXIFI_GRAPH_PROPERTY_NONE);
+  return properties;
+}
+
 struct BackendRep {
  public:
   // Takes ownership of serializedModel, used to initialize graph
   // DataConversion object sets up tensor descriptors
-  // IO is set and graph is initialized
+  // IO is set and graph is initialized with the options in kwargs (see
+  // graphProperties)
   // Only works for static grphas
-  BackendRep(std::string&& serializedModel, onnxBackend backend)
+  BackendRep(std::string&& serializedModel,
+             onnxBackend backend,
+             const py::kwargs& kwargs)
       : graph_(),
         backend_(backend),
         serialized_model_(serializedModel),
         conversion_(serialized_model_) {
-    if (onnxInitGraph(backend, NULL, serialized_model_.size(),
+    std::vector<std::string> names;
+    auto properties = graphProperties(kwargs, names);
+    if (onnxInitGraph(backend, properties.data(), serialized_model_.size(),
                       serialized_model_.c_str(), 0, nullptr,
                       &graph_) != ONNXIFI_STATUS_SUCCESS) {
       throw std::runtime_error("Could not initialize graph on given device");
@@ -340,7 +386,7 @@ class Backend {
     onnxBackend backend = devices_.prepDevice(device);
     onnxGraph graph;
     return std::unique_ptr<BackendRep>(
-        new BackendRep(std::move(serializedModel), backend));
+        new BackendRep(std::move(serializedModel), backend, kwargs));
   }
 
  private:
@@ -8,6 +8,7 @@ import onnx
 from onnx import ModelProto, NodeProto
 from onnx import numpy_helper
 import numpy as np
+import math
 
 # This is for experimental purposes
 backend = OnnxifiBackend()
@@ -94,3 +95,292 @@ for test_name, shape in test_cases.items():
     expected_outputs = [reshaped]
     np.testing.assert_equal(expected_outputs, outputs)
 
+
+# test reshape with a target computed from the input shape
+# The Shape->Gather->Unsqueeze->Concat chain is folded to a constant
+nodes = [
+    onnx.helper.make_node('Shape', ['data'], ['data_shape']),
+    onnx.helper.make_node('Gather', ['data_shape', 'zero'], ['batch'],
+                          axis=0),
+    onnx.helper.make_node('Unsqueeze', ['batch'], ['batch_1d'], axes=[0]),
+    onnx.helper.make_node('Concat', ['batch_1d', 'minus_one'], ['shape'],
+                          axis=0),
+    onnx.helper.make_node('Reshape', ['data', 'shape'], ['flattened'])]
+graph = onnx.helper.make_graph(
+    nodes=nodes,
+    name='ShapeSubgraphReshape',
+    inputs=[onnx.helper.make_tensor_value_info(
+        'data', onnx.TensorProto.FLOAT, original_shape),
+            onnx.helper.make_tensor_value_info(
+        'zero', onnx.TensorProto.INT64, []),
+            onnx.helper.make_tensor_value_info(
+        'minus_one', onnx.TensorProto.INT64, [1])],
+    outputs=[onnx.helper.make_tensor_value_info(
+        'flattened', onnx.TensorProto.FLOAT, [2, 12])],
+    initializer=[onnx.helper.make_tensor(
+        'zero', onnx.TensorProto.INT64, [], [0]),
+                 onnx.helper.make_tensor(
+        'minus_one', onnx.TensorProto.INT64, [1], [-1])])
+
+model = onnx.helper.make_model(graph, producer_name='backend-test')
+onnx.checker.check_model(model)
+
+assert(backend.is_compatible(model, device='CPU'))
+backendrep = backend.prepare(model, device='CPU')
+
+outputs = backendrep.run([data])
+expected_outputs = [np.reshape(data, [2, 12])]
+np.testing.assert_equal(expected_outputs, outputs)
+
+
+# test loop whose body adds a value captured from the outer graph
+body = onnx.helper.make_graph(
+    nodes=[onnx.helper.make_node('Identity', ['cond_in'], ['cond_out']),
+           onnx.helper.make_node('Add', ['sum_in', 'data'], ['sum_out'])],
+    name='AddBody',
+    inputs=[onnx.helper.make_tensor_value_info(
+        'iteration_num', onnx.TensorProto.INT64, []),
+            onnx.helper.make_tensor_value_info(
+        'cond_in', onnx.TensorProto.BOOL, []),
+            onnx.helper.make_tensor_value_info(
+        'sum_in', onnx.TensorProto.FLOAT, original_shape)],
+    outputs=[onnx.helper.make_tensor_value_info(
+        'cond_out', onnx.TensorProto.BOOL, []),
+             onnx.helper.make_tensor_value_info(
+        'sum_out', onnx.TensorProto.FLOAT, original_shape)])
+node = onnx.helper.make_node('Loop', ['trip_count', '', 'initial'], ['sum'],
+                             body=body)
+graph = onnx.helper.make_graph(
+    nodes=[node],
+    name='CapturingLoop',
+    inputs=[onnx.helper.make_tensor_value_info(
+        'data', onnx.TensorProto.FLOAT, original_shape),
+            onnx.helper.make_tensor_value_info(
+        'initial', onnx.TensorProto.FLOAT, original_shape),
+            onnx.helper.make_tensor_value_info(
+        'trip_count', onnx.TensorProto.INT64, [])],
+    outputs=[onnx.helper.make_tensor_value_info(
+        'sum', onnx.TensorProto.FLOAT, original_shape)],
+    initializer=[onnx.helper.make_tensor(
+        'trip_count', onnx.TensorProto.INT64, [], [3])])
+
+model = onnx.helper.make_model(graph, producer_name='backend-test')
+onnx.checker.check_model(model)
+
+assert(backend.is_compatible(model, device='CPU'))
+backendrep = backend.prepare(model, device='CPU')
+
+initial = np.random.randn(*original_shape).astype(np.float32)
+outputs = backendrep.run([data, initial])
+expected_outputs = [initial + 3 * data]
+np.testing.assert_allclose(expected_outputs, outputs, rtol=1e-5)
+
+
+# test layer normalization followed by gelu, as exported from PyTorch
+# Both decompositions are fused (Erf, Sqrt and ReduceMean are only supported
+# through the fusion)
+hidden_shape = [2, 3, 8]
+nodes = [
+    onnx.helper.make_node('ReduceMean', ['hidden'], ['mean'], axes=[-1]),
+    onnx.helper.make_node('Sub', ['hidden', 'mean'], ['centered']),
+    onnx.helper.make_node('Pow', ['centered', 'two'], ['squared']),
+    onnx.helper.make_node('ReduceMean', ['squared'], ['variance'], axes=[-1]),
+    onnx.helper.make_node('Add', ['variance', 'epsilon'], ['variance_eps']),
+    onnx.helper.make_node('Sqrt', ['variance_eps'], ['stddev']),
+    onnx.helper.make_node('Div', ['centered', 'stddev'], ['normalized']),
+    onnx.helper.make_node('Mul', ['normalized', 'gamma'], ['scaled']),
+    onnx.helper.make_node('Add', ['scaled', 'beta'], ['layer_norm']),
+    onnx.helper.make_node('Div', ['layer_norm', 'sqrt_two'], ['erf_input']),
+    onnx.helper.make_node('Erf', ['erf_input'], ['erf']),
+    onnx.helper.make_node('Add', ['erf', 'one'], ['erf_plus_one']),
+    onnx.helper.make_node('Mul', ['layer_norm', 'erf_plus_one'], ['gelu_2x']),
+    onnx.helper.make_node('Mul', ['gelu_2x', 'half'], ['gelu'])]
+scalars = [('two', 2.0), ('epsilon', 1e-5), ('sqrt_two', np.sqrt(2.0)),
+           ('one', 1.0), ('half', 0.5)]
+gamma = np.random.randn(hidden_shape[-1]).astype(np.float32)
+beta = np.random.randn(hidden_shape[-1]).astype(np.float32)
+graph = onnx.helper.make_graph(
+    nodes=nodes,
+    name='LayerNormGelu',
+    inputs=[onnx.helper.make_tensor_value_info(
+        'hidden', onnx.TensorProto.FLOAT, hidden_shape)] +
+    [onnx.helper.make_tensor_value_info(name, onnx.TensorProto.FLOAT, [])
+     for name, _ in scalars] +
+    [onnx.helper.make_tensor_value_info(name, onnx.TensorProto.FLOAT,
+                                        [hidden_shape[-1]])
+     for name in ['gamma', 'beta']],
+    outputs=[onnx.helper.make_tensor_value_info(
+        'gelu', onnx.TensorProto.FLOAT, hidden_shape)],
+    initializer=[onnx.helper.make_tensor(
+        name, onnx.TensorProto.FLOAT, [], [value]) for name, value in scalars] +
+    [onnx.helper.make_tensor('gamma', onnx.TensorProto.FLOAT,
+                             [hidden_shape[-1]], gamma),
+     onnx.helper.make_tensor('beta', onnx.TensorProto.FLOAT,
+                             [hidden_shape[-1]], beta)])
+
+model = onnx.helper.make_model(graph, producer_name='backend-test')
+onnx.checker.check_model(model)
+
+assert(backend.is_compatible(model, device='CPU'))
+backendrep = backend.prepare(model, device='CPU')
+
+hidden = np.random.randn(*hidden_shape).astype(np.float32)
+outputs = backendrep.run([hidden])
+mean = hidden.mean(axis=-1, keepdims=True)
+variance = ((hidden - mean) ** 2).mean(axis=-1, keepdims=True)
+layer_norm = (hidden - mean) / np.sqrt(variance + 1e-5) * gamma + beta
+erf = np.vectorize(math.erf)
+expected_outputs = [0.5 * layer_norm * (1 + erf(layer_norm / np.sqrt(2.0)))]
+np.testing.assert_allclose(expected_outputs, outputs, rtol=1e-4, atol=1e-5)
+
+
+# test mixed precision on a dense layer followed by Softmax
+# MatMul accumulates in float32 from float16 weights, Add and Relu compute in
+# float16 and Softmax in float32; the drift from the float32 run is reported
+weights = np.random.randn(16, 10).astype(np.float32)
+bias = np.random.randn(10).astype(np.float32)
+nodes = [
+    onnx.helper.make_node('MatMul', ['features', 'weights'], ['product']),
+    onnx.helper.make_node('Add', ['product', 'bias'], ['logits']),
+    onnx.helper.make_node('Relu', ['logits'], ['activations']),
+    onnx.helper.make_node('Softmax', ['activations'], ['probabilities'])]
+graph = onnx.helper.make_graph(
+    nodes=nodes,
+    name='MixedPrecisionDense',
+    inputs=[onnx.helper.make_tensor_value_info(name, onnx.TensorProto.FLOAT,
+                                               shape)
+            for name, shape in [('features', [4, 16]), ('weights', [16, 10]),
+                                ('bias', [10])]],
+    outputs=[onnx.helper.make_tensor_value_info(
+        'probabilities', onnx.TensorProto.FLOAT, [4, 10])],
+    initializer=[onnx.helper.make_tensor('weights', onnx.TensorProto.FLOAT,
+                                         [16, 10], weights.flatten()),
+                 onnx.helper.make_tensor('bias', onnx.TensorProto.FLOAT, [10],
+                                         bias)])
+model = onnx.helper.make_model(graph, producer_name='backend-test')
+onnx.checker.check_model(model)
+
+features = np.random.randn(4, 16).astype(np.float32)
+full_outputs = backend.prepare(model, device='CPU').run([features])
+mixed_outputs = backend.prepare(
+    model, device='CPU', mixed_precision='float16').run([features])
+drift = np.max(np.abs(full_outputs[0] - mixed_outputs[0]))
+print("Mixed precision (float16) drift from float32: {}".format(drift))
+np.testing.assert_allclose(full_outputs, mixed_outputs, atol=1e-2)
+
+
+# test attention fusion on scaled dot-product attention, with and without a
+# mask broadcast over the heads, added after or before the scores (the latter
+# produced by Mul, like the scores)
+attention_shape = [2, 3, 4, 8]
+mask_shape = [2, 1, 1, 4]
+for masked, mask_first in [(False, False), (True, False), (True, True)]:
+    nodes = [
+        onnx.helper.make_node('Transpose', ['key'], ['key_t'],
+                              perm=[0, 1, 3, 2]),
+        onnx.helper.make_node('MatMul', ['query', 'key_t'], ['product']),
+        onnx.helper.make_node('Div', ['product', 'sqrt_d'], ['scores'])]
+    if mask_first:
+        nodes += [
+            onnx.helper.make_node('Mul', ['mask_input', 'one'], ['mask']),
+            onnx.helper.make_node('Add', ['mask', 'scores'],
+                                  ['masked_scores'])]
+    elif masked:
+        nodes.append(onnx.helper.make_node('Add', ['scores', 'mask'],
+                                           ['masked_scores']))
+    nodes += [
+        onnx.helper.make_node(
+            'Softmax', ['masked_scores' if masked else 'scores'],
+            ['probabilities'], axis=3),
+        onnx.helper.make_node('MatMul', ['probabilities', 'value'],
+                              ['attention'])]
+    inputs = [onnx.helper.make_tensor_value_info(
+        name, onnx.TensorProto.FLOAT, attention_shape)
+              for name in ['query', 'key', 'value']]
+    inputs.append(onnx.helper.make_tensor_value_info(
+        'sqrt_d', onnx.TensorProto.FLOAT, []))
+    initializer = [onnx.helper.make_tensor(
+        'sqrt_d', onnx.TensorProto.FLOAT, [], [np.sqrt(attention_shape[-1])])]
+    if mask_first:
+        inputs += [
+            onnx.helper.make_tensor_value_info(
+                'mask_input', onnx.TensorProto.FLOAT, mask_shape),
+            onnx.helper.make_tensor_value_info(
+                'one', onnx.TensorProto.FLOAT, [])]
+        initializer.append(onnx.helper.make_tensor(
+            'one', onnx.TensorProto.FLOAT, [], [1.0]))
+    elif masked:
+        inputs.append(onnx.helper.make_tensor_value_info(
+            'mask', onnx.TensorProto.FLOAT, mask_shape))
+    graph = onnx.helper.make_graph(
+        nodes=nodes,
+        name='MaskedAttention' if masked else 'Attention',
+        inputs=inputs,
+        outputs=[onnx.helper.make_tensor_value_info(
+            'attention', onnx.TensorProto.FLOAT, attention_shape)],
+        initializer=initializer)
+    model = onnx.helper.make_model(graph, producer_name='backend-test')
+    onnx.checker.check_model(model)
+
+    assert(backend.is_compatible(model, device='CPU'))
+    backendrep = backend.prepare(model, device='CPU')
+
+    query, key, value = [np.random.randn(*attention_shape).astype(np.float32)
+                         for _ in range(3)]
+    scores = np.matmul(query, np.transpose(key, [0, 1, 3, 2]))
+    scores /= np.sqrt(attention_shape[-1])
+    run_inputs = [query, key, value]
+    if masked:
+        # Masks out the last key of the first batch
+        mask = np.zeros(mask_shape, dtype=np.float32)
+        mask[0, 0, 0, -1] = -10000.0
+        scores += mask
+        run_inputs.append(mask)
+    probabilities = np.exp(scores - scores.max(axis=-1, keepdims=True))
+    probabilities /= probabilities.sum(axis=-1, keepdims=True)
+    outputs = backendrep.run(run_inputs)
+    expected_outputs = [np.matmul(probabilities, value)]
+    np.testing.assert_allclose(expected_outputs, outputs, rtol=1e-4,
+                               atol=1e-5)
+
+
+# test inputs and outputs of every numeric type round trip at their width
+# The Reshape to [6] moves the elements unchanged
+round_trip_types = [
+    (onnx.TensorProto.BOOL, np.bool_), (onnx.TensorProto.INT8, np.int8),
+    (onnx.TensorProto.INT16, np.int16), (onnx.TensorProto.INT32, np.int32),
+    (onnx.TensorProto.INT64, np.int64), (onnx.TensorProto.UINT8, np.uint8),
+    (onnx.TensorProto.UINT16, np.uint16), (onnx.TensorProto.UINT32, np.uint32),
+    (onnx.TensorProto.UINT64, np.uint64),
+    (onnx.TensorProto.FLOAT16, np.float16),
+    (onnx.TensorProto.FLOAT, np.float32), (onnx.TensorProto.DOUBLE, np.float64)]
+for elem_type, dtype in round_trip_types:
+    node = onnx.helper.make_node('Reshape', ['data', 'shape'], ['flattened'])
+    graph = onnx.helper.make_graph(
+        nodes=[node],
+        name='RoundTrip',
+        inputs=[onnx.helper.make_tensor_value_info('data', elem_type, [2, 3]),
+                onnx.helper.make_tensor_value_info(
+            'shape', onnx.TensorProto.INT64, [1])],
+        outputs=[onnx.helper.make_tensor_value_info(
+            'flattened', elem_type, [6])],
+        initializer=[onnx.helper.make_tensor(
+            'shape', onnx.TensorProto.INT64, [1], [6])])
+    model = onnx.helper.make_model(graph, producer_name='backend-test')
+    onnx.checker.check_model(model)
+
+    assert(backend.is_compatible(model, device='CPU'))
+    backendrep = backend.prepare(model, device='CPU')
+
+    # Values at the extremes of the type catch truncated or widened copies
+    if dtype == np.bool_:
+        data = np.array([[True, False, True], [False, False, True]])
+    elif np.issubdtype(dtype, np.integer):
+        info = np.iinfo(dtype)
+        data = np.array([[info.min, info.max, 0], [1, info.max - 1, 2]],
+                        dtype=dtype)
+    else:
+        data = np.random.randn(2, 3).astype(dtype)
+    outputs = backendrep.run([data])
+    assert(outputs[0].dtype == dtype)
+    np.testing.assert_equal([np.reshape(data, [6])], outputs)